@@ -0,0 +1,84 @@
+#include "AnalysisCache.h"
+
+AnalysisCache::AnalysisCache(const juce::File& cacheDirectory)
+    : directory(cacheDirectory)
+{
+}
+
+juce::File AnalysisCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("AudioPracticeLooper")
+        .getChildFile("AnalysisCache");
+}
+
+juce::File AnalysisCache::getEntryFile(const juce::File& sourceFile) const
+{
+    // Editing or replacing the source changes its size or mtime, and therefore its key
+    const juce::String key = sourceFile.getFullPathName()
+                           + "|" + juce::String(sourceFile.getSize())
+                           + "|" + juce::String(sourceFile.getLastModificationTime().toMilliseconds());
+
+    return directory.getChildFile(juce::String::toHexString(key.hashCode64()) + ".json");
+}
+
+bool AnalysisCache::loadLoudness(const juce::File& sourceFile, LoudnessResult& result) const
+{
+    const juce::File entryFile = getEntryFile(sourceFile);
+    if (!entryFile.existsAsFile())
+        return false;
+
+    const juce::var entry = juce::JSON::parse(entryFile);
+    const juce::var loudness = entry["loudness"];
+
+    if (static_cast<int>(entry["version"]) != ENTRY_VERSION || !loudness.isObject())
+        return false;
+
+    juce::MemoryBlock rmsData;
+    if (!rmsData.fromBase64Encoding(loudness["blockRms"].toString()))
+        return false;
+
+    result.integratedLufs = loudness["integratedLufs"];
+    result.truePeakDb = loudness["truePeakDb"];
+    result.blocksPerSecond = loudness["blocksPerSecond"];
+
+    const auto* rms = static_cast<const float*>(rmsData.getData());
+    result.blockRms.assign(rms, rms + rmsData.getSize() / sizeof(float));
+    result.isValid = true;
+
+    return true;
+}
+
+void AnalysisCache::storeLoudness(const juce::File& sourceFile, const LoudnessResult& result) const
+{
+    if (!result.isValid || !directory.createDirectory())
+        return;
+
+    juce::DynamicObject::Ptr loudness = new juce::DynamicObject();
+    loudness->setProperty("integratedLufs", result.integratedLufs);
+    loudness->setProperty("truePeakDb", result.truePeakDb);
+    loudness->setProperty("blocksPerSecond", result.blocksPerSecond);
+
+    // A few thousand floats per song, so raw bytes are far smaller than a JSON array
+    const juce::MemoryBlock rmsData(result.blockRms.data(), result.blockRms.size() * sizeof(float));
+    loudness->setProperty("blockRms", rmsData.toBase64Encoding());
+
+    juce::DynamicObject::Ptr entry = new juce::DynamicObject();
+    entry->setProperty("version", ENTRY_VERSION);
+    entry->setProperty("source", sourceFile.getFileName());
+    entry->setProperty("loudness", juce::var(loudness.get()));
+
+    if (!getEntryFile(sourceFile).replaceWithText(juce::JSON::toString(juce::var(entry.get()))))
+        juce::Logger::writeToLog("AnalysisCache: Could not store " + sourceFile.getFileName());
+}
+
+void AnalysisCache::invalidate(const juce::File& sourceFile) const
+{
+    getEntryFile(sourceFile).deleteFile();
+}
+
+void AnalysisCache::clearAll() const
+{
+    for (const auto& entryFile : directory.findChildFiles(juce::File::findFiles, false, "*.json"))
+        entryFile.deleteFile();
+}
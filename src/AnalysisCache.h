@@ -0,0 +1,33 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include "Utils/LoudnessMeter.h"
+
+// Persistent cache of per-file analysis from the progressive load pass.
+// Entries are small JSON files keyed, like PcmDiskCache, by the source
+// file's path, size and modification time, so reopening a file skips the
+// measurement and editing it invalidates the entry.
+class AnalysisCache
+{
+public:
+    explicit AnalysisCache(const juce::File& cacheDirectory = getDefaultDirectory());
+
+    static juce::File getDefaultDirectory();
+
+    // Loudness and peak scan
+    bool loadLoudness(const juce::File& sourceFile, LoudnessResult& result) const;
+    void storeLoudness(const juce::File& sourceFile, const LoudnessResult& result) const;
+
+    void invalidate(const juce::File& sourceFile) const;
+    void clearAll() const;
+
+private:
+    static constexpr int ENTRY_VERSION = 1;
+
+    juce::File directory;
+
+    juce::File getEntryFile(const juce::File& sourceFile) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisCache)
+};
@@ -74,10 +74,11 @@ void AnalysisWorker::feedAudioData(const float* audioData, int numSamples, int n
     {
         analysisBuffer.write(monoBuffer.data(), monoBuffer.size());
     }
-    
-    // Update time position
-    double timeAdvancement = static_cast<double>(numSamples) / sampleRate;
-    currentTimeSeconds.store(currentTimeSeconds.load() + timeAdvancement);
+}
+
+bool AnalysisWorker::canAcceptSamples(int numSamples) const
+{
+    return analysisBuffer.space() >= static_cast<size_t>(numSamples);
 }
 
 void AnalysisWorker::downsampleToMono(const float* audioData, int numSamples, int numChannels)
@@ -213,6 +214,11 @@ void AnalysisWorker::analyzeAudioChunk(const float* monoData, int numSamples)
 {
     if (!tempoDetector || !onsetDetector || !inputVector || numSamples != HOP_SIZE)
         return;
+
+    // Time is counted as chunks are analysed rather than as they are fed, so
+    // beat positions stay right when audio arrives faster than realtime
+    const double chunkStartTime = currentTimeSeconds.load();
+    currentTimeSeconds.store(chunkStartTime + static_cast<double>(numSamples) / sampleRate);
     
     // Copy audio data to aubio input vector
     for (int i = 0; i < numSamples; ++i)
@@ -226,7 +232,7 @@ void AnalysisWorker::analyzeAudioChunk(const float* monoData, int numSamples)
     // Check for beat detection
     if (fvec_get_sample(tempoOutput, 0) != 0.0f)
     {
-        double currentTime = currentTimeSeconds.load() - (static_cast<double>(HOP_SIZE) / sampleRate);
+        double currentTime = chunkStartTime;
         
         std::lock_guard<std::mutex> lock(resultsMutex);
         currentResults.beats.push_back(currentTime);
@@ -247,7 +253,7 @@ void AnalysisWorker::analyzeAudioChunk(const float* monoData, int numSamples)
     // Check for onset detection
     if (fvec_get_sample(onsetOutput, 0) != 0.0f)
     {
-        double currentTime = currentTimeSeconds.load() - (static_cast<double>(HOP_SIZE) / sampleRate);
+        double currentTime = chunkStartTime;
         
         std::lock_guard<std::mutex> lock(resultsMutex);
         currentResults.onsets.push_back(currentTime);
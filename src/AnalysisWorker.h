@@ -38,6 +38,8 @@ public:
 
     // Audio input
     void feedAudioData(const float* audioData, int numSamples, int numChannels);
+    bool canAcceptSamples(int numSamples) const;
+    double getAnalysedSeconds() const { return currentTimeSeconds.load(); }
     
     // Results access
     AnalysisResult getLatestResults() const;
@@ -76,7 +78,7 @@ private:
     AnalysisResult currentResults;
     
     // Processing state
-    std::atomic<double> currentTimeSeconds{0.0};
+    std::atomic<double> currentTimeSeconds{0.0};   // End of the audio analysed so far
     double lastBeatTime = 0.0;
     std::vector<double> recentBeats;
     
@@ -0,0 +1,812 @@
+#include "AudioDecoder.h"
+
+// Include FFmpeg headers with C linkage
+extern "C"
+{
+    #include <libavformat/avformat.h>
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/avutil.h>
+    #include <libavutil/opt.h>
+    #include <libswresample/swresample.h>
+}
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+AudioDecoder::AudioDecoder() = default;
+
+AudioDecoder::~AudioDecoder()
+{
+    close();
+}
+
+bool AudioDecoder::open(const juce::File& file)
+{
+    // The codec and resampler are kept until we know whether they fit the new file
+    closeInput();
+    reusedCodec = false;
+
+    if (!openInput(file))
+    {
+        close();
+        return false;
+    }
+
+    if (codecContext != nullptr && canReuseCodec())
+    {
+        // Same format as the previous file: only the decoder state needs resetting
+        avcodec_flush_buffers(codecContext);
+        reusedCodec = true;
+    }
+    else
+    {
+        releaseCodec();
+
+        if (!openCodec())
+        {
+            close();
+            return false;
+        }
+    }
+
+    // A few decoders only learn their sample format from the first packets,
+    // which the fast path has not looked at yet
+    if (codecContext->sample_fmt == AV_SAMPLE_FMT_NONE)
+    {
+        releaseCodec();
+
+        if (avformat_find_stream_info(formatContext, nullptr) < 0 || !openCodec())
+        {
+            juce::Logger::writeToLog("Failed to find stream info");
+            close();
+            return false;
+        }
+    }
+
+    // Get audio properties
+    AVStream* audioStream = formatContext->streams[audioStreamIndex];
+    const double previousOutputRate = swrContext != nullptr ? sampleRate : 0.0;
+    sourceSampleRate = codecContext->sample_rate;
+    sampleRate = requestedSampleRate > 0.0 ? requestedSampleRate : sourceSampleRate;
+    numChannels = codecContext->channels;
+
+    // The quality may have been set while closed, which only stores it
+    if (reusedCodec && swrContext != nullptr && sampleRate == previousOutputRate
+        && resamplerQuality == resamplerContextQuality)
+    {
+        swr_init(swrContext); // Drop the previous file's buffered samples
+    }
+    else
+    {
+        swr_free(&swrContext);
+
+        if (!setupResampler())
+        {
+            close();
+            return false;
+        }
+    }
+
+    // Allocate frame and packet
+    if (!frame)
+        frame = av_frame_alloc();
+
+    if (!packet)
+        packet = av_packet_alloc();
+
+    if (!frame || !packet)
+    {
+        juce::Logger::writeToLog("Failed to allocate frame or packet");
+        close();
+        return false;
+    }
+
+    readDuration();
+
+    streamStartTimestamp = audioStream->start_time != AV_NOPTS_VALUE ? audioStream->start_time : 0;
+
+    // Raw elementary streams only know packet timestamps from bitrate estimates
+    // after a timestamp seek, but their byte offsets are exact
+    const juce::String formatName(formatContext->iformat->name);
+    seekByByteOffset = formatName == "mp3" || formatName == "aac"
+                    || formatName == "ac3" || formatName == "eac3";
+
+    // Index every packet so seeks land on the exact sample. The scan also
+    // yields an exact duration, which header estimates often miss for VBR files.
+    if (shouldBuildSeekIndex && !buildSeekIndex())
+    {
+        juce::Logger::writeToLog("AudioDecoder: No seek index, falling back to approximate seeking");
+    }
+
+    positionFrames = 0;
+    endOfStream = false;
+    drainingDecoder = false;
+    resamplerDrained = false;
+    pendingFrames = 0;
+    pendingReadFrame = 0;
+
+    return true;
+}
+
+bool AudioDecoder::openInput(const juce::File& file)
+{
+    if (!file.exists())
+        return false;
+
+    // Initialize FFmpeg (only needed once globally, but safe to call multiple times)
+    av_register_all();
+    avcodec_register_all();
+
+    AVDictionary* options = nullptr;
+
+    if (fastOpen)
+    {
+        av_dict_set_int(&options, "probesize", FAST_OPEN_PROBE_BYTES, 0);
+        av_dict_set_int(&options, "analyzeduration", FAST_OPEN_ANALYZE_MICROSECONDS, 0);
+    }
+
+    // Open input file
+    const juce::String path = file.getFullPathName();
+    int ret = avformat_open_input(&formatContext, path.toRawUTF8(), nullptr, &options);
+    av_dict_free(&options);
+
+    if (ret < 0)
+    {
+        juce::Logger::writeToLog("Failed to open input file: " + file.getFileName());
+        return false;
+    }
+
+    // Most containers describe their streams in the header; the stream-info
+    // pass decodes packets to fill in what they leave out
+    audioStreamIndex = findAudioStream();
+
+    const bool headerIsEnough = fastOpen
+                             && (formatContext->ctx_flags & AVFMTCTX_NOHEADER) == 0
+                             && audioStreamIndex >= 0
+                             && formatContext->streams[audioStreamIndex]->codecpar->sample_rate > 0
+                             && formatContext->streams[audioStreamIndex]->codecpar->channels > 0;
+
+    if (!headerIsEnough)
+    {
+        // Retrieve stream information
+        ret = avformat_find_stream_info(formatContext, nullptr);
+        if (ret < 0)
+        {
+            juce::Logger::writeToLog("Failed to find stream info");
+            return false;
+        }
+
+        audioStreamIndex = findAudioStream();
+    }
+
+    if (audioStreamIndex == -1)
+    {
+        juce::Logger::writeToLog("No audio stream found");
+        return false;
+    }
+
+    return true;
+}
+
+int AudioDecoder::findAudioStream() const
+{
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++)
+    {
+        if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+            return static_cast<int>(i);
+    }
+
+    return -1;
+}
+
+bool AudioDecoder::canReuseCodec() const
+{
+    const AVCodecParameters* params = formatContext->streams[audioStreamIndex]->codecpar;
+
+    // Decoders fill in the layout and format once they run, so only compare
+    // them when the new file's header states them
+    const bool sameLayout = params->channel_layout == 0 || params->channel_layout == codecContext->channel_layout;
+    const bool sameFormat = params->format == AV_SAMPLE_FMT_NONE || params->format == codecContext->sample_fmt;
+
+    // Codec configuration such as the AAC AudioSpecificConfig lives in the extradata
+    const bool sameExtradata = params->extradata_size == codecContext->extradata_size
+                            && (params->extradata_size == 0
+                                || std::memcmp(params->extradata, codecContext->extradata,
+                                               static_cast<size_t>(params->extradata_size)) == 0);
+
+    return params->codec_id == codecContext->codec_id
+        && params->sample_rate == codecContext->sample_rate
+        && params->channels == codecContext->channels
+        && params->block_align == codecContext->block_align
+        && params->bits_per_coded_sample == codecContext->bits_per_coded_sample
+        && sameLayout && sameFormat && sameExtradata
+        && codecThreadCount == decodeThreadCount && codecThreadType == decodeThreadType;
+}
+
+void AudioDecoder::readDuration()
+{
+    AVStream* audioStream = formatContext->streams[audioStreamIndex];
+
+    // Set by the stream-info pass when it had nothing better than the bitrate
+    lengthEstimated = formatContext->duration_estimation_method == AVFMT_DURATION_FROM_BITRATE;
+
+    if (audioStream->duration != AV_NOPTS_VALUE)
+    {
+        totalDurationSeconds = audioStream->duration * av_q2d(audioStream->time_base);
+    }
+    else if (formatContext->duration != AV_NOPTS_VALUE)
+    {
+        totalDurationSeconds = formatContext->duration / static_cast<double>(AV_TIME_BASE);
+    }
+    else
+    {
+        // Fast open skipped the stream-info pass and the header has no length
+        // (e.g. MP3 without a Xing frame): estimate it from the bitrate
+        const int64_t bitRate = audioStream->codecpar->bit_rate > 0 ? audioStream->codecpar->bit_rate
+                                                                    : formatContext->bit_rate;
+        const int64_t fileBytes = formatContext->pb != nullptr ? avio_size(formatContext->pb) : -1;
+
+        totalDurationSeconds = bitRate > 0 && fileBytes > 0 ? static_cast<double>(fileBytes) * 8.0 / bitRate : 0.0;
+        lengthEstimated = totalDurationSeconds > 0.0;
+    }
+}
+
+bool AudioDecoder::openCodec()
+{
+    AVCodecParameters* codecParams = formatContext->streams[audioStreamIndex]->codecpar;
+
+    // Find decoder
+    AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
+    if (!codec)
+    {
+        juce::Logger::writeToLog("Unsupported codec");
+        return false;
+    }
+
+    // Allocate codec context
+    codecContext = avcodec_alloc_context3(codec);
+    if (!codecContext)
+    {
+        juce::Logger::writeToLog("Failed to allocate codec context");
+        return false;
+    }
+
+    // Copy codec parameters to context
+    int ret = avcodec_parameters_to_context(codecContext, codecParams);
+    if (ret < 0)
+    {
+        juce::Logger::writeToLog("Failed to copy codec parameters");
+        return false;
+    }
+
+    // Codecs without threading support (e.g. MP3) silently stay single-threaded
+    codecThreadCount = decodeThreadCount;
+    codecThreadType = decodeThreadType;
+    codecContext->thread_count = decodeThreadCount;
+    codecContext->thread_type = decodeThreadType == ThreadType::Frame ? FF_THREAD_FRAME
+                              : decodeThreadType == ThreadType::Slice ? FF_THREAD_SLICE
+                              : FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+    // Open codec
+    ret = avcodec_open2(codecContext, codec, nullptr);
+    if (ret < 0)
+    {
+        juce::Logger::writeToLog("Failed to open codec");
+        return false;
+    }
+
+    return true;
+}
+
+void AudioDecoder::setDecodeThreading(int threadCount, ThreadType type)
+{
+    decodeThreadCount = juce::jmax(0, threadCount);
+    decodeThreadType = type;
+}
+
+int AudioDecoder::getActiveThreadCount() const
+{
+    if (codecContext == nullptr || codecContext->active_thread_type == 0)
+        return 1;
+
+    return codecContext->thread_count;
+}
+
+bool AudioDecoder::setupResampler()
+{
+    // Setup resampler to convert to stereo planar float, so frames can be
+    // copied straight into per-channel buffers without deinterleaving
+    swrContext = swr_alloc_set_opts(nullptr,
+                                   AV_CH_LAYOUT_STEREO,     // Output channel layout
+                                   AV_SAMPLE_FMT_FLTP,      // Output sample format
+                                   static_cast<int>(sampleRate), // Output sample rate
+                                   codecContext->channel_layout ? codecContext->channel_layout :
+                                   (codecContext->channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO),
+                                   codecContext->sample_fmt,     // Input sample format
+                                   codecContext->sample_rate,    // Input sample rate
+                                   0, nullptr);
+
+    if (!swrContext)
+    {
+        juce::Logger::writeToLog("Failed to allocate resampler context");
+        return false;
+    }
+
+    // Only matters when the rates differ; otherwise swr just converts the format
+    if (resamplerQuality == ResamplerQuality::High)
+    {
+        av_opt_set_int(swrContext, "filter_size", 64, 0);
+        av_opt_set_int(swrContext, "phase_shift", 12, 0);
+        av_opt_set_double(swrContext, "cutoff", 0.97, 0);
+    }
+    else
+    {
+        av_opt_set_int(swrContext, "filter_size", 16, 0);
+        av_opt_set_int(swrContext, "phase_shift", 8, 0);
+        av_opt_set_int(swrContext, "linear_interp", 1, 0);
+        av_opt_set_double(swrContext, "cutoff", 0.91, 0);
+    }
+
+    int ret = swr_init(swrContext);
+    if (ret < 0)
+    {
+        juce::Logger::writeToLog("Failed to initialize resampler");
+        return false;
+    }
+
+    resamplerContextQuality = resamplerQuality;
+
+    // Most codecs decode at most a few thousand frames per packet
+    reservePendingFrames(8192);
+
+    return true;
+}
+
+void AudioDecoder::setOutputSampleRate(double newSampleRate)
+{
+    if (newSampleRate == requestedSampleRate)
+        return;
+
+    requestedSampleRate = newSampleRate;
+
+    if (isOpen())
+        reconfigureResampler();
+}
+
+void AudioDecoder::setResamplerQuality(ResamplerQuality newQuality)
+{
+    if (newQuality == resamplerQuality)
+        return;
+
+    resamplerQuality = newQuality;
+
+    if (isOpen())
+        reconfigureResampler();
+}
+
+bool AudioDecoder::reconfigureResampler()
+{
+    const double positionSeconds = static_cast<double>(positionFrames) / sampleRate;
+
+    swr_free(&swrContext);
+    sampleRate = requestedSampleRate > 0.0 ? requestedSampleRate : sourceSampleRate;
+
+    if (!setupResampler())
+    {
+        close();
+        return false;
+    }
+
+    // Index frames are counted at the output rate
+    for (auto& seekPoint : seekIndex)
+        seekPoint.firstFrame = timestampToFrame(seekPoint.timestamp);
+
+    // Samples buffered in the old resampler are gone, so resume with an exact seek
+    return seek(static_cast<int64_t>(std::llround(positionSeconds * sampleRate)));
+}
+
+void AudioDecoder::reservePendingFrames(int numFrames)
+{
+    for (auto& channelSamples : pendingSamples)
+    {
+        if (static_cast<int>(channelSamples.size()) < numFrames)
+            channelSamples.resize(static_cast<size_t>(numFrames));
+    }
+}
+
+void AudioDecoder::close()
+{
+    closeInput();
+    releaseCodec();
+
+    if (frame)
+    {
+        av_frame_free(&frame);
+        frame = nullptr;
+    }
+
+    if (packet)
+    {
+        av_packet_free(&packet);
+        packet = nullptr;
+    }
+}
+
+void AudioDecoder::closeInput()
+{
+    if (formatContext)
+    {
+        avformat_close_input(&formatContext);
+        formatContext = nullptr;
+    }
+
+    audioStreamIndex = -1;
+    totalDurationSeconds = 0.0;
+    lengthEstimated = false;
+    seekIndex.clear();
+    streamStartTimestamp = 0;
+    seekByByteOffset = false;
+    anchorToNextFrame = false;
+    positionFrames = 0;
+    endOfStream = false;
+    drainingDecoder = false;
+    resamplerDrained = false;
+    pendingFrames = 0;
+    pendingReadFrame = 0;
+}
+
+void AudioDecoder::releaseCodec()
+{
+    if (swrContext)
+    {
+        swr_free(&swrContext);
+        swrContext = nullptr;
+    }
+
+    if (codecContext)
+    {
+        avcodec_free_context(&codecContext);
+        codecContext = nullptr;
+    }
+}
+
+int64_t AudioDecoder::getLengthInFrames() const
+{
+    return static_cast<int64_t>(totalDurationSeconds * sampleRate);
+}
+
+bool AudioDecoder::buildSeekIndex()
+{
+    AVStream* audioStream = formatContext->streams[audioStreamIndex];
+
+    seekIndex.clear();
+    int64_t nextTimestamp = streamStartTimestamp;
+
+    // Demux only: packets are read and indexed but never decoded
+    while (av_read_frame(formatContext, packet) >= 0)
+    {
+        if (packet->stream_index == audioStreamIndex)
+        {
+            const int64_t timestamp = packet->pts != AV_NOPTS_VALUE ? packet->pts : nextTimestamp;
+
+            seekIndex.push_back({ timestamp, packet->pos, timestampToFrame(timestamp) });
+            nextTimestamp = timestamp + packet->duration;
+        }
+
+        av_packet_unref(packet);
+    }
+
+    // Rewind for playback
+    av_seek_frame(formatContext, audioStreamIndex, streamStartTimestamp, AVSEEK_FLAG_BACKWARD);
+    avcodec_flush_buffers(codecContext);
+
+    if (seekIndex.empty())
+        return false;
+
+    std::sort(seekIndex.begin(), seekIndex.end(),
+              [](const SeekPoint& a, const SeekPoint& b) { return a.firstFrame < b.firstFrame; });
+
+    totalDurationSeconds = (nextTimestamp - streamStartTimestamp) * av_q2d(audioStream->time_base);
+    lengthEstimated = false;
+
+    juce::Logger::writeToLog("AudioDecoder: Indexed " + juce::String(static_cast<int>(seekIndex.size()))
+                             + " packets");
+    return true;
+}
+
+void AudioDecoder::setSeekIndex(SeekIndex index)
+{
+    seekIndex = std::move(index);
+
+    // The index may come from a decoder running at another output rate
+    for (auto& seekPoint : seekIndex)
+        seekPoint.firstFrame = timestampToFrame(seekPoint.timestamp);
+}
+
+const AudioDecoder::SeekPoint* AudioDecoder::findSeekPoint(int64_t targetFrame) const
+{
+    if (seekIndex.empty())
+        return nullptr;
+
+    // Last packet starting at or before the target...
+    auto it = std::upper_bound(seekIndex.begin(), seekIndex.end(), targetFrame,
+                               [](int64_t frameIndex, const SeekPoint& point) { return frameIndex < point.firstFrame; });
+
+    auto index = static_cast<int>(std::distance(seekIndex.begin(), it)) - 1;
+
+    // ...then back off a few packets so the decoder is primed when it gets there
+    index = juce::jmax(0, index - SEEK_PREROLL_PACKETS);
+
+    return &seekIndex[static_cast<size_t>(index)];
+}
+
+int64_t AudioDecoder::timestampToFrame(int64_t timestamp) const
+{
+    AVStream* audioStream = formatContext->streams[audioStreamIndex];
+    return av_rescale_q(timestamp - streamStartTimestamp,
+                        audioStream->time_base,
+                        AVRational{ 1, static_cast<int>(sampleRate) });
+}
+
+bool AudioDecoder::seek(int64_t targetFrame)
+{
+    if (!isOpen())
+        return false;
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    AVStream* audioStream = formatContext->streams[audioStreamIndex];
+    const SeekPoint* seekPoint = findSeekPoint(targetFrame);
+    int ret = 0;
+
+    if (seekPoint == nullptr)
+    {
+        int64_t timestamp = av_rescale_q(targetFrame,
+                                         AVRational{ 1, static_cast<int>(sampleRate) },
+                                         audioStream->time_base);
+
+        ret = av_seek_frame(formatContext, audioStreamIndex, timestamp + streamStartTimestamp, AVSEEK_FLAG_BACKWARD);
+    }
+    else if (seekByByteOffset && seekPoint->byteOffset >= 0)
+    {
+        ret = av_seek_frame(formatContext, audioStreamIndex, seekPoint->byteOffset, AVSEEK_FLAG_BYTE);
+    }
+    else
+    {
+        ret = av_seek_frame(formatContext, audioStreamIndex, seekPoint->timestamp, AVSEEK_FLAG_BACKWARD);
+    }
+
+    if (ret < 0)
+        return false;
+
+    avcodec_flush_buffers(codecContext);
+    swr_init(swrContext); // Drop any samples buffered inside the resampler
+
+    endOfStream = false;
+    drainingDecoder = false;
+    resamplerDrained = false;
+    pendingFrames = 0;
+    pendingReadFrame = 0;
+
+    // A byte seek lands exactly on the indexed packet. Otherwise let the first
+    // decoded frame's timestamp say where the demuxer actually put us.
+    positionFrames = seekPoint != nullptr ? seekPoint->firstFrame : targetFrame;
+    anchorToNextFrame = seekPoint == nullptr || !seekByByteOffset;
+
+    // Decode and discard up to the exact target frame. If the target lies past
+    // the end of the stream, getPosition() reports where decoding really stopped.
+    lastSeekCost.discardedFrames = skipToFrame(targetFrame);
+
+    lastSeekCost.milliseconds = juce::Time::highResolutionTicksToSeconds(
+        juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+
+    return true;
+}
+
+int64_t AudioDecoder::skipToFrame(int64_t targetFrame)
+{
+    int64_t framesSkipped = 0;
+
+    while (positionFrames < targetFrame)
+    {
+        if (pendingReadFrame >= pendingFrames && !decodeNextFrame())
+            break;
+
+        const int framesToSkip = static_cast<int>(juce::jmin<int64_t>(targetFrame - positionFrames,
+                                                                      pendingFrames - pendingReadFrame));
+        pendingReadFrame += framesToSkip;
+        positionFrames += framesToSkip;
+        framesSkipped += framesToSkip;
+    }
+
+    return framesSkipped;
+}
+
+bool AudioDecoder::decodeToBuffer(juce::AudioBuffer<float>& destination, BulkDecodeStats* stats)
+{
+    if (!isOpen())
+        return false;
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    // The seek index makes the length exact, so this rarely needs to grow
+    int capacity = static_cast<int>(juce::jmax<int64_t>(getLengthInFrames() - positionFrames, 0)) + 8192;
+    destination.setSize(NUM_OUTPUT_CHANNELS, capacity, false, false, true);
+
+    int framesDecoded = 0;
+
+    while (true)
+    {
+        if (framesDecoded == capacity)
+        {
+            capacity += capacity / 2;
+            destination.setSize(NUM_OUTPUT_CHANNELS, capacity, true, false, true);
+        }
+
+        float* channelOutputs[NUM_OUTPUT_CHANNELS] = {
+            destination.getWritePointer(0, framesDecoded),
+            destination.getWritePointer(1, framesDecoded)
+        };
+
+        const int framesRead = read(channelOutputs, capacity - framesDecoded);
+        if (framesRead <= 0)
+            break;
+
+        framesDecoded += framesRead;
+    }
+
+    destination.setSize(NUM_OUTPUT_CHANNELS, framesDecoded, true, false, true);
+
+    const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    const double audioSeconds = static_cast<double>(framesDecoded) / sampleRate;
+    const double realtimeMultiple = seconds > 0.0 ? audioSeconds / seconds : 0.0;
+
+    juce::Logger::writeToLog("AudioDecoder: Decoded " + juce::String(audioSeconds, 1) + "s in "
+                             + juce::String(seconds, 3) + "s (" + juce::String(realtimeMultiple, 1)
+                             + "x realtime, " + juce::String(getActiveThreadCount()) + " threads)");
+
+    if (stats != nullptr)
+        *stats = { framesDecoded, seconds, realtimeMultiple };
+
+    return framesDecoded > 0;
+}
+
+int AudioDecoder::read(float* const* channelOutputs, int numFrames)
+{
+    if (!isOpen())
+        return 0;
+
+    int framesRead = 0;
+
+    while (framesRead < numFrames)
+    {
+        if (pendingReadFrame >= pendingFrames && !decodeNextFrame())
+            break;
+
+        const int framesToCopy = juce::jmin(numFrames - framesRead, pendingFrames - pendingReadFrame);
+
+        for (int channel = 0; channel < NUM_OUTPUT_CHANNELS; ++channel)
+        {
+            const float* source = pendingSamples[static_cast<size_t>(channel)].data() + pendingReadFrame;
+            std::copy(source, source + framesToCopy, channelOutputs[channel] + framesRead);
+        }
+
+        pendingReadFrame += framesToCopy;
+        framesRead += framesToCopy;
+    }
+
+    positionFrames += framesRead;
+    return framesRead;
+}
+
+bool AudioDecoder::drainResampler()
+{
+    if (resamplerDrained)
+        return false;
+
+    resamplerDrained = true;
+
+    const int maxOutputFrames = swr_get_out_samples(swrContext, 0);
+    if (maxOutputFrames <= 0)
+        return false;
+
+    reservePendingFrames(maxOutputFrames);
+
+    uint8_t* outputData[NUM_OUTPUT_CHANNELS] = {
+        reinterpret_cast<uint8_t*>(pendingSamples[0].data()),
+        reinterpret_cast<uint8_t*>(pendingSamples[1].data())
+    };
+
+    pendingFrames = juce::jmax(0, swr_convert(swrContext, outputData, maxOutputFrames, nullptr, 0));
+    return pendingFrames > 0;
+}
+
+bool AudioDecoder::decodeNextFrame()
+{
+    pendingFrames = 0;
+    pendingReadFrame = 0;
+
+    while (!endOfStream)
+    {
+        int ret = avcodec_receive_frame(codecContext, frame);
+
+        if (ret == 0)
+        {
+            if (anchorToNextFrame)
+            {
+                anchorToNextFrame = false;
+
+                if (frame->best_effort_timestamp != AV_NOPTS_VALUE)
+                    positionFrames = timestampToFrame(frame->best_effort_timestamp);
+            }
+
+            // Resample to stereo planar float
+            const int maxOutputFrames = swr_get_out_samples(swrContext, frame->nb_samples);
+            reservePendingFrames(maxOutputFrames);
+
+            uint8_t* outputData[NUM_OUTPUT_CHANNELS] = {
+                reinterpret_cast<uint8_t*>(pendingSamples[0].data()),
+                reinterpret_cast<uint8_t*>(pendingSamples[1].data())
+            };
+
+            const int outputFrames = swr_convert(swrContext,
+                                                 outputData,
+                                                 maxOutputFrames,
+                                                 (const uint8_t**)frame->data,
+                                                 frame->nb_samples);
+
+            av_frame_unref(frame);
+
+            if (outputFrames > 0)
+            {
+                pendingFrames = outputFrames;
+                return true;
+            }
+
+            continue;
+        }
+
+        if (ret == AVERROR_EOF)
+        {
+            // The resampler still holds its filter delay's worth of output
+            if (drainResampler())
+                return true;
+
+            endOfStream = true;
+            break;
+        }
+
+        if (ret != AVERROR(EAGAIN))
+        {
+            juce::Logger::writeToLog("AudioDecoder: decode error");
+            endOfStream = true;
+            break;
+        }
+
+        // Decoder needs more input
+        if (drainingDecoder)
+        {
+            endOfStream = true;
+            break;
+        }
+
+        ret = av_read_frame(formatContext, packet);
+        if (ret < 0)
+        {
+            // End of file: flush the frames still held by the decoder
+            avcodec_send_packet(codecContext, nullptr);
+            drainingDecoder = true;
+            continue;
+        }
+
+        if (packet->stream_index == audioStreamIndex)
+        {
+            avcodec_send_packet(codecContext, packet);
+        }
+
+        av_packet_unref(packet);
+    }
+
+    return false;
+}
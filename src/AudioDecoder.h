@@ -0,0 +1,196 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations for FFmpeg types
+extern "C"
+{
+    struct AVFormatContext;
+    struct AVCodecContext;
+    struct AVFrame;
+    struct AVPacket;
+    struct SwrContext;
+}
+
+// Wraps the FFmpeg demuxer, decoder and resampler for a single file.
+// Output is always stereo planar float, resampled to the requested rate.
+// Not thread-safe: an instance must only be used from one thread at a time
+// (normally the decode thread owned by AudioFileSource).
+class AudioDecoder
+{
+public:
+    AudioDecoder();
+    ~AudioDecoder();
+
+    // File operations
+    bool open(const juce::File& file);
+    void close();
+    bool isOpen() const { return formatContext != nullptr; }
+
+    // Closes the file but keeps the codec and resampler for the next open()
+    void closeInput();
+
+    // Output format. The rate defaults to the file's own rate; both may be
+    // changed while open, in which case decoding resumes at the same time.
+    enum class ResamplerQuality
+    {
+        Live,   // Short filter, cheap enough to run alongside playback
+        High    // Long filter for offline work such as export and caching
+    };
+
+    void setOutputSampleRate(double newSampleRate);
+    void setResamplerQuality(ResamplerQuality newQuality);
+    ResamplerQuality getResamplerQuality() const { return resamplerQuality; }
+
+    // Codec threading, applied on the next open(). Frame threading adds a few
+    // frames of decoder delay, so playback decoders keep the default of one thread.
+    enum class ThreadType
+    {
+        Frame,
+        Slice,
+        Any
+    };
+
+    void setDecodeThreading(int threadCount, ThreadType type = ThreadType::Any);
+    int getActiveThreadCount() const;
+
+    // Fast open bounds container probing and skips the stream-info pass when
+    // the headers already describe the audio stream. The length may then be a
+    // bitrate estimate. Consecutive open() calls on one decoder also reuse the
+    // codec and resampler when the new file has the same format.
+    void setFastOpen(bool shouldOpenFast) { fastOpen = shouldOpenFast; }
+    bool isLengthEstimated() const { return lengthEstimated; }
+    bool didReuseCodec() const { return reusedCodec; }
+
+    // Stream properties
+    double getSampleRate() const { return sampleRate; }
+
+    double getSourceSampleRate() const { return sourceSampleRate; }
+    int getNumChannels() const { return numChannels; }
+    double getLengthInSeconds() const { return totalDurationSeconds; }
+    int64_t getLengthInFrames() const;
+
+    // Decoding
+    int read(float* const* channelOutputs, int numFrames);
+    bool seek(int64_t frame);
+    int64_t getPosition() const { return positionFrames; }
+    bool isEndOfStream() const { return endOfStream; }
+
+    // Decodes from the current position to the end of the file as fast as
+    // possible, for waveform, analysis and cache builds
+    struct BulkDecodeStats
+    {
+        int64_t frames = 0;
+        double seconds = 0.0;
+        double realtimeMultiple = 0.0;
+    };
+
+    bool decodeToBuffer(juce::AudioBuffer<float>& destination, BulkDecodeStats* stats = nullptr);
+
+    // Seek diagnostics
+    struct SeekCost
+    {
+        double milliseconds = 0.0;
+        int64_t discardedFrames = 0;
+    };
+
+    SeekCost getLastSeekCost() const { return lastSeekCost; }
+
+    // Seek index built by a demux-only scan at open time
+    struct SeekPoint
+    {
+        int64_t timestamp = 0;    // Packet PTS in stream time base
+        int64_t byteOffset = -1;  // Packet position in the file
+        int64_t firstFrame = 0;   // First output frame decoded from this packet
+    };
+
+    using SeekIndex = std::vector<SeekPoint>;
+
+    // Skipping the scan makes open() much faster on long files; an index
+    // built by another decoder on the same file can be handed over later
+    void setBuildSeekIndex(bool shouldBuild) { shouldBuildSeekIndex = shouldBuild; }
+    bool hasSeekIndex() const { return !seekIndex.empty(); }
+    const SeekIndex& getSeekIndex() const { return seekIndex; }
+    void setSeekIndex(SeekIndex index);
+
+    static constexpr int NUM_OUTPUT_CHANNELS = 2;
+
+    // Packets decoded ahead of the target to rebuild codec state (e.g. the MP3 bit reservoir)
+    static constexpr int SEEK_PREROLL_PACKETS = 4;
+
+    // Probe limits for fast open, in bytes and microseconds
+    static constexpr int FAST_OPEN_PROBE_BYTES = 32768;
+    static constexpr int FAST_OPEN_ANALYZE_MICROSECONDS = 100000;
+
+private:
+    // FFmpeg context
+    AVFormatContext* formatContext = nullptr;
+    AVCodecContext* codecContext = nullptr;
+    SwrContext* swrContext = nullptr;
+    AVFrame* frame = nullptr;
+    AVPacket* packet = nullptr;
+
+    int audioStreamIndex = -1;
+
+    // Audio properties
+    double sampleRate = 44100.0;         // Output rate
+    double sourceSampleRate = 44100.0;   // Codec rate
+    double requestedSampleRate = 0.0;    // 0 follows the source
+    ResamplerQuality resamplerQuality = ResamplerQuality::Live;
+    ResamplerQuality resamplerContextQuality = ResamplerQuality::Live;   // What swrContext was built with
+    bool resamplerDrained = false;
+
+    // Codec threading
+    int decodeThreadCount = 1;   // 0 lets FFmpeg use one thread per core
+    ThreadType decodeThreadType = ThreadType::Any;
+    int codecThreadCount = -1;   // What the open codec context was created with
+    ThreadType codecThreadType = ThreadType::Any;
+    int numChannels = 2;
+    double totalDurationSeconds = 0.0;
+
+    // Fast open
+    bool fastOpen = false;
+    bool lengthEstimated = false;
+    bool reusedCodec = false;
+
+    // Decode state
+    int64_t positionFrames = 0;
+    bool endOfStream = false;
+    bool drainingDecoder = false;
+
+    // Seek index
+    SeekIndex seekIndex;
+    bool shouldBuildSeekIndex = true;
+    int64_t streamStartTimestamp = 0;
+    bool seekByByteOffset = false;
+    bool anchorToNextFrame = false;
+    SeekCost lastSeekCost;
+
+    // Resampled frames not yet handed out by read(), one vector per channel
+    std::array<std::vector<float>, NUM_OUTPUT_CHANNELS> pendingSamples;
+    int pendingFrames = 0;
+    int pendingReadFrame = 0;
+
+    // Internal methods
+    bool openInput(const juce::File& file);
+    int findAudioStream() const;
+    bool canReuseCodec() const;
+    void releaseCodec();
+    bool openCodec();
+    void readDuration();
+    bool setupResampler();
+    bool reconfigureResampler();
+    bool decodeNextFrame();
+    bool drainResampler();
+    void reservePendingFrames(int numFrames);
+    bool buildSeekIndex();
+    const SeekPoint* findSeekPoint(int64_t frame) const;
+    int64_t timestampToFrame(int64_t timestamp) const;
+    int64_t skipToFrame(int64_t targetFrame);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioDecoder)
+};
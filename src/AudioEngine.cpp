@@ -1,5 +1,6 @@
 #include "AudioEngine.h"
 #include "AudioFileSource.h"
+#include "SetlistPlayer.h"
 
 AudioEngine::AudioEngine() = default;
 
@@ -39,10 +40,18 @@ void AudioEngine::initialize()
     analysisWorker = std::make_unique<AnalysisWorker>();
 
     setupAudioGraph();
+
+    // Watch the callback's load from here on
+    loadGovernor.reset();
+    applyQualityLevel();
+    lastGovernorPollMs = juce::Time::getMillisecondCounterHiRes();
+    startTimer(GOVERNOR_INTERVAL_MS);
 }
 
 void AudioEngine::shutdown()
 {
+    stopTimer();
+
     // Stop analysis worker first
     if (analysisWorker)
     {
@@ -65,7 +74,7 @@ void AudioEngine::shutdown()
     }
 
     // Clear node pointers
-    fileSource = nullptr;
+    setlistPlayer = nullptr;
     rubberBandNode = nullptr;
     eqNode = nullptr;
 }
@@ -88,10 +97,15 @@ void AudioEngine::setupAudioGraph()
             juce::AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode))->nodeID;
 
     // Create processing nodes
-    fileSource = std::make_unique<AudioFileSource>();
-    fileSourceNodeID = processorGraph->addNode(std::unique_ptr<AudioFileSource>(fileSource.release()))->nodeID;
-
+    setlistPlayer = std::make_unique<SetlistPlayer>();
     rubberBandNode = std::make_unique<RubberBandNode>();
+
+    // The stretcher reads the player directly, as fast as it consumes audio;
+    // both nodes belong to the graph, so the pointer lives as long as they do
+    rubberBandNode->setPullSource(setlistPlayer.get());
+    setlistPlayer->setPulled(true);
+
+    fileSourceNodeID = processorGraph->addNode(std::unique_ptr<SetlistPlayer>(setlistPlayer.release()))->nodeID;
     rubberBandNodeID = processorGraph->addNode(std::unique_ptr<RubberBandNode>(rubberBandNode.release()))->nodeID;
 
     eqNode = std::make_unique<EQNode>();
@@ -108,48 +122,60 @@ void AudioEngine::setupAudioGraph()
 
 bool AudioEngine::loadAudioFile(const juce::File& file)
 {
-    if (!processorGraph)
+    auto* player = getSetlistPlayer();
+    if (player == nullptr || !player->loadFile(file))
         return false;
 
-    // Get the file source node from the graph
-    if (auto* node = processorGraph->getNodeForId(fileSourceNodeID))
-    {
-        if (auto* audioFileSource = dynamic_cast<AudioFileSource*>(node->getProcessor()))
-        {
-            bool success = audioFileSource->loadFile(file);
-            if (success)
-            {
-                // Update loop points to full file by default
-                double totalLength = audioFileSource->getTotalLength();
-                setLoopInSeconds(0.0);
-                setLoopOutSeconds(totalLength);
-                setLoopEnabled(false);
-            }
-            return success;
-        }
-    }
-    
-    return false;
+    resetLoopToWholeFile();
+    return true;
 }
 
 void AudioEngine::closeAudioFile()
 {
-    if (!processorGraph)
-        return;
+    if (auto* player = getSetlistPlayer())
+        player->closeFile();
 
-    // Get the file source node from the graph
-    if (auto* node = processorGraph->getNodeForId(fileSourceNodeID))
-    {
-        if (auto* audioFileSource = dynamic_cast<AudioFileSource*>(node->getProcessor()))
-        {
-            audioFileSource->closeFile();
-        }
-    }
-    
     // Reset playback state
     stop();
 }
 
+void AudioEngine::setSetlist(const juce::Array<juce::File>& files)
+{
+    if (auto* player = getSetlistPlayer())
+        player->setSetlist(files);
+}
+
+bool AudioEngine::playSetlistItem(int index)
+{
+    auto* player = getSetlistPlayer();
+    if (player == nullptr || !player->playSetlistItem(index))
+        return false;
+
+    resetLoopToWholeFile();
+    return true;
+}
+
+int AudioEngine::getSetlistIndex() const
+{
+    if (auto* player = getSetlistPlayer())
+        return player->getSetlistIndex();
+
+    return -1;
+}
+
+void AudioEngine::resetLoopToWholeFile()
+{
+    // Update loop points to full file by default
+    loopedFileSource = getFileSource();
+
+    if (auto* audioFileSource = loopedFileSource)
+    {
+        setLoopInSeconds(0.0);
+        setLoopOutSeconds(audioFileSource->getTotalLength());
+        setLoopEnabled(false);
+    }
+}
+
 void AudioEngine::play()
 {
     isPlaying_.store(true);
@@ -175,12 +201,87 @@ void AudioEngine::setTempoRatio(float ratio)
 {
     tempoRatio.store(juce::jlimit(0.25f, 4.0f, ratio));
     tempoSmoother.setTargetValue(tempoRatio.load());
+
+    // Varispeed does its own per-sample smoothing
+    if (auto* player = getSetlistPlayer())
+        player->setVarispeedSpeed(tempoRatio.load());
+
+    updateLoopCache();
 }
 
 void AudioEngine::setPitchSemitones(int semitones)
 {
     pitchSemitones.store(juce::jlimit(-24, 24, semitones));
     pitchSmoother.setTargetValue(static_cast<float>(pitchSemitones.load()));
+
+    updateLoopCache();
+}
+
+void AudioEngine::setVarispeedEnabled(bool enabled)
+{
+    varispeedEnabled.store(enabled);
+
+    if (auto* player = getSetlistPlayer())
+    {
+        player->setVarispeedSpeed(tempoRatio.load());
+        player->setVarispeedEnabled(enabled);
+    }
+
+    // Rubber Band is skipped entirely rather than run at a ratio of one
+    if (auto* node = processorGraph ? processorGraph->getNodeForId(rubberBandNodeID) : nullptr)
+        node->setBypassed(enabled);
+
+    updateLoopCache();
+}
+
+void AudioEngine::setStretchEngine(RubberBandNode::StretchEngine engine)
+{
+    // The governor may be holding the node on WSOLA; the choice applies once it lets go
+    requestedStretchEngine = engine;
+    applyQualityLevel();
+}
+
+RubberBandNode::StretchEngine AudioEngine::getStretchEngine() const
+{
+    return requestedStretchEngine;
+}
+
+void AudioEngine::setStretchLookaheadBlocks(int blocks)
+{
+    if (auto* rubberBand = getRubberBandNode())
+        rubberBand->setLookaheadBlocks(blocks);
+}
+
+int AudioEngine::getStretchLookaheadBlocks() const
+{
+    if (auto* rubberBand = getRubberBandNode())
+        return rubberBand->getLookaheadBlocks();
+
+    return 0;
+}
+
+int AudioEngine::getStretchBufferedFrames() const
+{
+    if (auto* rubberBand = getRubberBandNode())
+        return rubberBand->getBufferedFrames();
+
+    return 0;
+}
+
+int AudioEngine::getStretchPeakBufferedFrames() const
+{
+    if (auto* rubberBand = getRubberBandNode())
+        return rubberBand->getPeakBufferedFrames();
+
+    return 0;
+}
+
+uint64_t AudioEngine::getStretchStarvedBlockCount() const
+{
+    if (auto* rubberBand = getRubberBandNode())
+        return rubberBand->getStarvedBlockCount();
+
+    return 0;
 }
 
 void AudioEngine::setLoopInSeconds(double seconds)
@@ -188,13 +289,10 @@ void AudioEngine::setLoopInSeconds(double seconds)
     loopInSeconds.store(juce::jmax(0.0, seconds));
     
     // Update the AudioFileSource loop points
-    if (auto* node = processorGraph->getNodeForId(fileSourceNodeID))
-    {
-        if (auto* audioFileSource = dynamic_cast<AudioFileSource*>(node->getProcessor()))
-        {
-            audioFileSource->setLoopPoints(loopInSeconds.load(), loopOutSeconds.load());
-        }
-    }
+    if (auto* audioFileSource = getFileSource())
+        audioFileSource->setLoopPoints(loopInSeconds.load(), loopOutSeconds.load());
+
+    updateLoopCache();
 }
 
 void AudioEngine::setLoopOutSeconds(double seconds)
@@ -202,13 +300,10 @@ void AudioEngine::setLoopOutSeconds(double seconds)
     loopOutSeconds.store(juce::jmax(0.0, seconds));
     
     // Update the AudioFileSource loop points
-    if (auto* node = processorGraph->getNodeForId(fileSourceNodeID))
-    {
-        if (auto* audioFileSource = dynamic_cast<AudioFileSource*>(node->getProcessor()))
-        {
-            audioFileSource->setLoopPoints(loopInSeconds.load(), loopOutSeconds.load());
-        }
-    }
+    if (auto* audioFileSource = getFileSource())
+        audioFileSource->setLoopPoints(loopInSeconds.load(), loopOutSeconds.load());
+
+    updateLoopCache();
 }
 
 void AudioEngine::setLoopEnabled(bool enabled)
@@ -216,13 +311,163 @@ void AudioEngine::setLoopEnabled(bool enabled)
     loopEnabled.store(enabled);
     
     // Update the AudioFileSource loop state
+    if (auto* audioFileSource = getFileSource())
+        audioFileSource->setLoopEnabled(enabled);
+
+    updateLoopCache();
+}
+
+void AudioEngine::setReversePlayback(bool shouldReverse)
+{
+    if (auto* audioFileSource = getFileSource())
+        audioFileSource->setReversePlayback(shouldReverse);
+
+    updateLoopCache();
+}
+
+bool AudioEngine::getReversePlayback() const
+{
+    if (auto* audioFileSource = getFileSource())
+        return audioFileSource->isReversePlayback();
+
+    return false;
+}
+
+void AudioEngine::updateLoopCache()
+{
+    auto* rubberBand = getRubberBandNode();
+    if (rubberBand == nullptr)
+        return;
+
+    // The same values updateParameters() settles on, so the node sees them as equal
+    const float timeRatio = 1.0f / tempoRatio.load();
+    const float pitchScale = std::pow(2.0f, static_cast<float>(pitchSemitones.load()) / 12.0f);
+
+    // Only a loop that is being stretched is worth rendering offline
+    auto* audioFileSource = getFileSource();
+    if (audioFileSource == nullptr || !loopEnabled.load() || varispeedEnabled.load() || audioFileSource->isReversePlayback()
+        || (timeRatio == 1.0f && pitchScale == 1.0f))
+    {
+        rubberBand->clearLoopCache();
+        return;
+    }
+
+    rubberBand->requestLoopCache(audioFileSource->getFile(), audioFileSource->getLoopStartSeconds(),
+                                 audioFileSource->getLoopEndSeconds(), timeRatio, pitchScale);
+}
+
+SetlistPlayer* AudioEngine::getSetlistPlayer() const
+{
+    if (!processorGraph)
+        return nullptr;
+
     if (auto* node = processorGraph->getNodeForId(fileSourceNodeID))
+        return dynamic_cast<SetlistPlayer*>(node->getProcessor());
+
+    return nullptr;
+}
+
+RubberBandNode* AudioEngine::getRubberBandNode() const
+{
+    if (!processorGraph)
+        return nullptr;
+
+    if (auto* node = processorGraph->getNodeForId(rubberBandNodeID))
+        return dynamic_cast<RubberBandNode*>(node->getProcessor());
+
+    return nullptr;
+}
+
+AudioFileSource* AudioEngine::getFileSource() const
+{
+    if (auto* player = getSetlistPlayer())
+        return player->getCurrentSource();
+
+    return nullptr;
+}
+
+void AudioEngine::setDiskCacheEnabled(bool enabled)
+{
+    if (auto* player = getSetlistPlayer())
+        player->setDiskCacheEnabled(enabled);
+}
+
+void AudioEngine::clearDiskCache()
+{
+    if (auto* audioFileSource = getFileSource())
+        audioFileSource->getDiskCache().clearAll();
+}
+
+void AudioEngine::setNormalizationEnabled(bool enabled)
+{
+    normalizationEnabled.store(enabled);
+    applyNormalization();
+}
+
+void AudioEngine::setNormalizationTargetLufs(double targetLufs)
+{
+    normalizationTargetLufs.store(targetLufs);
+    applyNormalization();
+}
+
+void AudioEngine::applyNormalization()
+{
+    if (auto* player = getSetlistPlayer())
+        player->setNormalization(normalizationEnabled.load(), normalizationTargetLufs.load());
+}
+
+bool AudioEngine::getLoudness(LoudnessResult& result) const
+{
+    if (auto* audioFileSource = getFileSource())
+        return audioFileSource->getProgressiveLoader().getLoudness(result);
+
+    return false;
+}
+
+double AudioEngine::getLoadProgress() const
+{
+    if (auto* audioFileSource = getFileSource())
+        return audioFileSource->getProgressiveLoader().getProgress();
+
+    return 0.0;
+}
+
+double AudioEngine::getWaveformAvailableSeconds() const
+{
+    if (auto* audioFileSource = getFileSource())
+        return audioFileSource->getProgressiveLoader().getAvailableSeconds();
+
+    return 0.0;
+}
+
+double AudioEngine::getAnalysedSeconds() const
+{
+    if (auto* audioFileSource = getFileSource())
+        return audioFileSource->getProgressiveLoader().getAnalysedSeconds();
+
+    return 0.0;
+}
+
+double AudioEngine::getWaveformPeaks(std::vector<float>& minMaxPeaks) const
+{
+    minMaxPeaks.clear();
+
+    if (auto* audioFileSource = getFileSource())
     {
-        if (auto* audioFileSource = dynamic_cast<AudioFileSource*>(node->getProcessor()))
-        {
-            audioFileSource->setLoopEnabled(enabled);
-        }
+        const auto& loader = audioFileSource->getProgressiveLoader();
+        loader.getPeaks(minMaxPeaks);
+        return loader.getPeaksPerSecond();
     }
+
+    return 0.0;
+}
+
+double AudioEngine::getTimeToFirstSoundMilliseconds() const
+{
+    if (auto* audioFileSource = getFileSource())
+        return audioFileSource->getTimeToFirstSoundMilliseconds();
+
+    return -1.0;
 }
 
 // Getter methods for tests
@@ -251,6 +496,14 @@ bool AudioEngine::getLoopEnabled() const
     return loopEnabled.load();
 }
 
+bool AudioEngine::isPlayingStretchedLoopCache() const
+{
+    if (auto* rubberBand = getRubberBandNode())
+        return rubberBand->isPlayingLoopCache();
+
+    return false;
+}
+
 void AudioEngine::updateParameters()
 {
     // Update Rubber Band parameters if needed
@@ -258,13 +511,11 @@ void AudioEngine::updateParameters()
     float currentPitch = pitchSmoother.getNextValue();
 
     // Get the actual RubberBand node from the graph
-    if (auto* node = processorGraph->getNodeForId(rubberBandNodeID))
+    if (auto* rubberBand = getRubberBandNode())
     {
-        if (auto* rubberBand = dynamic_cast<RubberBandNode*>(node->getProcessor()))
-        {
-            rubberBand->setTimeRatio(currentTempo);
-            rubberBand->setPitchScale(std::pow(2.0f, currentPitch / 12.0f));
-        }
+        // Rubber Band's ratio is output length over input length, the inverse of tempo
+        rubberBand->setTimeRatio(1.0f / currentTempo);
+        rubberBand->setPitchScale(std::pow(2.0f, currentPitch / 12.0f));
     }
 }
 
@@ -276,6 +527,7 @@ void AudioEngine::audioDeviceIOCallback(
     int numSamples)
 {
     juce::ignoreUnused(inputChannelData, numInputChannels);
+    const auto startTicks = juce::Time::getHighResolutionTicks();
 
     // Update parameters smoothly
     updateParameters();
@@ -290,7 +542,7 @@ void AudioEngine::audioDeviceIOCallback(
         processorGraph->processBlock(buffer, midiBuffer);
         
         // Feed processed audio to analysis worker
-        if (analysisWorker && numOutputChannels > 0)
+        if (analysisWorker && numOutputChannels > 0 && !analysisPaused.load())
         {
             analysisWorker->feedAudioData(buffer.getReadPointer(0), numSamples, 
                                         juce::jmin(numOutputChannels, 2));
@@ -301,6 +553,20 @@ void AudioEngine::audioDeviceIOCallback(
         // Clear output if not playing
         buffer.clear();
     }
+
+    // Time spent against the time the device gives us, for the governor
+    const auto busyTicks = juce::Time::getHighResolutionTicks() - startTicks;
+    const auto periodTicks = static_cast<int64_t>(numSamples / sampleRate * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+
+    if (periodTicks > 0)
+    {
+        callbackBusyTicks.fetch_add(busyTicks);
+        callbackPeriodTicks.fetch_add(periodTicks);
+
+        const float load = static_cast<float>(busyTicks) / static_cast<float>(periodTicks);
+        if (load > callbackPeakLoad.load())
+            callbackPeakLoad.store(load);
+    }
 }
 
 void AudioEngine::audioDeviceAboutToStart(juce::AudioIODevice* device)
@@ -346,6 +612,14 @@ void AudioEngine::audioDeviceStopped()
 // Analysis methods
 AnalysisResult AudioEngine::getAnalysisResults() const
 {
+    // The whole-file pass sees the entire track, not just what has been played
+    if (auto* audioFileSource = getFileSource())
+    {
+        auto results = audioFileSource->getProgressiveLoader().getAnalysisResults();
+        if (results.isValid)
+            return results;
+    }
+
     if (analysisWorker)
     {
         return analysisWorker->getLatestResults();
@@ -355,8 +629,81 @@ AnalysisResult AudioEngine::getAnalysisResults() const
 
 void AudioEngine::setAnalysisEnabled(bool enabled)
 {
+    analysisRequested.store(enabled);
+    applyQualityLevel();
+}
+
+void AudioEngine::setLoadGovernorEnabled(bool enabled)
+{
+    loadGovernorEnabled = enabled;
+
+    // Off means full quality, whatever the load
+    if (!enabled && loadGovernor.getLevel() != FullQuality)
+    {
+        juce::Logger::writeToLog("AudioEngine: Load governor off, back to full quality");
+        loadGovernor.reset();
+        applyQualityLevel();
+    }
+}
+
+void AudioEngine::applyQualityLevel()
+{
+    const int level = loadGovernor.getLevel();
+
+    analysisPaused.store(level >= AnalysisPaused);
+
     if (analysisWorker)
+        analysisWorker->setAnalysisEnabled(analysisRequested.load() && level < AnalysisPaused);
+
+    if (auto* rubberBand = getRubberBandNode())
     {
-        analysisWorker->setAnalysisEnabled(enabled);
+        rubberBand->setEconomyMode(level >= EconomyStretch);
+        rubberBand->setStretchEngine(level >= WsolaStretch ? RubberBandNode::StretchEngine::Wsola : requestedStretchEngine);
     }
+
+    uiRefreshHz.store(level >= ReducedUiRefresh ? REDUCED_UI_REFRESH_HZ : FULL_UI_REFRESH_HZ);
+}
+
+void AudioEngine::timerCallback()
+{
+    // The setlist has moved on to the next song by itself, so the loop
+    // settings still describe the last one
+    if (getFileSource() != loopedFileSource)
+        resetLoopToWholeFile();
+
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    const double elapsedSeconds = (nowMs - lastGovernorPollMs) / 1000.0;
+    lastGovernorPollMs = nowMs;
+
+    // Everything since the last poll, however many callbacks that was
+    const auto busyTicks = callbackBusyTicks.exchange(0);
+    const auto periodTicks = callbackPeriodTicks.exchange(0);
+    const double peakLoad = callbackPeakLoad.exchange(0.0f);
+
+    // No callbacks (device stopped): nothing to judge
+    if (periodTicks <= 0)
+        return;
+
+    const double averageLoad = static_cast<double>(busyTicks) / static_cast<double>(periodTicks);
+    callbackLoad.store(averageLoad);
+
+    if (!loadGovernorEnabled)
+        return;
+
+    static const char* const levelNames[NUM_QUALITY_LEVELS] = {
+        "full quality", "analysis paused", "economy stretching", "WSOLA stretching", "reduced UI refresh"
+    };
+
+    const int step = loadGovernor.update(averageLoad, peakLoad, elapsedSeconds);
+    if (step == 0)
+        return;
+
+    applyQualityLevel();
+
+    juce::Logger::writeToLog("AudioEngine: Callback load " + juce::String(averageLoad * 100.0, 0) + "% (peak "
+                             + juce::String(peakLoad * 100.0, 0) + "%), stepping " + (step > 0 ? "down" : "up")
+                             + " to level " + juce::String(loadGovernor.getLevel()) + ": "
+                             + levelNames[loadGovernor.getLevel()] + " ("
+                             + juce::String(static_cast<juce::int64>(loadGovernor.getStepsDown())) + " down, "
+                             + juce::String(static_cast<juce::int64>(loadGovernor.getStepsUp())) + " up so far)");
 }
\ No newline at end of file
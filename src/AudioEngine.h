@@ -5,15 +5,19 @@
 #include <juce_audio_utils/juce_audio_utils.h>
 #include <memory>
 #include <atomic>
+#include <vector>
 
 #include "AudioFileSource.h"
+#include "SetlistPlayer.h"
 #include "RubberBandNode.h"
 #include "EQNode.h"
 #include "AnalysisWorker.h"
+#include "Utils/LoadGovernor.h"
 #include "Utils/LockFreeRingBuffer.h"
 #include "Utils/ParameterSmoother.h"
 
-class AudioEngine : public juce::AudioIODeviceCallback
+class AudioEngine : public juce::AudioIODeviceCallback,
+                    private juce::Timer
 {
 public:
     AudioEngine();
@@ -26,6 +30,13 @@ public:
     bool loadAudioFile(const juce::File& file);
     void closeAudioFile();
 
+    // Setlist: songs follow each other without a gap, the next one being
+    // loaded in the background while the current one plays. Poll
+    // getSetlistIndex() to notice when playback has moved on.
+    void setSetlist(const juce::Array<juce::File>& files);
+    bool playSetlistItem(int index);
+    int getSetlistIndex() const;
+
     // Playback control
     void play();
     void pause();
@@ -37,6 +48,27 @@ public:
     void setPitchSemitones(int semitones);
     float getTempoRatio() const;
     int getPitchSemitones() const;
+
+    // Varispeed: tempo changes speed and pitch together, like a tape deck.
+    // The time stretcher is bypassed and pitch shifting is not applied.
+    void setVarispeedEnabled(bool enabled);
+    bool getVarispeedEnabled() const { return varispeedEnabled.load(); }
+
+    // Time-stretch engine (Rubber Band, or the lighter built-in WSOLA)
+    void setStretchEngine(RubberBandNode::StretchEngine engine);
+    RubberBandNode::StretchEngine getStretchEngine() const;
+
+    // Stretch this many blocks ahead on a worker thread, so the callback
+    // does no FFT work and small device buffers hold up (0 = in the callback)
+    void setStretchLookaheadBlocks(int blocks);
+    int getStretchLookaheadBlocks() const;
+
+    // Stretcher occupancy: frames carried between blocks (stays under about
+    // one block plus one stretcher hop, plus the lookahead when threaded)
+    // and blocks it could not fill
+    int getStretchBufferedFrames() const;
+    int getStretchPeakBufferedFrames() const;
+    uint64_t getStretchStarvedBlockCount() const;
     
     // Loop control
     void setLoopInSeconds(double seconds);
@@ -45,11 +77,56 @@ public:
     double getLoopInSeconds() const;
     double getLoopOutSeconds() const;
     bool getLoopEnabled() const;
+    bool isPlayingStretchedLoopCache() const;   // Repeat passes come from the offline render
+
+    // Reverse playback (reset to forwards whenever a song is loaded)
+    void setReversePlayback(bool shouldReverse);
+    bool getReversePlayback() const;
+
+    // Decoded-PCM disk cache
+    void setDiskCacheEnabled(bool enabled);
+    void clearDiskCache();
+
+    // Loudness normalisation (EBU R128, measured during the progressive load)
+    void setNormalizationEnabled(bool enabled);
+    void setNormalizationTargetLufs(double targetLufs);
+    bool getNormalizationEnabled() const { return normalizationEnabled.load(); }
+    double getNormalizationTargetLufs() const { return normalizationTargetLufs.load(); }
+    bool getLoudness(LoudnessResult& result) const;   // False until the scan is done
+
+    // Progressive load: playback starts right away, the rest fills in behind it
+    double getLoadProgress() const;
+    double getWaveformAvailableSeconds() const;
+    double getAnalysedSeconds() const;
+    double getWaveformPeaks(std::vector<float>& minMaxPeaks) const;   // Returns peaks per second
+    double getTimeToFirstSoundMilliseconds() const;
 
     // Analysis control
     AnalysisResult getAnalysisResults() const;
     void setAnalysisEnabled(bool enabled);
 
+    // CPU governor: when the callback runs short of headroom, quality is
+    // given up a level at a time and won back once the load falls again.
+    // Each change is logged and counted. The settings above report what
+    // was asked for, not what the governor has put in place.
+    enum QualityLevel
+    {
+        FullQuality,
+        AnalysisPaused,       // Live beat tracking stops
+        EconomyStretch,       // Rubber Band without transient detection or phase locking
+        WsolaStretch,         // The built-in engine, whichever was chosen
+        ReducedUiRefresh,     // Views polling the engine slow down
+        NUM_QUALITY_LEVELS
+    };
+
+    void setLoadGovernorEnabled(bool enabled);
+    bool getLoadGovernorEnabled() const { return loadGovernorEnabled; }
+    int getQualityLevel() const { return loadGovernor.getLevel(); }
+    uint64_t getQualityStepDownCount() const { return loadGovernor.getStepsDown(); }
+    uint64_t getQualityStepUpCount() const { return loadGovernor.getStepsUp(); }
+    double getCallbackLoad() const { return callbackLoad.load(); }   // Recent average; 1 is the whole buffer period
+    int getUiRefreshHz() const { return uiRefreshHz.load(); }        // What views polling the engine should aim for
+
     // AudioIODeviceCallback implementation
     void audioDeviceIOCallback(const float* const* inputChannelData,
                               int numInputChannels,
@@ -72,7 +149,7 @@ private:
     juce::AudioProcessorGraph::NodeID eqNodeID;
 
     // Audio components
-    std::unique_ptr<AudioFileSource> fileSource;
+    std::unique_ptr<SetlistPlayer> setlistPlayer;
     std::unique_ptr<RubberBandNode> rubberBandNode;
     std::unique_ptr<EQNode> eqNode;
     std::unique_ptr<AnalysisWorker> analysisWorker;
@@ -88,6 +165,27 @@ private:
     std::atomic<bool> loopEnabled{false};
     std::atomic<double> loopInSeconds{0.0};
     std::atomic<double> loopOutSeconds{0.0};
+    std::atomic<bool> varispeedEnabled{false};
+    std::atomic<bool> normalizationEnabled{false};
+    std::atomic<double> normalizationTargetLufs{AudioFileSource::DEFAULT_NORMALIZATION_LUFS};
+    AudioFileSource* loopedFileSource = nullptr;   // The deck the loop settings were last reset for
+
+    // Load governor (message thread), fed with timings from the callback
+    static constexpr int GOVERNOR_INTERVAL_MS = 250;
+    static constexpr int FULL_UI_REFRESH_HZ = 30;
+    static constexpr int REDUCED_UI_REFRESH_HZ = 10;
+
+    LoadGovernor loadGovernor{NUM_QUALITY_LEVELS};
+    bool loadGovernorEnabled = true;
+    double lastGovernorPollMs = 0.0;
+    RubberBandNode::StretchEngine requestedStretchEngine = RubberBandNode::StretchEngine::RubberBand;
+    std::atomic<bool> analysisRequested{true};
+    std::atomic<bool> analysisPaused{false};
+    std::atomic<int64_t> callbackBusyTicks{0};
+    std::atomic<int64_t> callbackPeriodTicks{0};
+    std::atomic<float> callbackPeakLoad{0.0f};
+    std::atomic<double> callbackLoad{0.0};
+    std::atomic<int> uiRefreshHz{FULL_UI_REFRESH_HZ};
 
     // Audio processing
     double sampleRate = 44100.0;
@@ -95,6 +193,14 @@ private:
     
     void setupAudioGraph();
     void updateParameters();
+    SetlistPlayer* getSetlistPlayer() const;
+    RubberBandNode* getRubberBandNode() const;
+    AudioFileSource* getFileSource() const;   // The song that is playing
+    void resetLoopToWholeFile();
+    void updateLoopCache();   // Renders the loop offline when it is looped stretched
+    void applyNormalization();
+    void applyQualityLevel();
+    void timerCallback() override;   // Polls the governor and follows setlist song changes
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioEngine)
 };
\ No newline at end of file
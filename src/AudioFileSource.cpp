@@ -1,241 +1,493 @@
 #include "AudioFileSource.h"
 
-// Include FFmpeg headers with C linkage
-extern "C" 
+#include <algorithm>
+#include <chrono>
+
+AudioFileSource::AudioFileSource()
+    : decodeFifos{ LockFreeRingBuffer<float>(FIFO_CAPACITY_FRAMES),
+                   LockFreeRingBuffer<float>(FIFO_CAPACITY_FRAMES) },
+      spanFifo(SPAN_FIFO_CAPACITY)
 {
-    #include <libavformat/avformat.h>
-    #include <libavcodec/avcodec.h>
-    #include <libavutil/avutil.h>
-    #include <libswresample/swresample.h>
 }
 
-AudioFileSource::AudioFileSource() = default;
-
 AudioFileSource::~AudioFileSource()
 {
     closeFile();
 }
 
-bool AudioFileSource::initializeFFmpeg()
-{
-    // Initialize FFmpeg (only needed once globally, but safe to call multiple times)
-    av_register_all();
-    avcodec_register_all();
-    return true;
-}
-
 bool AudioFileSource::loadFile(const juce::File& file)
 {
     closeFile(); // Close any previously loaded file
-    
-    if (!file.exists())
-        return false;
 
-    initializeFFmpeg();
+    loadStartTicks = juce::Time::getHighResolutionTicks();
+    timeToFirstSoundMilliseconds.store(-1.0);
+    firstSoundLogged = false;
 
-    // Open input file
-    const char* filename = file.getFullPathName().toRawUTF8();
-    int ret = avformat_open_input(&formatContext, filename, nullptr, nullptr);
-    if (ret < 0)
-    {
-        juce::Logger::writeToLog("Failed to open input file: " + file.getFileName());
+    if (!openSource(file))
         return false;
-    }
 
-    // Retrieve stream information
-    ret = avformat_find_stream_info(formatContext, nullptr);
-    if (ret < 0)
-    {
-        juce::Logger::writeToLog("Failed to find stream info");
-        cleanupFFmpeg();
-        return false;
-    }
+    // Neither the decode thread nor the audio thread is touching the FIFOs
+    // yet: SetlistPlayer only ever loads the idle deck
+    pageCache.clear();
+    pageCache.resetCounters();
+    resetFifos();
+    currentPositionSeconds.store(0.0);
+    lastSeekMilliseconds.store(0.0);
+    worstSeekMilliseconds.store(0.0);
+    worstSeekDiscardedFrames.store(0);
+    normalizationGain.store(1.0f);
+    fileLoaded.store(true);
+
+    startDecoderThread();
+
+    // Index, peaks and analysis follow on their own thread
+    progressiveLoader.start(file);
+
+    juce::Logger::writeToLog("Successfully loaded: " + file.getFileName() +
+                            " (" + juce::String(totalDurationSeconds, 2) + "s, " +
+                            juce::String(static_cast<int>(sampleRate)) + "Hz, " +
+                            juce::String(numChannels) + " channels)");
 
-    // Find audio stream
-    audioStreamIndex = -1;
-    for (unsigned int i = 0; i < formatContext->nb_streams; i++)
+    return true;
+}
+
+bool AudioFileSource::openSource(const juce::File& file)
+{
+    mappedPcm = nullptr;
+    sourceFile = file;
+
+    if (decoder != nullptr)
     {
-        if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
-        {
-            audioStreamIndex = i;
-            break;
-        }
+        decoder->closeInput();
+        spareDecoder = std::move(decoder);
     }
+    playingNativePcm = false;
 
-    if (audioStreamIndex == -1)
+    // Plain PCM at the device rate needs no decoding at all. At any other
+    // rate it still goes through the decoder, which owns the resampler.
+    auto nativeReader = PcmFileReader::open(file);
+    nativePcmAvailable = nativeReader != nullptr;
+
+    if (nativeReader != nullptr && (deviceSampleRate <= 0.0 || nativeReader->getSampleRate() == deviceSampleRate))
     {
-        juce::Logger::writeToLog("No audio stream found");
-        cleanupFFmpeg();
-        return false;
+        mappedPcm = std::move(nativeReader);
+        playingNativePcm = true;
     }
 
-    if (!openCodec())
+    // The device rate is only known once prepareToPlay has run; until then
+    // frames come out at the file's own rate and nothing is cached
+    const bool useDiskCache = diskCacheEnabled.load() && deviceSampleRate > 0.0 && !nativePcmAvailable;
+
+    if (useDiskCache)
+        mappedPcm = diskCache.open(file, deviceSampleRate);
+
+    if (mappedPcm != nullptr)
     {
-        cleanupFFmpeg();
-        return false;
+        // Already decoded, by an earlier session or by whoever wrote the file:
+        // play straight from the mapping
+        sampleRate = mappedPcm->getSampleRate();
+        numChannels = mappedPcm->getSourceChannels();
+        totalDurationSeconds = static_cast<double>(mappedPcm->getLengthInFrames()) / sampleRate;
+        return true;
     }
 
-    if (!setupResampler())
-    {
-        cleanupFFmpeg();
+    // The packet scan for the seek index is left to the progressive loader,
+    // so opening only costs the header probe
+    auto newDecoder = spareDecoder != nullptr ? std::move(spareDecoder) : std::make_unique<AudioDecoder>();
+    newDecoder->setFastOpen(true);
+    newDecoder->setBuildSeekIndex(false);
+    newDecoder->setOutputSampleRate(deviceSampleRate);
+    newDecoder->setResamplerQuality(resamplerQuality.load());
+
+    if (!newDecoder->open(file))
         return false;
-    }
+
+    if (newDecoder->isLengthEstimated())
+        juce::Logger::writeToLog("AudioFileSource: Length is estimated until the file has been scanned");
 
     // Get audio properties
-    AVStream* audioStream = formatContext->streams[audioStreamIndex];
-    sampleRate = codecContext->sample_rate;
-    numChannels = codecContext->channels;
-    
-    // Calculate total duration
-    if (audioStream->duration != AV_NOPTS_VALUE)
-    {
-        totalDurationSeconds = audioStream->duration * av_q2d(audioStream->time_base);
-    }
-    else if (formatContext->duration != AV_NOPTS_VALUE)
+    sampleRate = newDecoder->getSampleRate();
+    numChannels = newDecoder->getNumChannels();
+    totalDurationSeconds = newDecoder->getLengthInSeconds();
+    decoder = std::move(newDecoder);
+
+    loopCache.setSourceFile(file);
+    loopCache.setOutputSampleRate(sampleRate);
+
+    if (useDiskCache)
+        diskCache.requestStore(file, deviceSampleRate);
+
+    return true;
+}
+
+void AudioFileSource::setOutputSampleRate(double newSampleRate)
+{
+    // Only called while the audio thread is stopped, so the FIFOs can be reset here
+    const double positionSeconds = currentPositionSeconds.load();
+    stopDecoderThread();
+
+    // A PCM file may now match the device rate and not need the decoder
+    if (decoder != nullptr && !nativePcmAvailable)
     {
-        totalDurationSeconds = formatContext->duration / static_cast<double>(AV_TIME_BASE);
+        decoder->setOutputSampleRate(newSampleRate);
+        sampleRate = decoder->getSampleRate();
+
+        loopCache.setOutputSampleRate(sampleRate);
+
+        if (diskCacheEnabled.load())
+            diskCache.requestStore(sourceFile, newSampleRate);
     }
-    else
+    else if (!openSource(sourceFile))
     {
-        totalDurationSeconds = 0.0;
+        fileLoaded.store(false);
+        return;
     }
 
-    // Allocate frame and packet
-    frame = av_frame_alloc();
-    packet = av_packet_alloc();
+    // Cached pages were decoded at the old rate
+    pageCache.clear();
+    resetFifos();
+    requestSeek(positionSeconds);
+
+    // Cached loop frames were counted at the old rate
+    setLoopPoints(loopStartSeconds.load(), loopEndSeconds.load());
 
-    if (!frame || !packet)
+    startDecoderThread();
+}
+
+void AudioFileSource::setResamplerQuality(AudioDecoder::ResamplerQuality quality)
+{
+    if (resamplerQuality.exchange(quality) == quality || !isFileLoaded() || decoder == nullptr)
+        return;
+
+    // The decoder resumes at the same frame, so the FIFOs stay valid
+    stopDecoderThread();
+    decoder->setResamplerQuality(quality);
+    startDecoderThread();
+}
+
+void AudioFileSource::closeFile()
+{
+    fileLoaded.store(false);
+    stopDecoderThread();
+    progressiveLoader.cancel();
+    loopCache.setSourceFile(juce::File());
+
+    if (decoder != nullptr)
     {
-        juce::Logger::writeToLog("Failed to allocate frame or packet");
-        cleanupFFmpeg();
-        return false;
+        decoder->closeInput();
+        spareDecoder = std::move(decoder);
     }
 
-    fileLoaded.store(true);
+    mappedPcm = nullptr;
+    playingNativePcm = false;
+    nativePcmAvailable = false;
+    totalDurationSeconds = 0.0;
     currentPositionSeconds.store(0.0);
-    
-    juce::Logger::writeToLog("Successfully loaded: " + file.getFileName() + 
-                            " (" + juce::String(totalDurationSeconds, 2) + "s, " +
-                            juce::String(static_cast<int>(sampleRate)) + "Hz, " +
-                            juce::String(numChannels) + " channels)");
-    
-    return true;
 }
 
-bool AudioFileSource::openCodec()
+bool AudioFileSource::isFileLoaded() const
 {
-    AVCodecParameters* codecParams = formatContext->streams[audioStreamIndex]->codecpar;
-    
-    // Find decoder
-    AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
-    if (!codec)
+    return fileLoaded.load();
+}
+
+void AudioFileSource::startDecoderThread()
+{
+    for (auto& channelBuffer : decodeBuffers)
+        channelBuffer.resize(static_cast<size_t>(DECODE_CHUNK_FRAMES));
+    shouldStopDecoding.store(false);
+
+    decoderThread = std::jthread([this]() { decodeAhead(); });
+}
+
+void AudioFileSource::stopDecoderThread()
+{
+    shouldStopDecoding.store(true);
+
+    if (decoderThread.joinable())
     {
-        juce::Logger::writeToLog("Unsupported codec");
-        return false;
+        decoderThread.join();
     }
+}
+
+void AudioFileSource::resetFifos()
+{
+    for (auto& fifo : decodeFifos)
+        fifo.discard();
+
+    spanFifo.discard();
 
-    // Allocate codec context
-    codecContext = avcodec_alloc_context3(codec);
-    if (!codecContext)
+    decodeHeadFrame = 0;
+    pendingSeekFrame.store(-1);
+    fifoFlushPending.store(false);
+    endOfStream.store(false);
+
+    playheadFrame = 0;
+    spanFramesRemaining = 0;
+    spanReverse = false;
+    refillingFifo = true;
+}
+
+void AudioFileSource::decodeAhead()
+{
+    while (!shouldStopDecoding.load())
     {
-        juce::Logger::writeToLog("Failed to allocate codec context");
-        return false;
+        const int64_t seekFrame = pendingSeekFrame.exchange(-1);
+        if (seekFrame >= 0)
+        {
+            decodeHeadFrame = seekFrame;
+            endOfStream.store(false);
+            fifoFlushPending.store(true);
+        }
+
+        if (decoder != nullptr && !decoder->hasSeekIndex())
+        {
+            AudioDecoder::SeekIndex index;
+            if (progressiveLoader.takeSeekIndex(index))
+                decoder->setSeekIndex(std::move(index));
+        }
+
+        updateNormalizationGain();
+
+        if (!firstSoundLogged && timeToFirstSoundMilliseconds.load() >= 0.0)
+        {
+            firstSoundLogged = true;
+            juce::Logger::writeToLog("AudioFileSource: Time to first sound "
+                                     + juce::String(timeToFirstSoundMilliseconds.load(), 1) + "ms");
+        }
+
+        // After a seek, wait for the audio thread to drop the stale audio
+        // before decoding from the new position
+        if (fifoFlushPending.load() || !fillFifo())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
     }
+}
 
-    // Copy codec parameters to context
-    int ret = avcodec_parameters_to_context(codecContext, codecParams);
-    if (ret < 0)
+void AudioFileSource::updateNormalizationGain()
+{
+    if (!normalizationEnabled.load() || !progressiveLoader.isLoudnessReady())
     {
-        juce::Logger::writeToLog("Failed to copy codec parameters");
-        return false;
+        normalizationGain.store(1.0f);
+        return;
     }
 
-    // Open codec
-    ret = avcodec_open2(codecContext, codec, nullptr);
-    if (ret < 0)
+    // Silence (or near silence) is left alone rather than boosted without limit
+    const double lufs = progressiveLoader.getIntegratedLufs();
+    if (lufs <= LoudnessMeter::ABSOLUTE_GATE_LUFS)
     {
-        juce::Logger::writeToLog("Failed to open codec");
-        return false;
+        normalizationGain.store(1.0f);
+        return;
     }
 
-    return true;
+    const double gainDb = juce::jmin(normalizationTargetLufs.load() - lufs,
+                                     NORMALIZATION_CEILING_DBTP - progressiveLoader.getTruePeakDb());
+
+    normalizationGain.store(juce::Decibels::decibelsToGain(static_cast<float>(gainDb)));
 }
 
-bool AudioFileSource::setupResampler()
+bool AudioFileSource::fillFifo()
 {
-    // Setup resampler to convert to stereo float
-    swrContext = swr_alloc_set_opts(nullptr,
-                                   AV_CH_LAYOUT_STEREO,     // Output channel layout
-                                   AV_SAMPLE_FMT_FLT,       // Output sample format
-                                   static_cast<int>(sampleRate), // Output sample rate
-                                   codecContext->channel_layout ? codecContext->channel_layout : 
-                                   (codecContext->channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO),
-                                   codecContext->sample_fmt,     // Input sample format
-                                   codecContext->sample_rate,    // Input sample rate
-                                   0, nullptr);
-
-    if (!swrContext)
+    if (decodeFifos[0].space() < static_cast<size_t>(DECODE_CHUNK_FRAMES)
+        || spanFifo.space() == 0)
     {
-        juce::Logger::writeToLog("Failed to allocate resampler context");
         return false;
     }
 
-    int ret = swr_init(swrContext);
-    if (ret < 0)
+    const bool reverse = reversePlayback.load();
+    int framesToDecode = DECODE_CHUNK_FRAMES;
+
+    // Wrap the loop here so the FIFO always holds what will actually be heard
+    const int64_t loopStartFrame = secondsToFrames(loopStartSeconds.load());
+    const int64_t loopEndFrame = secondsToFrames(loopEndSeconds.load());
+    const bool looping = loopEnabled.load() && loopEndFrame > loopStartFrame;
+
+    if (looping)
     {
-        juce::Logger::writeToLog("Failed to initialize resampler");
+        if (!reverse && decodeHeadFrame >= loopEndFrame)
+        {
+            decodeHeadFrame = loopStartFrame;
+        }
+        else if (reverse && decodeHeadFrame <= loopStartFrame)
+        {
+            decodeHeadFrame = loopEndFrame;
+        }
+
+        const int64_t framesToBoundary = reverse ? decodeHeadFrame - loopStartFrame : loopEndFrame - decodeHeadFrame;
+        framesToDecode = static_cast<int>(juce::jmin<int64_t>(framesToDecode, framesToBoundary));
+    }
+    else if (endOfStream.load())
+    {
+        return false; // Nothing more to decode until the next seek
+    }
+
+    // Backwards, the head is the end of the next chunk. The chunk itself is
+    // still decoded forwards, then reversed in place.
+    const int64_t chunkStart = reverse ? juce::jmax<int64_t>(0, decodeHeadFrame - framesToDecode) : decodeHeadFrame;
+    framesToDecode = static_cast<int>(reverse ? decodeHeadFrame - chunkStart : framesToDecode);
+
+    // Serve the loop from RAM when it is cached: no seeking and no codec work,
+    // and the wrap is sample accurate
+    const bool fromLoopCache = looping && mappedPcm == nullptr && chunkStart >= loopStartFrame
+                            && loopCache.isReadyFor(loopStartFrame, loopEndFrame);
+
+    float* channelOutputs[NUM_FIFO_CHANNELS] = { decodeBuffers[0].data(), decodeBuffers[1].data() };
+    const int framesDecoded = framesToDecode > 0 ? readSourceFrames(chunkStart, channelOutputs, framesToDecode, fromLoopCache)
+                                                 : 0;
+
+    if (framesDecoded <= 0)
+    {
+        if (looping)
+        {
+            // The loop end lies past the last decodable frame
+            decodeHeadFrame = reverse ? loopEndFrame : loopStartFrame;
+        }
+        else
+        {
+            // Backwards, running out means the start of the file has been reached
+            endOfStream.store(reverse || mappedPcm != nullptr || decoder->isEndOfStream());
+        }
+
         return false;
     }
 
+    if (reverse)
+    {
+        for (auto* channelData : channelOutputs)
+            std::reverse(channelData, channelData + framesDecoded);
+    }
+
+    // The span marker goes first so the audio thread never sees frames without one.
+    // A reversed span starts at its last frame and counts down.
+    const DecodedSpan span{ reverse ? chunkStart + framesDecoded : chunkStart, framesDecoded, reverse };
+    spanFifo.write(&span, 1);
+
+    for (int channel = 0; channel < NUM_FIFO_CHANNELS; ++channel)
+        decodeFifos[static_cast<size_t>(channel)].write(channelOutputs[channel], static_cast<size_t>(framesDecoded));
+
+    decodeHeadFrame = reverse ? chunkStart : chunkStart + framesDecoded;
     return true;
 }
 
-void AudioFileSource::closeFile()
+int AudioFileSource::readSourceFrames(int64_t frame, float* const* channelOutputs, int numFrames, bool fromLoopCache)
 {
-    fileLoaded.store(false);
-    cleanupFFmpeg();
-}
+    int framesRead = 0;
 
-void AudioFileSource::cleanupFFmpeg()
-{
-    if (frame)
+    // Pages and the loop cache hand out at most one contiguous run per call
+    while (framesRead < numFrames)
     {
-        av_frame_free(&frame);
-        frame = nullptr;
-    }
+        float* outputs[NUM_FIFO_CHANNELS] = { channelOutputs[0] + framesRead, channelOutputs[1] + framesRead };
+        const int64_t position = frame + framesRead;
+        const int framesWanted = numFrames - framesRead;
+        int framesCopied = 0;
 
-    if (packet)
-    {
-        av_packet_free(&packet);
-        packet = nullptr;
+        if (mappedPcm != nullptr)
+        {
+            // The whole file is mapped, so seeks and loop wraps are free
+            framesCopied = mappedPcm->read(position, outputs, framesWanted);
+        }
+        else if (fromLoopCache)
+        {
+            framesCopied = loopCache.read(position, outputs, framesWanted);
+        }
+        else
+        {
+            // Recently played regions come straight from the page cache
+            framesCopied = pageCache.read(position, outputs, framesWanted);
+
+            if (framesCopied == 0)
+                framesCopied = decodePage(position, outputs, framesWanted);
+        }
+
+        if (framesCopied <= 0)
+            break;
+
+        framesRead += framesCopied;
     }
 
-    if (swrContext)
+    return framesRead;
+}
+
+int AudioFileSource::decodePage(int64_t frame, float* const* channelOutputs, int numFrames)
+{
+    const int64_t pageIndex = pageCache.getPageIndex(frame);
+    const int64_t pageStart = pageCache.getPageStart(pageIndex);
+
+    // Pages are decoded whole, so only seek when playback has jumped away
+    // from where the decoder stopped
+    if (decoder->getPosition() != pageStart)
     {
-        swr_free(&swrContext);
-        swrContext = nullptr;
+        decoder->seek(pageStart);
+        recordSeekCost(decoder->getLastSeekCost());
+
+        // Only differs when the page lies beyond the last decodable frame
+        if (decoder->getPosition() != pageStart)
+            return 0;
     }
 
-    if (codecContext)
+    float* const* pageOutputs = pageCache.beginPage(pageIndex);
+    const int pageFrames = decoder->read(pageOutputs, pageCache.getPageFrames());
+    pageCache.commitPage(pageFrames);
+
+    const int offset = static_cast<int>(frame - pageStart);
+    const int framesToCopy = juce::jmin(numFrames, pageFrames - offset);
+
+    if (framesToCopy <= 0)
+        return 0;
+
+    for (int channel = 0; channel < NUM_FIFO_CHANNELS; ++channel)
     {
-        avcodec_free_context(&codecContext);
-        codecContext = nullptr;
+        juce::FloatVectorOperations::copy(channelOutputs[channel], pageOutputs[channel] + offset, framesToCopy);
     }
 
-    if (formatContext)
+    return framesToCopy;
+}
+
+void AudioFileSource::advancePlayhead(int numFrames)
+{
+    while (numFrames > 0)
     {
-        avformat_close_input(&formatContext);
-        formatContext = nullptr;
+        if (spanFramesRemaining == 0)
+        {
+            DecodedSpan span;
+            if (!spanFifo.read(&span, 1))
+                break;
+
+            playheadFrame = span.startFrame;
+            spanFramesRemaining = span.numFrames;
+            spanReverse = span.reverse;
+        }
+
+        const int64_t framesInSpan = juce::jmin<int64_t>(numFrames, spanFramesRemaining);
+        playheadFrame += spanReverse ? -framesInSpan : framesInSpan;
+        spanFramesRemaining -= framesInSpan;
+        numFrames -= static_cast<int>(framesInSpan);
     }
+}
 
-    audioStreamIndex = -1;
-    totalDurationSeconds = 0.0;
-    currentPositionSeconds.store(0.0);
+int64_t AudioFileSource::getFramesUntilLoopWrap() const
+{
+    if (!loopEnabled.load() || spanReverse || reversePlayback.load())
+        return -1;
+
+    const int64_t loopStartFrame = secondsToFrames(loopStartSeconds.load());
+    const int64_t loopEndFrame = secondsToFrames(loopEndSeconds.load());
+
+    if (loopEndFrame <= loopStartFrame || playheadFrame < loopStartFrame || playheadFrame > loopEndFrame)
+        return -1;
+
+    // Right after a wrap the playhead still reads the loop end
+    return playheadFrame == loopEndFrame ? loopEndFrame - loopStartFrame : loopEndFrame - playheadFrame;
 }
 
-bool AudioFileSource::isFileLoaded() const
+void AudioFileSource::requestSeek(double seconds)
 {
-    return fileLoaded.load();
+    pendingSeekFrame.store(secondsToFrames(seconds));
+}
+
+int64_t AudioFileSource::secondsToFrames(double seconds) const
+{
+    return static_cast<int64_t>(seconds * sampleRate);
 }
 
 void AudioFileSource::setPlaybackPosition(double positionInSeconds)
@@ -243,7 +495,7 @@ void AudioFileSource::setPlaybackPosition(double positionInSeconds)
     if (isFileLoaded())
     {
         currentPositionSeconds.store(juce::jlimit(0.0, totalDurationSeconds, positionInSeconds));
-        seekToPosition(currentPositionSeconds.load());
+        requestSeek(currentPositionSeconds.load());
     }
 }
 
@@ -254,95 +506,86 @@ double AudioFileSource::getCurrentPosition() const
 
 double AudioFileSource::getTotalLength() const
 {
+    // Header durations can be estimates; the full decode pass gives the exact length
+    if (progressiveLoader.isComplete() && progressiveLoader.getLengthSeconds() > 0.0)
+        return progressiveLoader.getLengthSeconds();
+
     return totalDurationSeconds;
 }
 
+int AudioFileSource::getFramesInFifo() const
+{
+    // Channels are written one after another, so only count complete frames
+    size_t frames = decodeFifos[0].available();
+    for (const auto& fifo : decodeFifos)
+        frames = juce::jmin(frames, fifo.available());
+
+    return static_cast<int>(frames);
+}
+
+double AudioFileSource::getBufferedSeconds() const
+{
+    return static_cast<double>(getFramesInFifo()) / sampleRate;
+}
+
+void AudioFileSource::recordSeekCost(const AudioDecoder::SeekCost& cost)
+{
+    lastSeekMilliseconds.store(cost.milliseconds);
+
+    if (cost.milliseconds > worstSeekMilliseconds.load())
+        worstSeekMilliseconds.store(cost.milliseconds);
+
+    if (cost.discardedFrames > worstSeekDiscardedFrames.load())
+        worstSeekDiscardedFrames.store(cost.discardedFrames);
+}
+
 void AudioFileSource::setLoopPoints(double startSeconds, double endSeconds)
 {
     loopStartSeconds.store(juce::jlimit(0.0, totalDurationSeconds, startSeconds));
     loopEndSeconds.store(juce::jlimit(startSeconds, totalDurationSeconds, endSeconds));
+    updateLoopCache();
 }
 
 void AudioFileSource::setLoopEnabled(bool enabled)
 {
     loopEnabled.store(enabled);
+    updateLoopCache();
 }
 
-void AudioFileSource::seekToPosition(double seconds)
+void AudioFileSource::updateLoopCache()
 {
-    if (!isFileLoaded() || !formatContext || audioStreamIndex < 0)
-        return;
+    const double startSeconds = loopStartSeconds.load();
+    const double endSeconds = loopEndSeconds.load();
 
-    AVStream* audioStream = formatContext->streams[audioStreamIndex];
-    int64_t timestamp = seconds / av_q2d(audioStream->time_base);
-    
-    int ret = av_seek_frame(formatContext, audioStreamIndex, timestamp, AVSEEK_FLAG_BACKWARD);
-    if (ret >= 0)
+    // Only a loop actually being played is worth holding in RAM; a loop
+    // spanning the whole file (the default on every load) is not one
+    const bool wholeFile = startSeconds <= 0.0 && endSeconds >= totalDurationSeconds;
+
+    if (!loopEnabled.load() || wholeFile)
     {
-        avcodec_flush_buffers(codecContext);
+        loopCache.clear();
+        return;
     }
+
+    // Decode the region once in the background so looped playback never seeks
+    if (isFileLoaded() && mappedPcm == nullptr)
+        loopCache.requestRegion(secondsToFrames(startSeconds), secondsToFrames(endSeconds));
 }
 
-int AudioFileSource::readNextFrame(float* outputBuffer, int numSamplesToRead)
+void AudioFileSource::setReversePlayback(bool shouldReverse)
 {
-    if (!isFileLoaded() || !formatContext || !codecContext)
-        return 0;
-
-    int samplesDecoded = 0;
-    
-    while (samplesDecoded < numSamplesToRead)
-    {
-        int ret = av_read_frame(formatContext, packet);
-        if (ret < 0)
-        {
-            // End of file or error
-            break;
-        }
-
-        if (packet->stream_index != audioStreamIndex)
-        {
-            av_packet_unref(packet);
-            continue;
-        }
-
-        ret = avcodec_send_packet(codecContext, packet);
-        if (ret < 0)
-        {
-            av_packet_unref(packet);
-            continue;
-        }
-
-        while (ret >= 0)
-        {
-            ret = avcodec_receive_frame(codecContext, frame);
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-                break;
-            
-            if (ret < 0)
-                break;
-
-            // Resample to stereo float
-            float* resampledData[2] = { 
-                outputBuffer + samplesDecoded * 2,       // Left channel
-                outputBuffer + samplesDecoded * 2 + 1    // Right channel (interleaved)
-            };
-
-            int outputSamples = swr_convert(swrContext, 
-                                          (uint8_t**)resampledData, 
-                                          numSamplesToRead - samplesDecoded,
-                                          (const uint8_t**)frame->data, 
-                                          frame->nb_samples);
-
-            if (outputSamples > 0)
-            {
-                samplesDecoded += outputSamples;
-            }
-        }
+    if (reversePlayback.exchange(shouldReverse) == shouldReverse || !isFileLoaded())
+        return;
 
-        av_packet_unref(packet);
-    }
+    // Audio already queued runs the old way, so restart from where we are
+    requestSeek(currentPositionSeconds.load());
+}
 
-    return samplesDecoded;
+bool AudioFileSource::isLoopRegionCached() const
+{
+    return mappedPcm != nullptr
+        || loopCache.isReadyFor(secondsToFrames(loopStartSeconds.load()),
+                                   secondsToFrames(loopEndSeconds.load()));
 }
 
 // AudioProcessor implementation
@@ -351,10 +594,19 @@ const juce::String AudioFileSource::getName() const
     return "AudioFileSource";
 }
 
-void AudioFileSource::prepareToPlay(double sampleRate, int samplesPerBlock)
+void AudioFileSource::prepareToPlay(double newSampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused(sampleRate, samplesPerBlock);
-    // Sample rate conversion is handled by FFmpeg resampler
+    // Sized here so processBlock never allocates
+    discardBuffer.assign(static_cast<size_t>(samplesPerBlock), 0.0f);
+
+    if (newSampleRate == deviceSampleRate)
+        return;
+
+    // Resampling to the device rate happens on the decode thread
+    deviceSampleRate = newSampleRate;
+
+    if (isFileLoaded())
+        setOutputSampleRate(newSampleRate);
 }
 
 void AudioFileSource::releaseResources()
@@ -365,47 +617,113 @@ void AudioFileSource::releaseResources()
 void AudioFileSource::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ignoreUnused(midiMessages);
-    
-    int numSamples = buffer.getNumSamples();
-    int numChannels = buffer.getNumChannels();
-    
+
     buffer.clear();
+    renderBlock(buffer, 0, buffer.getNumSamples());
+}
+
+int AudioFileSource::renderBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numOutputChannels = buffer.getNumChannels();
 
     if (!isFileLoaded())
-        return;
+        return 0;
 
-    // Interleaved buffer for FFmpeg
-    std::vector<float> interleavedBuffer(numSamples * 2);
-    
-    int samplesRead = readNextFrame(interleavedBuffer.data(), numSamples);
-    
-    // Convert from interleaved to JUCE buffer format
-    for (int channel = 0; channel < juce::jmin(numChannels, 2); ++channel)
+    if (fifoFlushPending.load())
     {
-        float* channelData = buffer.getWritePointer(channel);
-        
-        for (int sample = 0; sample < samplesRead; ++sample)
-        {
-            channelData[sample] = interleavedBuffer[sample * 2 + channel];
-        }
+        // The decode thread has seeked: drop audio decoded from the old position
+        for (auto& fifo : decodeFifos)
+            fifo.discard();
+
+        spanFifo.discard();
+        spanFramesRemaining = 0;
+        refillingFifo = true;
+        fifoFlushPending.store(false);
+        return 0;
     }
-    
+
+    const int framesInFifo = getFramesInFifo();
+    const int maxFrames = static_cast<int>(discardBuffer.size());
+    const int framesToRead = juce::jmin(numSamples, framesInFifo, maxFrames);
+
+    // Running dry right after a seek is expected; anywhere else it is an underrun.
+    // A block longer than the one prepared for is cut short, but not starved.
+    if (framesInFifo < numSamples && !endOfStream.load() && !refillingFifo)
+    {
+        starvedBlockCount.fetch_add(1);
+    }
+
+    if (framesToRead <= 0)
+        return 0;
+
+    refillingFifo = false;
+
+    if (timeToFirstSoundMilliseconds.load() < 0.0)
+    {
+        timeToFirstSoundMilliseconds.store(juce::Time::highResolutionTicksToSeconds(
+            juce::Time::getHighResolutionTicks() - loadStartTicks) * 1000.0);
+
+        // A new song starts at its own gain instead of ramping from the last one's
+        appliedNormalizationGain = normalizationGain.load();
+    }
+
+    // The FIFOs are planar, so each channel is copied straight into the JUCE buffer
+    for (int channel = 0; channel < NUM_FIFO_CHANNELS; ++channel)
+    {
+        float* channelData = channel < numOutputChannels ? buffer.getWritePointer(channel, startSample)
+                                                         : discardBuffer.data();
+
+        decodeFifos[static_cast<size_t>(channel)].read(channelData, static_cast<size_t>(framesToRead));
+    }
+
+    // Ramped over the block, so gain changes (normally just the one, when the
+    // loudness scan finishes) never click
+    const float targetGain = normalizationGain.load();
+
+    if (targetGain != 1.0f || appliedNormalizationGain != 1.0f)
+    {
+        for (int channel = 0; channel < juce::jmin(numOutputChannels, NUM_FIFO_CHANNELS); ++channel)
+            buffer.applyGainRamp(channel, startSample, framesToRead, appliedNormalizationGain, targetGain);
+
+        appliedNormalizationGain = targetGain;
+    }
+
     // Update position
-    double samplesAdvanced = static_cast<double>(samplesRead) / sampleRate;
-    double newPosition = currentPositionSeconds.load() + samplesAdvanced;
-    
-    // Handle looping
+    advancePlayhead(framesToRead);
+    currentPositionSeconds.store(static_cast<double>(playheadFrame) / sampleRate);
+
+    // Handle looping: the decode thread normally wraps ahead of us, but if it
+    // had already decoded past the loop end when looping was enabled, seek back
     if (loopEnabled.load())
     {
         double loopStart = loopStartSeconds.load();
         double loopEnd = loopEndSeconds.load();
-        
-        if (newPosition >= loopEnd && loopEnd > loopStart)
+
+        if (loopEnd > loopStart && !spanReverse && currentPositionSeconds.load() > loopEnd)
+        {
+            currentPositionSeconds.store(loopStart);
+            requestSeek(loopStart);
+        }
+        else if (loopEnd > loopStart && spanReverse && currentPositionSeconds.load() < loopStart)
         {
-            newPosition = loopStart;
-            seekToPosition(newPosition);
+            currentPositionSeconds.store(loopEnd);
+            requestSeek(loopEnd);
         }
     }
-    
-    currentPositionSeconds.store(newPosition);
-}
\ No newline at end of file
+
+    return framesToRead;
+}
+
+void AudioFileSource::setNormalization(bool enabled, double targetLufs)
+{
+    normalizationTargetLufs.store(targetLufs);
+    normalizationEnabled.store(enabled);
+}
+
+bool AudioFileSource::hasFinished() const
+{
+    // A pending seek or loop means more audio is on its way
+    return isFileLoaded() && endOfStream.load() && !loopEnabled.load()
+        && pendingSeekFrame.load() < 0 && !fifoFlushPending.load()
+        && getFramesInFifo() == 0;
+}
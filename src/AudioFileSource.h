@@ -2,18 +2,20 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <memory>
+#include <thread>
+#include <vector>
 
-// Forward declarations for FFmpeg types
-extern "C" 
-{
-    struct AVFormatContext;
-    struct AVCodecContext;
-    struct AVFrame;
-    struct AVPacket;
-    struct SwrContext;
-}
+#include "AudioDecoder.h"
+#include "LoopRegionCache.h"
+#include "PcmDiskCache.h"
+#include "PcmFileReader.h"
+#include "ProgressiveLoader.h"
+#include "Utils/LockFreeRingBuffer.h"
+#include "Utils/PcmPageCache.h"
 
 class AudioFileSource : public juce::AudioProcessor
 {
@@ -25,15 +27,78 @@ public:
     bool loadFile(const juce::File& file);
     void closeFile();
     bool isFileLoaded() const;
+    const juce::File& getFile() const { return sourceFile; }
+
+    // Resampling to the device rate (set by prepareToPlay)
+    void setResamplerQuality(AudioDecoder::ResamplerQuality quality);
+    AudioDecoder::ResamplerQuality getResamplerQuality() const { return resamplerQuality.load(); }
 
     // Playback control
     void setPlaybackPosition(double positionInSeconds);
     double getCurrentPosition() const;
     double getTotalLength() const;
-    
+
     // Loop control
     void setLoopPoints(double startSeconds, double endSeconds);
     void setLoopEnabled(bool enabled);
+    bool isLoopRegionCached() const;
+    double getLoopStartSeconds() const { return loopStartSeconds.load(); }
+    double getLoopEndSeconds() const { return loopEndSeconds.load(); }
+
+    // Plays backwards from the current position (and round the loop, if enabled)
+    void setReversePlayback(bool shouldReverse);
+    bool isReversePlayback() const { return reversePlayback.load(); }
+
+    // Loudness normalisation: once the loader has measured the file, it is
+    // played at targetLufs, never pushing the true peak above the ceiling
+    void setNormalization(bool enabled, double targetLufs = DEFAULT_NORMALIZATION_LUFS);
+    bool isNormalizationEnabled() const { return normalizationEnabled.load(); }
+    double getNormalizationTargetLufs() const { return normalizationTargetLufs.load(); }
+    float getNormalizationGain() const { return normalizationGain.load(); }
+
+    static constexpr double DEFAULT_NORMALIZATION_LUFS = -16.0;
+    static constexpr double NORMALIZATION_CEILING_DBTP = -1.0;
+
+    // Decoded-PCM disk cache (takes effect on the next loadFile)
+    void setDiskCacheEnabled(bool enabled) { diskCacheEnabled.store(enabled); }
+    bool isDiskCacheEnabled() const { return diskCacheEnabled.load(); }
+    bool isPlayingFromDiskCache() const { return mappedPcm != nullptr && !playingNativePcm; }
+    PcmDiskCache& getDiskCache() { return diskCache; }
+    bool isPlayingNativePcm() const { return playingNativePcm; }
+
+    // Background work on the loaded file (seek index, waveform peaks, analysis)
+    const ProgressiveLoader& getProgressiveLoader() const { return progressiveLoader; }
+
+    // Time from loadFile() to the first block with decoded audio in it, or -1
+    double getTimeToFirstSoundMilliseconds() const { return timeToFirstSoundMilliseconds.load(); }
+
+    // Recently decoded pages, so scrubbing back over them needs no decoding
+    const PcmPageCache& getPageCache() const { return pageCache; }
+
+    // Audio thread: reads up to numSamples frames into buffer at startSample,
+    // leaving the rest untouched, and returns how many were written
+    int renderBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Audio thread: true once the last frame of a non-looping file has been played
+    bool hasFinished() const;
+
+    // Audio thread: the frame after the last one rendered (the loop end,
+    // rather than the loop start, right after a wrap)
+    int64_t getPlayheadFrame() const { return playheadFrame; }
+    bool isPlayingBackwards() const { return spanReverse; }
+
+    // Audio thread: frames left before playback jumps back to the loop
+    // start, or -1 when looping is off or playback is not inside the loop
+    int64_t getFramesUntilLoopWrap() const;
+
+    // Decode-ahead diagnostics
+    uint64_t getStarvedBlockCount() const { return starvedBlockCount.load(); }
+    double getBufferedSeconds() const;
+
+    // Seek diagnostics (cost of the most recent and the most expensive seek)
+    double getLastSeekMilliseconds() const { return lastSeekMilliseconds.load(); }
+    double getWorstSeekMilliseconds() const { return worstSeekMilliseconds.load(); }
+    int64_t getWorstSeekDiscardedFrames() const { return worstSeekDiscardedFrames.load(); }
 
     // AudioProcessor overrides
     const juce::String getName() const override;
@@ -55,36 +120,115 @@ public:
     void setStateInformation(const void*, int) override {}
 
 private:
-    // FFmpeg context
-    AVFormatContext* formatContext = nullptr;
-    AVCodecContext* codecContext = nullptr;
-    SwrContext* swrContext = nullptr;
-    AVFrame* frame = nullptr;
-    AVPacket* packet = nullptr;
-    
-    int audioStreamIndex = -1;
-    
+    // Marks where a run of frames in the FIFO came from in the source file,
+    // so the audio thread can follow loop wraps and seeks exactly.
+    struct DecodedSpan
+    {
+        int64_t startFrame = 0;
+        int64_t numFrames = 0;
+        bool reverse = false;   // Frames run downwards from startFrame
+    };
+
+    static constexpr int NUM_FIFO_CHANNELS = AudioDecoder::NUM_OUTPUT_CHANNELS;
+    static constexpr int FIFO_CAPACITY_FRAMES = 32768;   // ~740ms at 44.1kHz
+    static constexpr int DECODE_CHUNK_FRAMES = 1024;
+    static constexpr int SPAN_FIFO_CAPACITY = 1024;
+
+    // Decoder (only touched by the decode thread once a file is loaded)
+    std::unique_ptr<AudioDecoder> decoder;
+    std::unique_ptr<AudioDecoder> spareDecoder;   // Closed, kept so the next file can reuse its codec
+    std::array<std::vector<float>, NUM_FIFO_CHANNELS> decodeBuffers;
+    int64_t decodeHeadFrame = 0;   // Next source frame the decode thread will queue
+
+    // Pages of recently decoded audio (decode thread only, apart from counters)
+    PcmPageCache pageCache;
+
+    // Pre-decoded copy of the loop region
+    LoopRegionCache loopCache;
+
+    // Whole-file pass that fills in behind playback
+    ProgressiveLoader progressiveLoader;
+
+    // Disk cache of decoded PCM from earlier sessions
+    PcmDiskCache diskCache;
+
+    // Memory-mapped PCM (a disk cache entry or a plain WAV/AIFF file);
+    // replaces the decoder when present
+    std::unique_ptr<MappedPcmSource> mappedPcm;
+    bool playingNativePcm = false;      // mappedPcm is the file itself
+    bool nativePcmAvailable = false;    // The file is PCM, even if resampled by the decoder
+    std::atomic<bool> diskCacheEnabled{false};
+
+    // Decode-ahead thread
+    std::jthread decoderThread;
+    std::atomic<bool> shouldStopDecoding{false};
+    std::atomic<int64_t> pendingSeekFrame{-1};
+    std::atomic<bool> fifoFlushPending{false};
+    std::atomic<bool> endOfStream{false};
+
+    // Decoded planar PCM travelling from the decode thread to the audio thread
+    std::array<LockFreeRingBuffer<float>, NUM_FIFO_CHANNELS> decodeFifos;
+    LockFreeRingBuffer<DecodedSpan> spanFifo;
+    std::atomic<uint64_t> starvedBlockCount{0};
+
+    // Seek statistics (written by the decode thread)
+    std::atomic<double> lastSeekMilliseconds{0.0};
+    std::atomic<double> worstSeekMilliseconds{0.0};
+    std::atomic<int64_t> worstSeekDiscardedFrames{0};
+
+    // Load timing
+    juce::int64 loadStartTicks = 0;
+    std::atomic<double> timeToFirstSoundMilliseconds{-1.0};
+    bool firstSoundLogged = false;   // Decode thread only
+
+    // Audio thread state
+    std::vector<float> discardBuffer;   // Sink for FIFO channels the output buffer lacks
+    int64_t playheadFrame = 0;
+    int64_t spanFramesRemaining = 0;
+    bool spanReverse = false;
+    bool refillingFifo = true;
+
     // Audio properties
-    double sampleRate = 44100.0;
+    juce::File sourceFile;
+    double sampleRate = 44100.0;         // Rate of the frames in the FIFOs
+    double deviceSampleRate = 0.0;       // 0 until prepareToPlay
+    std::atomic<AudioDecoder::ResamplerQuality> resamplerQuality{AudioDecoder::ResamplerQuality::Live};
     int numChannels = 2;
     double totalDurationSeconds = 0.0;
-    
+
     // Playback state
     std::atomic<double> currentPositionSeconds{0.0};
     std::atomic<bool> fileLoaded{false};
-    
+
     // Loop state
     std::atomic<bool> loopEnabled{false};
     std::atomic<double> loopStartSeconds{0.0};
     std::atomic<double> loopEndSeconds{0.0};
-    
+    std::atomic<bool> reversePlayback{false};
+
+    // Normalisation (gain set by the decode thread, ramped on the audio thread)
+    std::atomic<bool> normalizationEnabled{false};
+    std::atomic<double> normalizationTargetLufs{DEFAULT_NORMALIZATION_LUFS};
+    std::atomic<float> normalizationGain{1.0f};
+    float appliedNormalizationGain = 1.0f;   // Audio thread only
+
     // Internal methods
-    bool initializeFFmpeg();
-    void cleanupFFmpeg();
-    bool openCodec();
-    bool setupResampler();
-    int readNextFrame(float* outputBuffer, int numSamplesToRead);
-    void seekToPosition(double seconds);
-    
+    bool openSource(const juce::File& file);
+    void setOutputSampleRate(double newSampleRate);
+    void startDecoderThread();
+    void stopDecoderThread();
+    void decodeAhead();
+    void updateNormalizationGain();
+    bool fillFifo();
+    int readSourceFrames(int64_t frame, float* const* channelOutputs, int numFrames, bool fromLoopCache);
+    int decodePage(int64_t frame, float* const* channelOutputs, int numFrames);
+    void resetFifos();
+    int getFramesInFifo() const;
+    void recordSeekCost(const AudioDecoder::SeekCost& cost);
+    void advancePlayhead(int numFrames);
+    void requestSeek(double seconds);
+    void updateLoopCache();
+    int64_t secondsToFrames(double seconds) const;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioFileSource)
-};
\ No newline at end of file
+};
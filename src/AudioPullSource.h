@@ -0,0 +1,31 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+// Audio that a downstream processor reads on demand, as many frames as it
+// needs, instead of receiving exactly one block per callback. A time
+// stretcher consumes input at a different rate from its output, so it
+// pulls. Called from one thread at a time: the audio thread, or the
+// stretcher's lookahead worker while it is running.
+class AudioPullSource
+{
+public:
+    virtual ~AudioPullSource() = default;
+
+    // Writes up to numFrames at the start of destination; returns how many
+    // were written (fewer when the source has run dry)
+    virtual int pullAudio(juce::AudioBuffer<float>& destination, int numFrames) = 0;
+
+    // Where in the song the next pulled frame comes from, so a processor can
+    // swap in audio it rendered earlier; -1 when that is not a plain forwards
+    // position (nothing loaded, reversed, varispeed)
+    virtual int64_t getNextPullFrame() const { return -1; }
+
+    // Frames still to come before the source jumps back to its loop start,
+    // so a processor can end a pull exactly on the wrap; -1 when no wrap is
+    // coming (not looping, or not a plain forwards position)
+    virtual int getFramesUntilWrap() const { return -1; }
+
+    // Gain already applied to the pulled audio (loudness normalisation)
+    virtual float getPullGain() const { return 1.0f; }
+};
@@ -1,23 +1,13 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
-#include <juce_dsp/juce_dsp.h>
 #include <atomic>
 
-#include "Utils/ParameterSmoother.h"
+#include "Utils/ParametricEQ.h"
 
 class EQNode : public juce::AudioProcessor
 {
 public:
-    // EQ band parameters
-    struct BandParameters
-    {
-        std::atomic<float> frequency{1000.0f};
-        std::atomic<float> gain{0.0f};        // dB
-        std::atomic<float> q{0.707f};         // Q factor
-        std::atomic<bool> enabled{true};
-    };
-
     EQNode();
     ~EQNode() override;
 
@@ -54,40 +44,19 @@ public:
     void setBypassEnabled(bool bypassed);
 
 private:
-    using FilterType = juce::dsp::IIR::Filter<float>;
-    using ProcessorChain = juce::dsp::ProcessorChain<FilterType, FilterType, FilterType>;
+    // Low Shelf -> Peak -> High Shelf
+    enum Band
+    {
+        LowShelfBand = 0,
+        PeakBand = 1,
+        HighShelfBand = 2,
+        NumBands
+    };
 
-    // DSP processor chain: Low Shelf -> Peak -> High Shelf
-    ProcessorChain processorChain;
-    
-    // Band parameters
-    BandParameters lowShelf;    // Low shelf filter
-    BandParameters peak;        // Peak filter  
-    BandParameters highShelf;   // High shelf filter
-    
-    // Parameter smoothers
-    ParameterSmoother<float> lowShelfGainSmoother;
-    ParameterSmoother<float> lowShelfFreqSmoother;
-    ParameterSmoother<float> peakGainSmoother;
-    ParameterSmoother<float> peakFreqSmoother;
-    ParameterSmoother<float> peakQSmoother;
-    ParameterSmoother<float> highShelfGainSmoother;
-    ParameterSmoother<float> highShelfFreqSmoother;
+    ParametricEQ<NumBands> eq;
 
     // State
     std::atomic<bool> bypassed{false};
-    double sampleRate = 44100.0;
-    
-    // Filter indices in the processor chain
-    enum FilterIndex
-    {
-        LowShelfFilter = 0,
-        PeakFilter = 1,
-        HighShelfFilter = 2
-    };
-
-    void updateFilters();
-    void initializeFilters();
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EQNode)
 };
\ No newline at end of file
@@ -140,6 +140,12 @@ void LoopControls::setAnalysisResults(const AnalysisResult& results)
     updateButtonStates();
 }
 
+void LoopControls::setAnalysisCoverage(double analysedSeconds)
+{
+    analysisCoverageSeconds = analysedSeconds;
+    updateButtonStates();
+}
+
 void LoopControls::setTotalDuration(double durationSeconds)
 {
     totalDurationSeconds = durationSeconds;
@@ -155,6 +161,9 @@ void LoopControls::updateButtonStates()
         std::lock_guard<std::mutex> lock(analysisMutex);
         hasAnalysis = currentAnalysis.isValid && !currentAnalysis.beats.empty();
     }
+
+    // While the file is still being analysed, beats past the loop end may be missing
+    hasAnalysis = hasAnalysis && loopEndSeconds <= analysisCoverageSeconds;
     
     // Enable/disable buttons based on state
     halfLoopButton.setEnabled(hasValidLoop);
@@ -2,6 +2,7 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <functional>
+#include <limits>
 #include <vector>
 
 #include "AnalysisWorker.h"
@@ -20,6 +21,7 @@ public:
     void setLoopPoints(double startSeconds, double endSeconds);
     void setCurrentPosition(double positionSeconds);
     void setAnalysisResults(const AnalysisResult& results);
+    void setAnalysisCoverage(double analysedSeconds);   // Beats are only known up to here
     
     // Current audio position and total duration for snap calculations
     void setTotalDuration(double durationSeconds);
@@ -53,6 +55,7 @@ private:
     double loopEndSeconds = 0.0;
     double currentPositionSeconds = 0.0;
     double totalDurationSeconds = 0.0;
+    double analysisCoverageSeconds = std::numeric_limits<double>::max();
     
     // Analysis data for beat snapping
     std::mutex analysisMutex;
@@ -0,0 +1,204 @@
+#include "LoopRegionCache.h"
+
+LoopRegionCache::LoopRegionCache()
+{
+    workerThread = std::jthread([this]() { runWorker(); });
+}
+
+LoopRegionCache::~LoopRegionCache()
+{
+    // A render stops within one chunk of this
+    shouldStop.store(true);
+
+    if (workerThread.joinable())
+    {
+        workerThread.join();
+    }
+}
+
+void LoopRegionCache::setSourceFile(const juce::File& file)
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        requested.file = file;
+    }
+
+    clear();
+}
+
+void LoopRegionCache::setOutputSampleRate(double newSampleRate)
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        requested.outputSampleRate = newSampleRate;
+    }
+
+    // Cached frames are counted at the old rate
+    clear();
+}
+
+void LoopRegionCache::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        requested.startFrame = -1;
+        requested.endFrame = -1;
+        ++requestGeneration;
+    }
+
+    juce::AudioBuffer<float> released;
+
+    {
+        std::lock_guard<std::mutex> lock(regionMutex);
+        std::swap(region, released);
+        regionStart = -1;
+        regionEnd = -1;
+    }
+
+    // The old region is freed here, outside the lock
+}
+
+void LoopRegionCache::requestRegion(int64_t startFrame, int64_t endFrame)
+{
+    std::lock_guard<std::mutex> lock(requestMutex);
+
+    if (startFrame == requested.startFrame && endFrame == requested.endFrame)
+        return;
+
+    // Dragging a loop marker produces a stream of requests; only the latest
+    // matters, and the worker drops whatever it was rendering for it
+    requested.startFrame = startFrame;
+    requested.endFrame = endFrame;
+    ++requestGeneration;
+}
+
+bool LoopRegionCache::isAbandoned(uint64_t generation) const
+{
+    return shouldStop.load() || requestGeneration.load() != generation;
+}
+
+void LoopRegionCache::runWorker()
+{
+    uint64_t renderedGeneration = 0;
+
+    while (!shouldStop.load())
+    {
+        if (requestGeneration.load() == renderedGeneration)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        Request request;
+
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            request = requested;
+            renderedGeneration = requestGeneration.load();
+        }
+
+        // Let go of a file that is no longer loaded
+        if (request.file != decoderFile || request.outputSampleRate != decoderSampleRate)
+        {
+            decoder.close();
+            decoderFile = juce::File();
+        }
+
+        if (request.endFrame > request.startFrame && request.file != juce::File() && request.outputSampleRate > 0.0)
+            renderRegion(request, renderedGeneration);
+    }
+}
+
+void LoopRegionCache::renderRegion(const Request& request, uint64_t generation)
+{
+    if (!decoder.isOpen())
+    {
+        decoder.setOutputSampleRate(request.outputSampleRate);
+        decoder.setDecodeThreading(0);       // Bulk work, so use every core the codec can
+        decoder.setBuildSeekIndex(false);    // One seek per region needs no full-file scan
+
+        if (!decoder.open(request.file))
+            return;
+
+        decoderFile = request.file;
+        decoderSampleRate = request.outputSampleRate;
+    }
+
+    const int64_t lengthFrames = request.endFrame - request.startFrame;
+    const auto maxFrames = static_cast<int64_t>(MAX_REGION_SECONDS * decoder.getSampleRate());
+
+    if (lengthFrames > maxFrames)
+    {
+        juce::Logger::writeToLog("LoopRegionCache: Loop too long to cache, streaming instead");
+        return;
+    }
+
+    if (!decoder.seek(request.startFrame))
+        return;
+
+    juce::AudioBuffer<float> rendered(AudioDecoder::NUM_OUTPUT_CHANNELS, static_cast<int>(lengthFrames));
+    int framesRendered = 0;
+
+    // In bounded chunks, so a newer request takes over without a long wait
+    while (framesRendered < lengthFrames && !isAbandoned(generation))
+    {
+        float* channelOutputs[AudioDecoder::NUM_OUTPUT_CHANNELS] = {
+            rendered.getWritePointer(0, framesRendered),
+            rendered.getWritePointer(1, framesRendered)
+        };
+
+        const int framesToRead = static_cast<int>(juce::jmin<int64_t>(CHUNK_FRAMES, lengthFrames - framesRendered));
+        const int framesRead = decoder.read(channelOutputs, framesToRead);
+        if (framesRead <= 0)
+            break; // The loop end lies past the last decodable frame
+
+        framesRendered += framesRead;
+    }
+
+    // Keep only what was actually decoded
+    rendered.setSize(AudioDecoder::NUM_OUTPUT_CHANNELS, framesRendered, true);
+
+    {
+        // Checked under the lock, so a clear() that has started wins
+        std::lock_guard<std::mutex> lock(regionMutex);
+
+        if (isAbandoned(generation))
+            return;
+
+        std::swap(region, rendered);
+        regionStart = request.startFrame;
+        regionEnd = request.endFrame;
+    }
+
+    // The previous region is freed here, outside the lock
+    juce::Logger::writeToLog("LoopRegionCache: Cached " + juce::String(framesRendered) + " frames");
+}
+
+bool LoopRegionCache::isReadyFor(int64_t startFrame, int64_t endFrame) const
+{
+    std::lock_guard<std::mutex> lock(regionMutex);
+    return regionStart == startFrame && regionEnd == endFrame;
+}
+
+int LoopRegionCache::read(int64_t frame, float* const* channelOutputs, int numFrames) const
+{
+    std::lock_guard<std::mutex> lock(regionMutex);
+
+    if (regionStart < 0 || frame < regionStart)
+        return 0;
+
+    const int64_t offset = frame - regionStart;
+    const int framesToCopy = static_cast<int>(juce::jmin<int64_t>(numFrames, region.getNumSamples() - offset));
+
+    if (framesToCopy <= 0)
+        return 0;
+
+    for (int channel = 0; channel < AudioDecoder::NUM_OUTPUT_CHANNELS; ++channel)
+    {
+        juce::FloatVectorOperations::copy(channelOutputs[channel],
+                                          region.getReadPointer(channel, static_cast<int>(offset)),
+                                          framesToCopy);
+    }
+
+    return framesToCopy;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "AudioDecoder.h"
+
+// Decodes a loop region once, in the background, into a contiguous PCM buffer
+// so that looped playback needs no seeking or codec work. Rendering happens on
+// a worker thread with its own AudioDecoder, which never touches the playback
+// decoder. Requests only hand the region over to the worker, so dragging a
+// loop marker never waits for a decode.
+class LoopRegionCache
+{
+public:
+    LoopRegionCache();
+    ~LoopRegionCache();
+
+    // Source management (an empty file releases the cache's decoder)
+    void setSourceFile(const juce::File& file);
+    void setOutputSampleRate(double newSampleRate);
+
+    // Drops the cached region and abandons any render in progress
+    void clear();
+
+    // Starts rendering [startFrame, endFrame) unless it is already cached
+    void requestRegion(int64_t startFrame, int64_t endFrame);
+
+    // Region access (safe from any non-realtime thread)
+    bool isReadyFor(int64_t startFrame, int64_t endFrame) const;
+    int read(int64_t frame, float* const* channelOutputs, int numFrames) const;
+
+    static constexpr double MAX_REGION_SECONDS = 120.0;
+
+private:
+    struct Request
+    {
+        juce::File file;
+        double outputSampleRate = 0.0;   // Must match the playback decoder
+        int64_t startFrame = -1;
+        int64_t endFrame = -1;
+    };
+
+    static constexpr int CHUNK_FRAMES = 8192;   // Frames decoded between checks for a newer request
+
+    // The latest request (protected by requestMutex). Every change bumps the
+    // generation, which abandons whatever the worker is rendering.
+    mutable std::mutex requestMutex;
+    Request requested;
+    std::atomic<uint64_t> requestGeneration{0};
+
+    // Worker
+    std::jthread workerThread;
+    std::atomic<bool> shouldStop{false};
+    AudioDecoder decoder;                // Only used by the worker
+    juce::File decoderFile;              // What the decoder has open
+    double decoderSampleRate = 0.0;
+
+    // Published region (protected by mutex)
+    mutable std::mutex regionMutex;
+    juce::AudioBuffer<float> region;
+    int64_t regionStart = -1;
+    int64_t regionEnd = -1;
+
+    void runWorker();
+    void renderRegion(const Request& request, uint64_t generation);
+    bool isAbandoned(uint64_t generation) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopRegionCache)
+};
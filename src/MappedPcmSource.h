@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// Random-access PCM that needs no decoder: the decode thread copies frames
+// straight out of it, and seeking is just a different frame index. Output
+// is stereo planar float, like AudioDecoder.
+class MappedPcmSource
+{
+public:
+    virtual ~MappedPcmSource() = default;
+
+    virtual double getSampleRate() const = 0;
+    virtual int getSourceChannels() const = 0;
+    virtual int64_t getLengthInFrames() const = 0;
+
+    // Returns the number of frames copied (0 past the end)
+    virtual int read(int64_t frame, float* const* channelOutputs, int numFramesToRead) const = 0;
+};
@@ -0,0 +1,253 @@
+#include "PcmDiskCache.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+PcmDiskCache::PcmDiskCache(const juce::File& cacheDirectory)
+    : directory(cacheDirectory)
+{
+}
+
+PcmDiskCache::~PcmDiskCache()
+{
+    cancelStore();
+}
+
+juce::File PcmDiskCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("AudioPracticeLooper")
+        .getChildFile("PcmCache");
+}
+
+juce::File PcmDiskCache::getEntryFile(const juce::File& sourceFile, double sampleRate) const
+{
+    // Editing or replacing the source changes its size or mtime, and therefore its key
+    const juce::String key = sourceFile.getFullPathName()
+                           + "|" + juce::String(sourceFile.getSize())
+                           + "|" + juce::String(sourceFile.getLastModificationTime().toMilliseconds())
+                           + "|" + juce::String(static_cast<int>(sampleRate));
+
+    return directory.getChildFile(juce::String::toHexString(key.hashCode64()) + ".pcm");
+}
+
+std::unique_ptr<PcmDiskCache::MappedEntry> PcmDiskCache::open(const juce::File& sourceFile, double sampleRate)
+{
+    const juce::File entryFile = getEntryFile(sourceFile, sampleRate);
+    if (!entryFile.existsAsFile())
+        return nullptr;
+
+    auto entry = std::make_unique<MappedEntry>();
+    entry->mapping = std::make_unique<juce::MemoryMappedFile>(entryFile, juce::MemoryMappedFile::readOnly);
+
+    const auto* data = static_cast<const char*>(entry->mapping->getData());
+    const size_t size = entry->mapping->getSize();
+
+    if (data == nullptr || size < sizeof(EntryHeader))
+        return nullptr;
+
+    EntryHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    const size_t expectedSize = sizeof(EntryHeader)
+                              + static_cast<size_t>(header.numFrames) * AudioDecoder::NUM_OUTPUT_CHANNELS * sizeof(float);
+
+    if (header.magic != ENTRY_MAGIC || header.version != ENTRY_VERSION
+        || header.sampleRate != sampleRate || header.numChannels != AudioDecoder::NUM_OUTPUT_CHANNELS
+        || header.numFrames <= 0 || size < expectedSize)
+    {
+        juce::Logger::writeToLog("PcmDiskCache: Discarding invalid entry " + entryFile.getFileName());
+        entry = nullptr;
+        entryFile.deleteFile();
+        return nullptr;
+    }
+
+    entry->frames = reinterpret_cast<const float*>(data + sizeof(EntryHeader));
+    entry->sampleRate = header.sampleRate;
+    entry->sourceChannels = header.sourceChannels;
+    entry->numFrames = header.numFrames;
+
+    // Recency for LRU eviction
+    entryFile.setLastAccessTime(juce::Time::getCurrentTime());
+
+    return entry;
+}
+
+int PcmDiskCache::MappedEntry::read(int64_t frame, float* const* channelOutputs, int numFramesToRead) const
+{
+    if (frame < 0 || frame >= numFrames)
+        return 0;
+
+    const int framesToCopy = static_cast<int>(juce::jmin<int64_t>(numFramesToRead, numFrames - frame));
+    const float* source = frames + frame * AudioDecoder::NUM_OUTPUT_CHANNELS;
+
+    for (int i = 0; i < framesToCopy; ++i)
+    {
+        channelOutputs[0][i] = source[i * 2];
+        channelOutputs[1][i] = source[i * 2 + 1];
+    }
+
+    return framesToCopy;
+}
+
+void PcmDiskCache::requestStore(const juce::File& sourceFile, double sampleRate)
+{
+    cancelStore();
+
+    if (getEntryFile(sourceFile, sampleRate).existsAsFile())
+        return;
+
+    shouldCancelStore.store(false);
+    storeThread = std::jthread([this, sourceFile, sampleRate]() { storeEntry(sourceFile, sampleRate); });
+}
+
+void PcmDiskCache::cancelStore()
+{
+    shouldCancelStore.store(true);
+
+    if (storeThread.joinable())
+    {
+        storeThread.join();
+    }
+}
+
+void PcmDiskCache::storeEntry(const juce::File& sourceFile, double sampleRate)
+{
+    // Nothing is waiting on this, so spend the extra time on a better filter
+    AudioDecoder decoder;
+    decoder.setOutputSampleRate(sampleRate);
+    decoder.setResamplerQuality(AudioDecoder::ResamplerQuality::High);
+    decoder.setDecodeThreading(0);
+
+    if (!decoder.open(sourceFile))
+        return;
+
+    const int64_t estimatedBytes = decoder.getLengthInFrames() * AudioDecoder::NUM_OUTPUT_CHANNELS
+                                 * static_cast<int64_t>(sizeof(float));
+
+    if (estimatedBytes > maxSizeBytes.load())
+    {
+        juce::Logger::writeToLog("PcmDiskCache: " + sourceFile.getFileName() + " is larger than the cache");
+        return;
+    }
+
+    if (!directory.createDirectory())
+        return;
+
+    // Written under a temporary name so a half-written entry is never opened
+    const juce::File entryFile = getEntryFile(sourceFile, sampleRate);
+    const juce::File partialFile = entryFile.withFileExtension("partial");
+
+    bool completed = false;
+    {
+        juce::FileOutputStream stream(partialFile);
+        if (!stream.openedOk())
+            return;
+
+        stream.setPosition(0);
+        stream.truncate();
+
+        EntryHeader header;
+        header.magic = ENTRY_MAGIC;
+        header.version = ENTRY_VERSION;
+        header.sampleRate = decoder.getSampleRate();
+        header.sourceChannels = decoder.getNumChannels();
+        header.numChannels = AudioDecoder::NUM_OUTPUT_CHANNELS;
+        stream.write(&header, sizeof(header));
+
+        std::vector<float> left(STORE_CHUNK_FRAMES), right(STORE_CHUNK_FRAMES);
+        std::vector<float> interleaved(STORE_CHUNK_FRAMES * AudioDecoder::NUM_OUTPUT_CHANNELS);
+        float* channelOutputs[AudioDecoder::NUM_OUTPUT_CHANNELS] = { left.data(), right.data() };
+
+        while (!shouldCancelStore.load())
+        {
+            const int framesRead = decoder.read(channelOutputs, STORE_CHUNK_FRAMES);
+            if (framesRead <= 0)
+            {
+                completed = decoder.isEndOfStream();
+                break;
+            }
+
+            for (int i = 0; i < framesRead; ++i)
+            {
+                interleaved[static_cast<size_t>(i * 2)] = left[static_cast<size_t>(i)];
+                interleaved[static_cast<size_t>(i * 2 + 1)] = right[static_cast<size_t>(i)];
+            }
+
+            if (!stream.write(interleaved.data(), static_cast<size_t>(framesRead) * 2 * sizeof(float)))
+                break;
+
+            header.numFrames += framesRead;
+        }
+
+        // The frame count is only known once decoding has finished
+        completed = completed && header.numFrames > 0
+                 && stream.setPosition(0) && stream.write(&header, sizeof(header));
+        stream.flush();
+    }
+
+    if (!completed || !partialFile.moveFileTo(entryFile))
+    {
+        partialFile.deleteFile();
+        return;
+    }
+
+    juce::Logger::writeToLog("PcmDiskCache: Cached " + sourceFile.getFileName());
+    enforceSizeLimit();
+}
+
+void PcmDiskCache::invalidate(const juce::File& sourceFile, double sampleRate)
+{
+    getEntryFile(sourceFile, sampleRate).deleteFile();
+}
+
+void PcmDiskCache::clearAll()
+{
+    cancelStore();
+
+    for (const auto& entryFile : directory.findChildFiles(juce::File::findFiles, false, "*.pcm"))
+        entryFile.deleteFile();
+}
+
+void PcmDiskCache::setMaxSizeBytes(int64_t bytes)
+{
+    maxSizeBytes.store(juce::jmax<int64_t>(0, bytes));
+    enforceSizeLimit();
+}
+
+int64_t PcmDiskCache::getTotalSizeBytes() const
+{
+    int64_t totalBytes = 0;
+
+    for (const auto& entryFile : directory.findChildFiles(juce::File::findFiles, false, "*.pcm"))
+        totalBytes += entryFile.getSize();
+
+    return totalBytes;
+}
+
+void PcmDiskCache::enforceSizeLimit()
+{
+    auto entryFiles = directory.findChildFiles(juce::File::findFiles, false, "*.pcm");
+
+    // Least recently opened first
+    std::sort(entryFiles.begin(), entryFiles.end(),
+              [](const juce::File& a, const juce::File& b)
+              {
+                  return a.getLastAccessTime().toMilliseconds() < b.getLastAccessTime().toMilliseconds();
+              });
+
+    int64_t totalBytes = 0;
+    for (const auto& entryFile : entryFiles)
+        totalBytes += entryFile.getSize();
+
+    for (const auto& entryFile : entryFiles)
+    {
+        if (totalBytes <= maxSizeBytes.load())
+            break;
+
+        // An entry that is mapped right now may refuse to go on some platforms
+        const int64_t entryBytes = entryFile.getSize();
+        if (entryFile.deleteFile())
+            totalBytes -= entryBytes;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "AudioDecoder.h"
+#include "MappedPcmSource.h"
+
+// Persistent cache of fully decoded PCM. Entries are keyed by the source
+// file's path, size and modification time, written in the background on
+// first load and memory-mapped on later loads so no decoding is needed.
+// The cache directory is kept under a size cap by evicting the least
+// recently opened entries.
+class PcmDiskCache
+{
+public:
+    explicit PcmDiskCache(const juce::File& cacheDirectory = getDefaultDirectory());
+    ~PcmDiskCache();
+
+    // Read-only view of a cached file, interleaved stereo float
+    class MappedEntry : public MappedPcmSource
+    {
+    public:
+        double getSampleRate() const override { return sampleRate; }
+        int getSourceChannels() const override { return sourceChannels; }
+        int64_t getLengthInFrames() const override { return numFrames; }
+
+        int read(int64_t frame, float* const* channelOutputs, int numFramesToRead) const override;
+
+    private:
+        friend class PcmDiskCache;
+
+        std::unique_ptr<juce::MemoryMappedFile> mapping;
+        const float* frames = nullptr;
+        double sampleRate = 44100.0;
+        int sourceChannels = 2;
+        int64_t numFrames = 0;
+    };
+
+    // Entries are stored per output rate. Returns nullptr if there is no valid entry.
+    std::unique_ptr<MappedEntry> open(const juce::File& sourceFile, double sampleRate);
+
+    // Decodes the file into a new entry on a background thread, with high-quality resampling
+    void requestStore(const juce::File& sourceFile, double sampleRate);
+    void cancelStore();
+
+    // Cache management
+    void invalidate(const juce::File& sourceFile, double sampleRate);
+    void clearAll();
+    void setMaxSizeBytes(int64_t bytes);
+    int64_t getMaxSizeBytes() const { return maxSizeBytes.load(); }
+    int64_t getTotalSizeBytes() const;
+
+    static juce::File getDefaultDirectory();
+
+    static constexpr int64_t DEFAULT_MAX_SIZE_BYTES = 4LL * 1024 * 1024 * 1024;
+
+private:
+    // Fixed-size header at the start of every entry, followed by the frames
+    struct EntryHeader
+    {
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        double sampleRate = 0.0;
+        int32_t sourceChannels = 0;
+        int32_t numChannels = 0;
+        int64_t numFrames = 0;
+        uint8_t reserved[32] = {};
+    };
+
+    static_assert(sizeof(EntryHeader) == 64, "Entry header must keep the frames aligned");
+
+    static constexpr uint32_t ENTRY_MAGIC = 0x4d435050;   // "PPCM"
+    static constexpr uint32_t ENTRY_VERSION = 1;
+    static constexpr int STORE_CHUNK_FRAMES = 8192;
+
+    juce::File directory;
+    std::atomic<int64_t> maxSizeBytes{DEFAULT_MAX_SIZE_BYTES};
+
+    // Background store
+    std::jthread storeThread;
+    std::atomic<bool> shouldCancelStore{false};
+
+    juce::File getEntryFile(const juce::File& sourceFile, double sampleRate) const;
+    void storeEntry(const juce::File& sourceFile, double sampleRate);
+    void enforceSizeLimit();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PcmDiskCache)
+};
@@ -0,0 +1,360 @@
+#include "PcmFileReader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Header fields; chunk sizes in WAV are little-endian, in AIFF big-endian
+    uint16_t readLE16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+    uint32_t readLE32(const uint8_t* p) { return static_cast<uint32_t>(readLE16(p)) | (static_cast<uint32_t>(readLE16(p + 2)) << 16); }
+    uint64_t readLE64(const uint8_t* p) { return static_cast<uint64_t>(readLE32(p)) | (static_cast<uint64_t>(readLE32(p + 4)) << 32); }
+    uint16_t readBE16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+    uint32_t readBE32(const uint8_t* p) { return (static_cast<uint32_t>(readBE16(p)) << 16) | readBE16(p + 2); }
+
+    bool hasTag(const uint8_t* p, const char* tag) { return std::memcmp(p, tag, 4) == 0; }
+
+    // AIFF stores its sample rate as an 80-bit IEEE extended float
+    double readExtended(const uint8_t* p)
+    {
+        const int exponent = ((p[0] & 0x7f) << 8) | p[1];
+        uint64_t mantissa = 0;
+        for (int i = 0; i < 8; ++i)
+            mantissa = (mantissa << 8) | p[2 + i];
+
+        if (exponent == 0 && mantissa == 0)
+            return 0.0;
+
+        const double value = std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+        return (p[0] & 0x80) != 0 ? -value : value;
+    }
+
+    // Sample loaders. Fixed-size memcpy loads compile to plain moves, which
+    // keeps the conversion loops below simple enough to auto-vectorise.
+    template <bool BigEndian>
+    struct Int16Sample
+    {
+        static constexpr int bytes = 2;
+        static float load(const uint8_t* p)
+        {
+            uint16_t raw;
+            std::memcpy(&raw, p, sizeof(raw));
+            if constexpr (BigEndian)
+                raw = static_cast<uint16_t>((raw >> 8) | (raw << 8));
+            return static_cast<float>(static_cast<int16_t>(raw)) * (1.0f / 32768.0f);
+        }
+    };
+
+    template <bool BigEndian>
+    struct Int24Sample
+    {
+        static constexpr int bytes = 3;
+        static float load(const uint8_t* p)
+        {
+            // Assemble into the top of an int32 so the sign comes for free
+            const uint32_t raw = BigEndian
+                ? (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8)
+                : (static_cast<uint32_t>(p[2]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[0]) << 8);
+            return static_cast<float>(static_cast<int32_t>(raw)) * (1.0f / 2147483648.0f);
+        }
+    };
+
+    template <bool BigEndian>
+    struct Int32Sample
+    {
+        static constexpr int bytes = 4;
+        static float load(const uint8_t* p)
+        {
+            juce::uint32 raw;
+            std::memcpy(&raw, p, sizeof(raw));
+            if constexpr (BigEndian)
+                raw = juce::ByteOrder::swap(raw);
+            return static_cast<float>(static_cast<int32_t>(raw)) * (1.0f / 2147483648.0f);
+        }
+    };
+
+    template <bool BigEndian>
+    struct Float32Sample
+    {
+        static constexpr int bytes = 4;
+        static float load(const uint8_t* p)
+        {
+            juce::uint32 raw;
+            std::memcpy(&raw, p, sizeof(raw));
+            if constexpr (BigEndian)
+                raw = juce::ByteOrder::swap(raw);
+            float value;
+            std::memcpy(&value, &raw, sizeof(value));
+            return value;
+        }
+    };
+
+    template <bool BigEndian>
+    struct Float64Sample
+    {
+        static constexpr int bytes = 8;
+        static float load(const uint8_t* p)
+        {
+            juce::uint64 raw;   // JUCE's own type, so the swap overload is unambiguous
+            std::memcpy(&raw, p, sizeof(raw));
+            if constexpr (BigEndian)
+                raw = juce::ByteOrder::swap(raw);
+            double value;
+            std::memcpy(&value, &raw, sizeof(value));
+            return static_cast<float>(value);
+        }
+    };
+
+    // Deinterleaves to stereo planar float. The frame stride is a compile-time
+    // constant in each branch, which is what lets the compiler vectorise.
+    template <typename Sample>
+    void convert(const uint8_t* source, int numChannels, float* left, float* right, int numFrames)
+    {
+        if (numChannels == 1)
+        {
+            for (int i = 0; i < numFrames; ++i)
+                left[i] = Sample::load(source + i * Sample::bytes);
+
+            std::copy(left, left + numFrames, right);
+        }
+        else
+        {
+            for (int i = 0; i < numFrames; ++i)
+            {
+                left[i] = Sample::load(source + i * 2 * Sample::bytes);
+                right[i] = Sample::load(source + i * 2 * Sample::bytes + Sample::bytes);
+            }
+        }
+    }
+
+    template <template <bool> class Sample>
+    void convert(bool bigEndian, const uint8_t* source, int numChannels, float* left, float* right, int numFrames)
+    {
+        if (bigEndian)
+            convert<Sample<true>>(source, numChannels, left, right, numFrames);
+        else
+            convert<Sample<false>>(source, numChannels, left, right, numFrames);
+    }
+
+    constexpr uint16_t WAVE_FORMAT_PCM = 0x0001;
+    constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+    constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xfffe;
+}
+
+std::unique_ptr<PcmFileReader> PcmFileReader::open(const juce::File& file)
+{
+    // Cheap extension check first so compressed files never get mapped
+    if (!file.hasFileExtension("wav;wave;aif;aiff;aifc;rf64;bwf"))
+        return nullptr;
+
+    std::unique_ptr<PcmFileReader> reader(new PcmFileReader());
+    reader->mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+    const auto* data = static_cast<const uint8_t*>(reader->mapping->getData());
+    const size_t size = reader->mapping->getSize();
+
+    if (data == nullptr || size < 12)
+        return nullptr;
+
+    bool parsed = false;
+
+    if (hasTag(data, "RIFF") && hasTag(data + 8, "WAVE"))
+        parsed = reader->parseWave(data, size, false);
+    else if ((hasTag(data, "RF64") || hasTag(data, "BW64")) && hasTag(data + 8, "WAVE"))
+        parsed = reader->parseWave(data, size, true);
+    else if (hasTag(data, "FORM") && hasTag(data + 8, "AIFF"))
+        parsed = reader->parseAiff(data, size, false);
+    else if (hasTag(data, "FORM") && hasTag(data + 8, "AIFC"))
+        parsed = reader->parseAiff(data, size, true);
+
+    if (!parsed || reader->numFrames <= 0 || reader->sampleRate <= 0.0)
+        return nullptr;
+
+    return reader;
+}
+
+bool PcmFileReader::parseWave(const uint8_t* file, size_t size, bool isRf64)
+{
+    uint64_t rf64DataSize = 0;
+    bool haveFormat = false;
+    size_t position = 12;
+
+    while (position + 8 <= size)
+    {
+        const uint8_t* chunk = file + position;
+        const uint64_t chunkSize = readLE32(chunk + 4);
+        const uint8_t* body = chunk + 8;
+        const size_t bodyAvailable = size - position - 8;
+
+        if (hasTag(chunk, "ds64") && chunkSize >= 16 && bodyAvailable >= 16)
+        {
+            // RF64 keeps the real 64-bit sizes here and 0xFFFFFFFF in the chunk headers
+            rf64DataSize = readLE64(body + 8);
+        }
+        else if (hasTag(chunk, "fmt ") && chunkSize >= 16 && bodyAvailable >= 16)
+        {
+            uint16_t formatTag = readLE16(body);
+            numChannels = readLE16(body + 2);
+            sampleRate = static_cast<double>(readLE32(body + 4));
+            const int blockAlign = readLE16(body + 12);
+            const int bitsPerSample = readLE16(body + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE carries the real format in the subformat GUID
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 40 && bodyAvailable >= 40)
+                formatTag = readLE16(body + 24);
+
+            if (formatTag != WAVE_FORMAT_PCM && formatTag != WAVE_FORMAT_IEEE_FLOAT)
+                return false;
+
+            if (!setFormat(bitsPerSample, formatTag == WAVE_FORMAT_IEEE_FLOAT) || blockAlign != bytesPerFrame)
+                return false;
+
+            bigEndian = false;
+            haveFormat = true;
+        }
+        else if (hasTag(chunk, "data"))
+        {
+            if (!haveFormat)
+                return false;
+
+            uint64_t dataSize = chunkSize;
+            if (isRf64 && chunkSize == 0xffffffff)
+                dataSize = rf64DataSize;
+
+            // Files still being written (or truncated) claim more than they hold
+            dataSize = std::min<uint64_t>(dataSize, bodyAvailable);
+
+            samples = body;
+            numFrames = static_cast<int64_t>(dataSize / static_cast<uint64_t>(bytesPerFrame));
+            return true;
+        }
+
+        if (isRf64 && chunkSize == 0xffffffff)
+            return false;
+
+        // Chunks are padded to an even length
+        position += 8 + static_cast<size_t>(chunkSize) + (chunkSize & 1);
+    }
+
+    return false;
+}
+
+bool PcmFileReader::parseAiff(const uint8_t* file, size_t size, bool isAifc)
+{
+    bool haveFormat = false;
+    bool littleEndianSamples = false;
+    int64_t declaredFrames = 0;
+    size_t position = 12;
+
+    while (position + 8 <= size)
+    {
+        const uint8_t* chunk = file + position;
+        const uint32_t chunkSize = readBE32(chunk + 4);
+        const uint8_t* body = chunk + 8;
+        const size_t bodyAvailable = size - position - 8;
+
+        if (hasTag(chunk, "COMM") && chunkSize >= 18 && bodyAvailable >= 18)
+        {
+            numChannels = readBE16(body);
+            declaredFrames = readBE32(body + 2);
+            int bitsPerSample = readBE16(body + 6);
+            sampleRate = readExtended(body + 8);
+
+            bool isFloat = false;
+
+            if (isAifc)
+            {
+                if (chunkSize < 22 || bodyAvailable < 22)
+                    return false;
+
+                // Only the uncompressed AIFC variants; the rest go to FFmpeg
+                const uint8_t* compression = body + 18;
+                if (hasTag(compression, "sowt"))
+                    littleEndianSamples = true;
+                else if (hasTag(compression, "fl32") || hasTag(compression, "FL32"))
+                {
+                    isFloat = true;
+                    bitsPerSample = 32;
+                }
+                else if (hasTag(compression, "fl64") || hasTag(compression, "FL64"))
+                {
+                    isFloat = true;
+                    bitsPerSample = 64;
+                }
+                else if (!hasTag(compression, "NONE"))
+                    return false;
+            }
+
+            if (!setFormat(bitsPerSample, isFloat))
+                return false;
+
+            bigEndian = !littleEndianSamples;
+            haveFormat = true;
+        }
+        else if (hasTag(chunk, "SSND") && bodyAvailable >= 8)
+        {
+            if (!haveFormat)
+                return false;
+
+            const uint32_t offset = readBE32(body);
+            const uint64_t dataSize = std::min<uint64_t>(chunkSize, bodyAvailable);
+
+            if (dataSize < 8 + static_cast<uint64_t>(offset))
+                return false;
+
+            samples = body + 8 + offset;
+            numFrames = std::min<int64_t>(declaredFrames,
+                                          static_cast<int64_t>((dataSize - 8 - offset) / static_cast<uint64_t>(bytesPerFrame)));
+            return true;
+        }
+
+        position += 8 + static_cast<size_t>(chunkSize) + (chunkSize & 1);
+    }
+
+    return false;
+}
+
+bool PcmFileReader::setFormat(int bitsPerSample, bool isFloat)
+{
+    if (numChannels < 1 || numChannels > 2)
+        return false;
+
+    if (isFloat && bitsPerSample == 32)
+        format = SampleFormat::Float32;
+    else if (isFloat && bitsPerSample == 64)
+        format = SampleFormat::Float64;
+    else if (!isFloat && bitsPerSample == 16)
+        format = SampleFormat::Int16;
+    else if (!isFloat && bitsPerSample == 24)
+        format = SampleFormat::Int24;
+    else if (!isFloat && bitsPerSample == 32)
+        format = SampleFormat::Int32;
+    else
+        return false;
+
+    bytesPerSample = bitsPerSample / 8;
+    bytesPerFrame = bytesPerSample * numChannels;
+    return true;
+}
+
+int PcmFileReader::read(int64_t frame, float* const* channelOutputs, int numFramesToRead) const
+{
+    if (frame < 0 || frame >= numFrames)
+        return 0;
+
+    const int framesToCopy = static_cast<int>(juce::jmin<int64_t>(numFramesToRead, numFrames - frame));
+    const uint8_t* source = samples + frame * bytesPerFrame;
+    float* left = channelOutputs[0];
+    float* right = channelOutputs[1];
+
+    switch (format)
+    {
+        case SampleFormat::Int16:   convert<Int16Sample>(bigEndian, source, numChannels, left, right, framesToCopy); break;
+        case SampleFormat::Int24:   convert<Int24Sample>(bigEndian, source, numChannels, left, right, framesToCopy); break;
+        case SampleFormat::Int32:   convert<Int32Sample>(bigEndian, source, numChannels, left, right, framesToCopy); break;
+        case SampleFormat::Float32: convert<Float32Sample>(bigEndian, source, numChannels, left, right, framesToCopy); break;
+        case SampleFormat::Float64: convert<Float64Sample>(bigEndian, source, numChannels, left, right, framesToCopy); break;
+    }
+
+    return framesToCopy;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <memory>
+
+#include "MappedPcmSource.h"
+
+// Plays uncompressed PCM WAV, RF64 and AIFF/AIFC files straight from a memory
+// mapping instead of going through FFmpeg. Samples are converted to float as
+// they are read, so a seek is just a different frame offset into the data chunk.
+// Only mono and stereo files are accepted; anything else is left to AudioDecoder.
+class PcmFileReader : public MappedPcmSource
+{
+public:
+    // Returns nullptr if the file is not PCM this reader understands
+    static std::unique_ptr<PcmFileReader> open(const juce::File& file);
+
+    double getSampleRate() const override { return sampleRate; }
+    int getSourceChannels() const override { return numChannels; }
+    int64_t getLengthInFrames() const override { return numFrames; }
+
+    int read(int64_t frame, float* const* channelOutputs, int numFramesToRead) const override;
+
+    enum class SampleFormat
+    {
+        Int16,
+        Int24,
+        Int32,
+        Float32,
+        Float64
+    };
+
+    SampleFormat getSampleFormat() const { return format; }
+
+private:
+    PcmFileReader() = default;
+
+    bool parseWave(const uint8_t* file, size_t size, bool isRf64);
+    bool parseAiff(const uint8_t* file, size_t size, bool isAifc);
+    bool setFormat(int bitsPerSample, bool isFloat);
+
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    const uint8_t* samples = nullptr;   // Start of the sample data inside the mapping
+
+    SampleFormat format = SampleFormat::Int16;
+    bool bigEndian = false;
+    int numChannels = 0;
+    int bytesPerSample = 0;
+    int bytesPerFrame = 0;
+    double sampleRate = 0.0;
+    int64_t numFrames = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PcmFileReader)
+};
@@ -0,0 +1,234 @@
+#include "ProgressiveLoader.h"
+#include <chrono>
+
+ProgressiveLoader::ProgressiveLoader() = default;
+
+ProgressiveLoader::~ProgressiveLoader()
+{
+    cancel();
+}
+
+void ProgressiveLoader::start(const juce::File& file)
+{
+    cancel();
+
+    {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        seekIndex.clear();
+        peaks.clear();
+        loudness = LoudnessResult{};
+    }
+
+    seekIndexReady.store(false);
+    loudnessReady.store(false);
+    integratedLufs.store(LoudnessMeter::ABSOLUTE_GATE_LUFS);
+    truePeakDb.store(-100.0);
+    complete.store(false);
+    lengthSeconds.store(0.0);
+    availableSeconds.store(0.0);
+    peaksPerSecond.store(0.0);
+
+    shouldCancel.store(false);
+    loaderThread = std::jthread([this, file]() { run(file); });
+}
+
+void ProgressiveLoader::cancel()
+{
+    shouldCancel.store(true);
+
+    if (loaderThread.joinable())
+    {
+        loaderThread.join();
+    }
+
+    analysisWorker.stop();
+    decoder.close();
+}
+
+void ProgressiveLoader::run(const juce::File& file)
+{
+    // Output at the file's own rate: nothing here is played back
+    decoder.setDecodeThreading(0);
+
+    if (!decoder.open(file))
+    {
+        complete.store(true);
+        return;
+    }
+
+    const double sampleRate = decoder.getSampleRate();
+    lengthSeconds.store(decoder.getLengthInSeconds());
+    peaksPerSecond.store(sampleRate / FRAMES_PER_PEAK);
+
+    // open() has just scanned the packets, so the index is available first
+    {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        seekIndex = decoder.getSeekIndex();
+        peaks.reserve(static_cast<size_t>(decoder.getLengthInFrames() / FRAMES_PER_PEAK + 1) * 2);
+    }
+    seekIndexReady.store(true);
+
+    analysisWorker.start(sampleRate);
+
+    // Loudness only changes when the file does, so a cached scan is used as is
+    LoudnessResult cachedLoudness;
+    const bool measureLoudness = !analysisCache.loadLoudness(file, cachedLoudness);
+
+    if (measureLoudness)
+        loudnessMeter.reset(sampleRate);
+    else
+        setLoudness(std::move(cachedLoudness));
+
+    std::vector<float> left(CHUNK_FRAMES), right(CHUNK_FRAMES), mono(ANALYSIS_HOP_FRAMES);
+    float* channelOutputs[AudioDecoder::NUM_OUTPUT_CHANNELS] = { left.data(), right.data() };
+
+    int64_t framesDone = 0;
+    float peakMin = 0.0f, peakMax = 0.0f;
+    int framesInPeak = 0;
+    std::vector<float> newPeaks;
+    newPeaks.reserve(static_cast<size_t>(CHUNK_FRAMES / FRAMES_PER_PEAK + 1) * 2);
+
+    while (!shouldCancel.load())
+    {
+        const int framesRead = decoder.read(channelOutputs, CHUNK_FRAMES);
+        if (framesRead <= 0)
+            break;
+
+        // Mono min/max per peak, matching what WaveformView draws
+        newPeaks.clear();
+        for (int i = 0; i < framesRead; ++i)
+        {
+            const float sample = 0.5f * (left[static_cast<size_t>(i)] + right[static_cast<size_t>(i)]);
+            peakMin = juce::jmin(peakMin, sample);
+            peakMax = juce::jmax(peakMax, sample);
+
+            if (++framesInPeak == FRAMES_PER_PEAK)
+            {
+                newPeaks.push_back(peakMin);
+                newPeaks.push_back(peakMax);
+                peakMin = peakMax = 0.0f;
+                framesInPeak = 0;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            peaks.insert(peaks.end(), newPeaks.begin(), newPeaks.end());
+        }
+
+        feedAnalysis(left.data(), right.data(), framesRead, mono);
+
+        if (measureLoudness)
+            loudnessMeter.process(left.data(), right.data(), framesRead);
+
+        framesDone += framesRead;
+        availableSeconds.store(static_cast<double>(framesDone) / sampleRate);
+    }
+
+    if (!shouldCancel.load())
+    {
+        if (framesInPeak > 0)
+        {
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            peaks.push_back(peakMin);
+            peaks.push_back(peakMax);
+        }
+
+        // The decoded length is exact even when the header was not
+        lengthSeconds.store(static_cast<double>(framesDone) / sampleRate);
+
+        if (measureLoudness)
+        {
+            auto result = loudnessMeter.getResult();
+            analysisCache.storeLoudness(file, result);
+            setLoudness(std::move(result));
+        }
+
+        complete.store(true);
+
+        juce::Logger::writeToLog("ProgressiveLoader: Finished " + file.getFileName());
+    }
+}
+
+void ProgressiveLoader::setLoudness(LoudnessResult result)
+{
+    integratedLufs.store(result.integratedLufs);
+    truePeakDb.store(result.truePeakDb);
+
+    {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        loudness = std::move(result);
+    }
+
+    loudnessReady.store(true);
+}
+
+void ProgressiveLoader::feedAnalysis(const float* left, const float* right, int numFrames, std::vector<float>& mono)
+{
+    for (int offset = 0; offset < numFrames; offset += ANALYSIS_HOP_FRAMES)
+    {
+        const int hopFrames = juce::jmin(ANALYSIS_HOP_FRAMES, numFrames - offset);
+
+        for (int i = 0; i < hopFrames; ++i)
+            mono[static_cast<size_t>(i)] = 0.5f * (left[offset + i] + right[offset + i]);
+
+        // The analyser runs slower than the decoder, so wait rather than drop audio
+        while (!analysisWorker.canAcceptSamples(hopFrames) && !shouldCancel.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        analysisWorker.feedAudioData(mono.data(), hopFrames, 1);
+    }
+}
+
+double ProgressiveLoader::getProgress() const
+{
+    if (complete.load())
+        return 1.0;
+
+    const double length = lengthSeconds.load();
+    return length > 0.0 ? juce::jlimit(0.0, 1.0, availableSeconds.load() / length) : 0.0;
+}
+
+double ProgressiveLoader::getAvailableSeconds() const
+{
+    return availableSeconds.load();
+}
+
+double ProgressiveLoader::getAnalysedSeconds() const
+{
+    return analysisWorker.getAnalysedSeconds();
+}
+
+bool ProgressiveLoader::takeSeekIndex(AudioDecoder::SeekIndex& destination)
+{
+    if (!seekIndexReady.exchange(false))
+        return false;
+
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    destination = std::move(seekIndex);
+    seekIndex.clear();
+    return !destination.empty();
+}
+
+void ProgressiveLoader::getPeaks(std::vector<float>& destination) const
+{
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    destination = peaks;
+}
+
+AnalysisResult ProgressiveLoader::getAnalysisResults() const
+{
+    return analysisWorker.getLatestResults();
+}
+
+bool ProgressiveLoader::getLoudness(LoudnessResult& destination) const
+{
+    if (!loudnessReady.load())
+        return false;
+
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    destination = loudness;
+    return destination.isValid;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AnalysisCache.h"
+#include "AnalysisWorker.h"
+#include "AudioDecoder.h"
+#include "Utils/LoudnessMeter.h"
+
+// Works through a file in the background once playback has started, so
+// loading does not wait for it. A single decode pass builds the seek index,
+// waveform peaks, beat analysis and the loudness scan. Each result can be queried as it fills
+// in, together with how much of the file it covers.
+class ProgressiveLoader
+{
+public:
+    ProgressiveLoader();
+    ~ProgressiveLoader();
+
+    void start(const juce::File& file);
+    void cancel();
+
+    // Progress
+    double getProgress() const;                  // 0..1 of the file processed
+    double getAvailableSeconds() const;          // Peaks cover [0, this)
+    double getAnalysedSeconds() const;           // Beat analysis covers [0, this)
+    double getLengthSeconds() const { return lengthSeconds.load(); }   // Exact once complete
+    bool isComplete() const { return complete.load(); }
+
+    // Results
+    bool takeSeekIndex(AudioDecoder::SeekIndex& destination);   // True once, when ready
+    void getPeaks(std::vector<float>& destination) const;       // Mono min/max pair per peak
+    double getPeaksPerSecond() const { return peaksPerSecond.load(); }
+    AnalysisResult getAnalysisResults() const;
+
+    // Loudness scan, available once the whole file has been read (or
+    // straight away when an earlier session already measured it)
+    bool isLoudnessReady() const { return loudnessReady.load(); }
+    bool getLoudness(LoudnessResult& destination) const;
+    double getIntegratedLufs() const { return integratedLufs.load(); }
+    double getTruePeakDb() const { return truePeakDb.load(); }
+
+    static constexpr int FRAMES_PER_PEAK = 256;
+
+private:
+    static constexpr int CHUNK_FRAMES = 4096;
+    static constexpr int ANALYSIS_HOP_FRAMES = 512;
+
+    AudioDecoder decoder;   // Only used by the loader thread
+    AnalysisWorker analysisWorker;
+    LoudnessMeter loudnessMeter;   // Only used by the loader thread
+    AnalysisCache analysisCache;
+
+    // Loader thread
+    std::jthread loaderThread;
+    std::atomic<bool> shouldCancel{false};
+    std::atomic<bool> complete{false};
+
+    // Progress
+    std::atomic<double> lengthSeconds{0.0};
+    std::atomic<double> availableSeconds{0.0};
+    std::atomic<double> peaksPerSecond{0.0};
+    std::atomic<bool> loudnessReady{false};
+    std::atomic<double> integratedLufs{LoudnessMeter::ABSOLUTE_GATE_LUFS};
+    std::atomic<double> truePeakDb{-100.0};
+
+    // Results (protected by mutex)
+    mutable std::mutex resultsMutex;
+    AudioDecoder::SeekIndex seekIndex;
+    std::vector<float> peaks;
+    std::atomic<bool> seekIndexReady{false};
+    LoudnessResult loudness;
+
+    void run(const juce::File& file);
+    void setLoudness(LoudnessResult result);
+    void feedAnalysis(const float* left, const float* right, int numFrames, std::vector<float>& mono);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgressiveLoader)
+};
@@ -3,7 +3,41 @@
 // Include Rubber Band headers
 #include <rubberband/RubberBandStretcher.h>
 
+#include <chrono>
+
+#ifdef _WIN32
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+
+namespace
+{
+    // Just below the audio callback itself. Without the rights to do so
+    // (rtprio on Linux) the worker keeps normal priority and says so.
+    void raiseThreadPriority(std::jthread& thread)
+    {
+#ifdef _WIN32
+        if (!SetThreadPriority(static_cast<HANDLE>(thread.native_handle()), THREAD_PRIORITY_HIGHEST))
+            juce::Logger::writeToLog("RubberBandNode: Could not raise the lookahead thread's priority");
+#else
+        sched_param parameters {};
+        parameters.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+
+        if (pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &parameters) != 0)
+            juce::Logger::writeToLog("RubberBandNode: Could not raise the lookahead thread's priority");
+#endif
+    }
+}
+
 RubberBandNode::RubberBandNode()
+    : lookaheadRings{ LockFreeRingBuffer<float>(LOOKAHEAD_CAPACITY_FRAMES),
+                      LockFreeRingBuffer<float>(LOOKAHEAD_CAPACITY_FRAMES) },
+      parameterQueue(PARAMETER_QUEUE_CAPACITY)
 {
     // Initialize parameter smoothers with default values
     timeRatioSmoother.setCurrentAndTargetValue(1.0f);
@@ -17,8 +51,11 @@ RubberBandNode::~RubberBandNode()
 
 void RubberBandNode::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
+    stopLookaheadThread();
+
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlock;
+    this->processSize = juce::jmax(samplesPerBlock, WORKER_BLOCK_FRAMES);
     this->numChannels = juce::jmin(getTotalNumInputChannels(), 2); // Limit to stereo
 
     // Setup parameter smoothers
@@ -31,10 +68,53 @@ void RubberBandNode::prepareToPlay(double sampleRate, int samplesPerBlock)
     // Initialize Rubber Band stretcher
     initializeStretcher();
 
-    // Prepare buffers
-    tempBuffer.resize(blockSize * numChannels);
+    // The WSOLA engine is always ready too, so switching never allocates
+    for (auto& instance : wsolaStretchers)
+        instance.prepare(sampleRate, numChannels, processSize);
+
+    activeEngine = stretchEngine.load();
+    instanceEngines.fill(activeEngine);
+
+    // Prepare buffers (pulls are at most processSize, the stretchers' maximum)
+    pullBuffer.setSize(juce::jmax(1, numChannels), processSize);
+    workerBuffer.setSize(juce::jmax(1, numChannels), processSize);
+    stretchedBuffer.setSize(juce::jmax(1, numChannels), processSize);
+
+    // Loop wraps start on the first instance, with nothing in progress
+    silenceBuffer.setSize(juce::jmax(1, numChannels), processSize);
+    silenceBuffer.clear();
+    wrapBuffer.setSize(juce::jmax(1, numChannels), processSize);
+    wrapFadeFrames = juce::jmax(1, juce::roundToInt(sampleRate * WRAP_FADE_SECONDS));
+    activeInstance = 0;
+    wrapping = false;
+
+    for (int instance = 0; instance < 2; ++instance)
+        instanceLatencyFrames[static_cast<size_t>(instance)].store(getInstanceLatency(instance));
+
+    // The identity path delays the input to match the stretcher, and keeps
+    // enough of it to restart the stretcher from when leaving, along with
+    // what arrives while it catches up (up to four blocks' worth a block,
+    // pulled at the fastest tempo under the loop cache)
+    maxIdentityDelay = juce::jmax(wsolaStretchers[0].getLatency(), stretchers[0] != nullptr ? static_cast<int>(stretchers[0]->getStartDelay()) : 0)
+                     + processSize;
+    history.setSize(juce::jmax(1, numChannels), maxIdentityDelay + 6 * processSize);
+    history.clear();
+    historyWritePosition = 0;
+    identityFadeFrames = juce::jmax(1, juce::roundToInt(sampleRate * IDENTITY_FADE_SECONDS));
+    identityFadePosition = 0;
+    identityDelay = juce::jmin(getStretcherLatency(), maxIdentityDelay);
+    identityState = IdentityState::Stretching;
+
+    // The loop cache counts frames at the device rate
+    loopCache.setOutputSampleRate(sampleRate);
+    loopCacheBuffer.setSize(juce::jmax(1, numChannels), processSize);
+    loopCacheState = LoopCacheState::Off;
+    playingLoopCache.store(false);
     inputPointers.resize(numChannels);
     outputPointers.resize(numChannels);
+
+    // The worker idles until a block asks for lookahead
+    startLookaheadThread();
 }
 
 void RubberBandNode::initializeStretcher()
@@ -53,41 +133,150 @@ void RubberBandNode::initializeStretcher()
         RubberBand::RubberBandStretcher::OptionWindowShort |
         RubberBand::RubberBandStretcher::OptionSmoothingOff;
 
-    stretcher = std::make_unique<RubberBand::RubberBandStretcher>(
-        static_cast<size_t>(sampleRate),
-        static_cast<size_t>(numChannels),
-        options,
-        1.0, // Initial time ratio
-        1.0  // Initial pitch scale
-    );
+    // Economy settings are applied on top at the first block
+    economyApplied = false;
 
-    // Set preferred block size for better performance
-    stretcher->setMaxProcessSize(static_cast<size_t>(blockSize));
-    
-    juce::Logger::writeToLog("RubberBandNode: Initialized stretcher (" + 
+    for (auto& stretcher : stretchers)
+    {
+        stretcher = std::make_unique<RubberBand::RubberBandStretcher>(
+            static_cast<size_t>(sampleRate),
+            static_cast<size_t>(numChannels),
+            options,
+            1.0, // Initial time ratio
+            1.0  // Initial pitch scale
+        );
+
+        // Set preferred block size for better performance
+        stretcher->setMaxProcessSize(static_cast<size_t>(processSize));
+    }
+
+    juce::Logger::writeToLog("RubberBandNode: Initialized stretchers (" + 
                             juce::String(sampleRate, 0) + "Hz, " + 
                             juce::String(numChannels) + " channels)");
 }
 
 void RubberBandNode::releaseResources()
 {
-    stretcher = nullptr;
-    tempBuffer.clear();
+    stopLookaheadThread();
+
+    for (auto& stretcher : stretchers)
+        stretcher = nullptr;
+
     inputPointers.clear();
     outputPointers.clear();
 }
 
+void RubberBandNode::updateEngine(bool forceReset)
+{
+    if (economyMode.load() != economyApplied)
+        applyEconomyMode();
+
+    const StretchEngine requestedEngine = stretchEngine.load();
+    if (requestedEngine == activeEngine && !forceReset)
+        return;
+
+    if (!forceReset)
+    {
+        // Switch engines between blocks. A fade or catch-up in progress
+        // finishes on the old one first.
+        const bool fading = identityState == IdentityState::FadingToIdentity || identityState == IdentityState::FadingToStretch
+                         || loopCacheState == LoopCacheState::FadingIn || loopCacheState == LoopCacheState::FadingOut;
+        if (wrapping || priming != Priming::None || fading)
+            return;
+
+        activeEngine = requestedEngine;
+
+        // Playing, the new engine takes over under a crossfade
+        if (identityState == IdentityState::Stretching && loopCacheState == LoopCacheState::Off)
+        {
+            beginEngineSwitch();
+            return;
+        }
+
+        // Bypassed or playing the loop cache, nothing is heard from the
+        // stretcher, so it starts afresh; the bypass keeps its delay
+        resetStretcher();
+        return;
+    }
+
+    // Starting over, the new engine starts afresh (as after a bypass)
+    activeEngine = requestedEngine;
+    resetStretcher();
+
+    // The identity path restarts from silence too, as the stretcher would
+    history.clear();
+    historyWritePosition = 0;
+    identityDelay = juce::jmin(getStretcherLatency(), maxIdentityDelay);
+    identityState = isNeutral() ? IdentityState::Identity : IdentityState::Stretching;
+    loopCacheState = LoopCacheState::Off;
+    playingLoopCache.store(false);
+}
+
+void RubberBandNode::applyEconomyMode()
+{
+    using Stretcher = RubberBand::RubberBandStretcher;
+
+    // All three can change while running, without a reset. Smooth transients
+    // skips the onset detector altogether, and independent phase skips
+    // the phase locking across bins.
+    economyApplied = economyMode.load();
+
+    for (auto& stretcher : stretchers)
+    {
+        if (stretcher == nullptr)
+            continue;
+
+        stretcher->setTransientsOption(economyApplied ? Stretcher::OptionTransientsSmooth : Stretcher::OptionTransientsCrisp);
+        stretcher->setDetectorOption(economyApplied ? Stretcher::OptionDetectorPercussive : Stretcher::OptionDetectorCompound);
+        stretcher->setPhaseOption(economyApplied ? Stretcher::OptionPhaseIndependent : Stretcher::OptionPhaseLaminar);
+    }
+}
+
+void RubberBandNode::resetStretcher()
+{
+    for (int instance = 0; instance < 2; ++instance)
+    {
+        resetInstance(instance);
+        instanceLatencyFrames[static_cast<size_t>(instance)].store(getInstanceLatency(instance));
+    }
+
+    activeInstance = 0;
+    wrapping = false;
+    switchingEngine = false;
+    priming = Priming::None;
+}
+
+int RubberBandNode::getStretcherLatency() const
+{
+    return getInstanceLatency(activeInstance);
+}
+
 void RubberBandNode::updateParameters()
 {
-    // Get smoothed parameter values
-    float currentTimeRatio = timeRatioSmoother.getNextValue();
-    float currentPitchScale = pitchScaleSmoother.getNextValue();
+    // Get smoothed parameter values, held while the stretcher is primed so
+    // what it is fed lines up with what the old path is playing
+    const bool hold = priming != Priming::None;
+    float currentTimeRatio = hold ? timeRatioSmoother.getCurrentValue() : timeRatioSmoother.getNextValue();
+    float currentPitchScale = hold ? pitchScaleSmoother.getCurrentValue() : pitchScaleSmoother.getNextValue();
 
-    // Update stretcher parameters if they have changed
-    if (stretcher)
+    // Both instances, so the spare is ready to take over at a loop wrap
+    for (int instance = 0; instance < 2; ++instance)
+        setInstanceParameters(instance, currentTimeRatio, currentPitchScale);
+}
+
+void RubberBandNode::setInstanceParameters(int instance, float ratio, float scale)
+{
+    instanceTimeRatios[static_cast<size_t>(instance)] = ratio;
+
+    if (instanceEngines[static_cast<size_t>(instance)] == StretchEngine::Wsola)
     {
-        stretcher->setTimeRatio(currentTimeRatio);
-        stretcher->setPitchScale(currentPitchScale);
+        wsolaStretchers[static_cast<size_t>(instance)].setTimeRatio(ratio);
+        wsolaStretchers[static_cast<size_t>(instance)].setPitchScale(scale);
+    }
+    else if (stretchers[static_cast<size_t>(instance)])
+    {
+        stretchers[static_cast<size_t>(instance)]->setTimeRatio(ratio);
+        stretchers[static_cast<size_t>(instance)]->setPitchScale(scale);
     }
 }
 
@@ -106,65 +295,1172 @@ void RubberBandNode::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBu
     }
 
     // If no stretcher or no channels, just pass through
-    if (!stretcher || numInputChannels == 0 || numSamples == 0)
+    if (!stretchers[0] || numInputChannels == 0 || numSamples == 0)
     {
         return;
     }
 
+    // Lookahead (and the blocks spent handing the stretcher over, either
+    // way) goes through the rings instead
+    const int lookahead = pullSource != nullptr ? lookaheadBlocks.load() : 0;
+    if (lookahead > 0 || workerState.load() != WorkerState::Idle || getFramesInLookahead() > 0)
+    {
+        processFromLookahead(buffer, lookahead);
+        return;
+    }
+
+    prepareInlineBlock();
+
+    for (int channel = 0; channel < juce::jmin(numInputChannels, numChannels); ++channel)
+        outputPointers[channel] = buffer.getWritePointer(channel);
+
+    // Push: whatever arrived this block goes in, ready or not. Pull: the
+    // stretcher is fed until it can fill the whole block.
+    bool sourceRanDry = false;
+    const int retrieved = renderOutput(pullSource != nullptr ? nullptr : buffer.getArrayOfReadPointers(),
+                                       numSamples, sourceRanDry);
+
+    // A source running dry (no file, end of song) is counted by the source itself
+    if (retrieved < numSamples && !sourceRanDry)
+        starvedBlockCount.fetch_add(1);
+
+    // What is left over is carried into the next block
+    const int buffered = stretcherAvailable();
+    bufferedFrames.store(buffered);
+    peakBufferedFrames.store(juce::jmax(peakBufferedFrames.load(), buffered));
+
+    // Clear any remaining samples in the buffer if we retrieved fewer
+    if (retrieved < numSamples)
+    {
+        for (int channel = 0; channel < numInputChannels; ++channel)
+        {
+            buffer.clear(channel, retrieved, numSamples - retrieved);
+        }
+    }
+}
+
+void RubberBandNode::prepareInlineBlock()
+{
+    updateEngine(needsReset);
+    needsReset = false;
+
     // Update parameters smoothly
+    timeRatioSmoother.setTargetValue(timeRatio.load());
+    pitchScaleSmoother.setTargetValue(pitchScale.load());
     updateParameters();
+}
 
-    // Prepare input pointers
-    for (int channel = 0; channel < juce::jmin(numInputChannels, numChannels); ++channel)
+void RubberBandNode::processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // Audio passes straight through. Whatever the stretcher was holding will
+    // be stale by the time the node comes back, so start it afresh then.
+    juce::ignoreUnused(midiMessages);
+    needsReset = true;
+
+    // The worker may be pulling from the source, so wait for it to let go
+    const auto state = workerState.load();
+    if (state != WorkerState::Idle)
+    {
+        if (state == WorkerState::Running)
+            workerState.store(WorkerState::Stopping);
+
+        buffer.clear();
+        return;
+    }
+
+    // A source that is pulled sends nothing down the graph, so fetch the block here
+    if (pullSource != nullptr)
+    {
+        buffer.clear();
+        pullSource->pullAudio(buffer, buffer.getNumSamples());
+    }
+}
+
+bool RubberBandNode::pullIntoStretcher(int numSamples)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        inputPointers[channel] = pullBuffer.getReadPointer(channel);
+
+    // Bounded, in case the stretcher keeps asking while producing nothing
+    for (int pull = 0; pull < MAX_PULLS_PER_BLOCK && stretcherAvailable() < numSamples; ++pull)
+    {
+        // Only ever what it asks for, so its buffers stay at their minimum
+        int framesToPull = juce::jmin(pullBuffer.getNumSamples(), juce::jmax(MIN_PULL_FRAMES, stretcherSamplesRequired()));
+
+        // Stop exactly on a loop wrap, so the loop start goes to the other instance
+        const int framesToWrap = pullSource->getFramesUntilWrap();
+        if (framesToWrap > 0)
+            framesToPull = juce::jmin(framesToPull, framesToWrap);
+
+        const int framesPulled = pullSource->pullAudio(pullBuffer, framesToPull);
+
+        if (framesPulled > 0)
+        {
+            writeHistory(inputPointers.data(), framesPulled);
+            processStretcher(framesPulled);
+        }
+
+        if (framesPulled == framesToWrap)
+            beginWrap();
+
+        if (framesPulled < framesToPull)
+            return false;
+    }
+
+    return true;
+}
+
+int RubberBandNode::stretcherSamplesRequired() const
+{
+    const auto instance = static_cast<size_t>(activeInstance);
+
+    if (instanceEngines[instance] == StretchEngine::Wsola)
+        return wsolaStretchers[instance].getSamplesRequired();
+
+    return static_cast<int>(stretchers[instance]->getSamplesRequired());
+}
+
+int RubberBandNode::stretcherAvailable() const
+{
+    if (!wrapping)
+        return instanceAvailable(activeInstance);
+
+    // Nothing of the loop start can go out before all of the loop end has
+    const int outgoing = instanceAvailable(1 - activeInstance);
+    if (outgoing < wrapTailFrames || wrapDiscardFrames > 0)
+        return juce::jmin(outgoing, wrapTailFrames);
+
+    // The crossfade goes no further than the old instance has got: its ring
+    // out of the loop end, or when switching engines the same audio as the new one
+    const int incoming = instanceAvailable(activeInstance);
+    const int ringOut = outgoing - wrapTailFrames;
+    if (ringOut < juce::jmin(incoming, wrapFadeLength - wrapFadePosition))
+        return wrapTailFrames + ringOut;
+
+    return wrapTailFrames + incoming;
+}
+
+void RubberBandNode::processStretcher(int numFrames)
+{
+    processInstance(activeInstance, inputPointers.data(), numFrames);
+
+    if (wrapping)
+    {
+        // Silence pushes the rest of the loop end out of the outgoing
+        // instance; the old engine plays on through the input, to fade under the new one
+        processInstance(1 - activeInstance, switchingEngine ? inputPointers.data() : silenceBuffer.getArrayOfReadPointers(), numFrames);
+        dropWrapStartDelay();
+    }
+}
+
+int RubberBandNode::retrieveFromStretcher(float* const* destination, int numFrames)
+{
+    if (!wrapping)
+        return retrieveFromInstance(activeInstance, destination, numFrames);
+
+    const int outgoing = 1 - activeInstance;
+    int retrieved = 0;
+
+    // Up to the wrap sample, the loop end
+    if (wrapTailFrames > 0)
+    {
+        retrieved = retrieveFromInstance(outgoing, destination, juce::jmin(numFrames, wrapTailFrames));
+        wrapTailFrames -= retrieved;
+
+        if (wrapTailFrames > 0 || wrapDiscardFrames > 0)
+            return retrieved;
+    }
+
+    // From it, the loop start, with the outgoing instance ringing out underneath
+    std::array<float*, 2> loopStart {}, ringOut {};
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        loopStart[static_cast<size_t>(channel)] = destination[channel] + retrieved;
+        ringOut[static_cast<size_t>(channel)] = wrapBuffer.getWritePointer(channel);
+    }
+
+    int framesWanted = numFrames - retrieved;
+    const int framesOfRingOutAvailable = instanceAvailable(outgoing);
+    if (framesOfRingOutAvailable < juce::jmin(framesWanted, wrapFadeLength - wrapFadePosition))
+        framesWanted = framesOfRingOutAvailable;
+
+    const int framesOfLoopStart = retrieveFromInstance(activeInstance, loopStart.data(), framesWanted);
+    const int framesToFade = juce::jmin(framesOfLoopStart, wrapFadeLength - wrapFadePosition);
+    const int framesOfRingOut = retrieveFromInstance(outgoing, ringOut.data(), framesToFade);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* output = loopStart[static_cast<size_t>(channel)];
+        const float* tail = ringOut[static_cast<size_t>(channel)];
+
+        for (int i = 0; i < framesToFade; ++i)
+        {
+            const float gain = static_cast<float>(wrapFadePosition + i) / static_cast<float>(wrapFadeLength);
+            const float ringOutSample = i < framesOfRingOut ? tail[i] : 0.0f;
+            output[i] = ringOutSample + gain * (output[i] - ringOutSample);
+        }
+    }
+
+    wrapFadePosition += framesToFade;
+
+    if (wrapFadePosition >= wrapFadeLength)
+    {
+        // The outgoing instance waits, empty (and on the active engine), for the next wrap
+        resetInstance(outgoing);
+        instanceLatencyFrames[static_cast<size_t>(outgoing)].store(getInstanceLatency(outgoing));
+        wrapping = false;
+        switchingEngine = false;
+    }
+
+    return retrieved + framesOfLoopStart;
+}
+
+void RubberBandNode::resetInstance(int instance)
+{
+    instanceEngines[static_cast<size_t>(instance)] = activeEngine;
+
+    if (activeEngine == StretchEngine::Wsola)
+        wsolaStretchers[static_cast<size_t>(instance)].reset();
+    else
+        stretchers[static_cast<size_t>(instance)]->reset();
+
+    // It may have missed settings changes while the other engine ran
+    setInstanceParameters(instance, timeRatioSmoother.getCurrentValue(), pitchScaleSmoother.getCurrentValue());
+
+    instanceFedFrames[static_cast<size_t>(instance)] = 0;
+    instanceOutputSources[static_cast<size_t>(instance)] = getInstanceStartPad(instance)
+                                                         - getInstanceStartDelay(instance) / instanceTimeRatios[static_cast<size_t>(instance)];
+}
+
+int RubberBandNode::getInstanceLatency(int instance) const
+{
+    if (instanceEngines[static_cast<size_t>(instance)] == StretchEngine::Wsola)
+        return wsolaStretchers[static_cast<size_t>(instance)].getLatency();
+
+    const auto& stretcher = stretchers[static_cast<size_t>(instance)];
+    return stretcher != nullptr ? static_cast<int>(stretcher->getStartDelay()) : 0;
+}
+
+double RubberBandNode::getInstanceHold(int instance) const
+{
+    return static_cast<double>(instanceFedFrames[static_cast<size_t>(instance)]) - instanceOutputSources[static_cast<size_t>(instance)];
+}
+
+int RubberBandNode::getInstanceStartPad(int instance) const
+{
+    if (instanceEngines[static_cast<size_t>(instance)] == StretchEngine::Wsola)
+        return wsolaStretchers[static_cast<size_t>(instance)].getPreferredStartPad();
+
+    return static_cast<int>(stretchers[static_cast<size_t>(instance)]->getPreferredStartPad());
+}
+
+int RubberBandNode::getInstanceStartDelay(int instance) const
+{
+    if (instanceEngines[static_cast<size_t>(instance)] == StretchEngine::Wsola)
+        return wsolaStretchers[static_cast<size_t>(instance)].getStartDelay();
+
+    return static_cast<int>(stretchers[static_cast<size_t>(instance)]->getStartDelay());
+}
+
+int RubberBandNode::instanceAvailable(int instance) const
+{
+    if (instanceEngines[static_cast<size_t>(instance)] == StretchEngine::Wsola)
+        return wsolaStretchers[static_cast<size_t>(instance)].available();
+
+    // Rubber Band reports -1 once it has been given its final block
+    return juce::jmax(0, static_cast<int>(stretchers[static_cast<size_t>(instance)]->available()));
+}
+
+void RubberBandNode::processInstance(int instance, const float* const* input, int numFrames)
+{
+    if (instanceEngines[static_cast<size_t>(instance)] == StretchEngine::Wsola)
+    {
+        instanceFedFrames[static_cast<size_t>(instance)] += wsolaStretchers[static_cast<size_t>(instance)].process(input, numFrames);
+    }
+    else
+    {
+        stretchers[static_cast<size_t>(instance)]->process(input,
+                                                           static_cast<size_t>(numFrames),
+                                                           false); // false = more input expected
+        instanceFedFrames[static_cast<size_t>(instance)] += numFrames;
+    }
+}
+
+int RubberBandNode::retrieveFromInstance(int instance, float* const* destination, int numFrames)
+{
+    const int framesToRetrieve = juce::jmin(instanceAvailable(instance), numFrames);
+    if (framesToRetrieve <= 0)
+        return 0;
+
+    const int retrieved = instanceEngines[static_cast<size_t>(instance)] == StretchEngine::Wsola
+                        ? wsolaStretchers[static_cast<size_t>(instance)].retrieve(destination, framesToRetrieve)
+                        : static_cast<int>(stretchers[static_cast<size_t>(instance)]->retrieve(destination, static_cast<size_t>(framesToRetrieve)));
+
+    instanceOutputSources[static_cast<size_t>(instance)] += retrieved / instanceTimeRatios[static_cast<size_t>(instance)];
+    return retrieved;
+}
+
+void RubberBandNode::beginWrap()
+{
+    // A loop shorter than a wrap crossfade carries on in the one instance
+    if (wrapping)
+        return;
+
+    const int outgoing = activeInstance;
+    const int incoming = 1 - activeInstance;
+
+    // Everything the outgoing instance has been fed is loop end
+    wrapTailFrames = juce::jmax(0, juce::roundToInt(getInstanceHold(outgoing) * instanceTimeRatios[static_cast<size_t>(outgoing)]));
+
+    // Silence first, as Rubber Band recommends, so the loop start comes out
+    // clean and on time once the start delay it causes has been dropped
+    for (int padFrames = getInstanceStartPad(incoming); padFrames > 0;)
+    {
+        const int chunk = juce::jmin(processSize, padFrames);
+        processInstance(incoming, silenceBuffer.getArrayOfReadPointers(), chunk);
+        padFrames -= chunk;
+    }
+
+    wrapDiscardFrames = getInstanceStartDelay(incoming);
+    wrapFadeLength = switchingEngine ? identityFadeFrames : wrapFadeFrames;
+    wrapFadePosition = 0;
+    activeInstance = incoming;
+    wrapping = true;
+
+    for (const int instance : { outgoing, incoming })
+        instanceLatencyFrames[static_cast<size_t>(instance)].store(getInstanceLatency(instance));
+    dropWrapStartDelay();
+}
+
+void RubberBandNode::beginEngineSwitch()
+{
+    // The spare instance starts on the new engine from the next input frame,
+    // as it would on the loop start at a wrap. The old one finishes what it
+    // owes up to there, then keeps going underneath for the crossfade.
+    resetInstance(1 - activeInstance);
+    switchingEngine = true;
+    beginWrap();
+}
+
+void RubberBandNode::dropWrapStartDelay()
+{
+    std::array<float*, 2> discard {};
+    for (int channel = 0; channel < numChannels; ++channel)
+        discard[static_cast<size_t>(channel)] = wrapBuffer.getWritePointer(channel);
+
+    while (wrapDiscardFrames > 0)
+    {
+        const int dropped = retrieveFromInstance(activeInstance, discard.data(), juce::jmin(processSize, wrapDiscardFrames));
+        if (dropped == 0)
+            break;
+
+        wrapDiscardFrames -= dropped;
+    }
+}
+
+int RubberBandNode::renderOutput(const float* const* pushedInput, int numFrames, bool& sourceRanDry)
+{
+    // Only a pulled source says where its audio comes from
+    if (pushedInput != nullptr)
+        return renderFrames(pushedInput, numFrames, sourceRanDry);
+
+    updateLoopCacheState();
+
+    if (loopCacheState == LoopCacheState::Off)
+        return renderFrames(nullptr, numFrames, sourceRanDry);
+
+    if (loopCacheState == LoopCacheState::Playing)
+        return playLoopCache(numFrames, sourceRanDry);
+
+    // Crossfading, with the live stretcher running underneath as usual
+    const int rendered = renderFrames(nullptr, numFrames, sourceRanDry);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::clear(outputPointers[channel] + rendered, numFrames - rendered);
+
+    std::array<float*, 2> cached {};
+    for (int channel = 0; channel < numChannels; ++channel)
+        cached[static_cast<size_t>(channel)] = loopCacheBuffer.getWritePointer(channel);
+
+    if (!readLoopCache(cached.data(), numFrames))
+    {
+        // The region was replaced mid-fade; the live stretcher carries on alone
+        loopCacheState = LoopCacheState::Off;
+        playingLoopCache.store(false);
+        return rendered;
+    }
+
+    const bool towardsCache = loopCacheState == LoopCacheState::FadingIn;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* output = outputPointers[channel];
+        const float* cachedSamples = cached[static_cast<size_t>(channel)];
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const float position = juce::jmin(1.0f, static_cast<float>(loopCacheFadePosition + i) / static_cast<float>(identityFadeFrames));
+            const float gain = towardsCache ? position : 1.0f - position;
+            output[i] += gain * (cachedSamples[i] - output[i]);
+        }
+    }
+
+    loopCacheFadePosition += numFrames;
+    if (loopCacheFadePosition >= identityFadeFrames)
+    {
+        loopCacheState = towardsCache ? LoopCacheState::Playing : LoopCacheState::Off;
+        loopCacheSourceFrame = pullSource->getNextPullFrame();
+        loopCachePullRemainder = 0.0;
+    }
+
+    playingLoopCache.store(loopCacheState == LoopCacheState::Playing);
+    return numFrames;
+}
+
+void RubberBandNode::updateLoopCacheState()
+{
+    StretchedLoopCache::Region region;
+    const bool ready = loopCache.getReadyRegion(region);
+
+    if (loopCacheState == LoopCacheState::Off)
+    {
+        if (!ready || identityState != IdentityState::Stretching || !loopCacheMatches(region, pullSource->getNextPullFrame()))
+            return;
+
+        // Finish the last hair of smoothing, so the stretcher is left at its
+        // final settings for when playback falls back to it
+        timeRatioSmoother.skipToTargetValue();
+        pitchScaleSmoother.skipToTargetValue();
+
+        // Take over from where the live stretcher has got to: what it holds, stretched
+        loopCacheRegion = region;
+        loopCacheLag = getInstanceHold(activeInstance) * instanceTimeRatios[static_cast<size_t>(activeInstance)];
+        loopCachePosition = getLoopCachePositionFor(pullSource->getNextPullFrame());
+        loopCacheGain = pullSource->getPullGain();
+        loopCacheFadePosition = 0;
+        loopCacheState = LoopCacheState::FadingIn;
+        return;
+    }
+
+    if (loopCacheState == LoopCacheState::FadingOut)
+        return;
+
+    // A new tempo, pitch or loop, or a seek out of the loop, goes back to live stretching
+    const int64_t sourceFrame = pullSource->getNextPullFrame();
+    if (ready && region.generation == loopCacheRegion.generation && loopCacheMatches(region, sourceFrame))
+    {
+        // Back to the settings it was rendered at before the stretcher was needed
+        if (priming == Priming::LeavingLoopCache)
+            priming = Priming::None;
+
+        return;
+    }
+
+    if (loopCacheState == LoopCacheState::Playing)
+    {
+        // The stretcher sat idle: restart it lined up with the cache
+        if (priming == Priming::None)
+            beginPriming(Priming::LeavingLoopCache, juce::roundToInt(loopCacheLag / loopCacheRegion.timeRatio));
+
+        // Until the source leaves the region or the region is replaced, the
+        // cache plays on while playLoopCache catches the stretcher up
+        const bool cacheStillPlays = (!ready || region.generation == loopCacheRegion.generation)
+                                  && sourceFrame >= loopCacheRegion.startFrame && sourceFrame <= loopCacheRegion.endFrame;
+        if (cacheStillPlays)
+            return;
+
+        continuePriming(primingBacklog);
+        loopCacheFadePosition = 0;
+    }
+    else
+    {
+        loopCacheFadePosition = juce::jmax(0, identityFadeFrames - loopCacheFadePosition);
+    }
+
+    loopCacheState = LoopCacheState::FadingOut;
+}
+
+bool RubberBandNode::loopCacheMatches(const StretchedLoopCache::Region& region, int64_t sourceFrame) const
+{
+    // The live settings come through two smoothers, so they may sit a hair
+    // away from the ones the region was rendered at
+    return sourceFrame >= region.startFrame && sourceFrame <= region.endFrame
+        && settingsMatch(timeRatioSmoother.getCurrentValue(), region.timeRatio) && settingsMatch(timeRatioSmoother.getTargetValue(), region.timeRatio)
+        && settingsMatch(pitchScaleSmoother.getCurrentValue(), region.pitchScale) && settingsMatch(pitchScaleSmoother.getTargetValue(), region.pitchScale);
+}
+
+double RubberBandNode::getLoopCachePositionFor(int64_t sourceFrame) const
+{
+    // One pass of the loop lasts exactly this long stretched, even if the
+    // rendered region was rounded to whole frames
+    const double length = static_cast<double>(loopCacheRegion.endFrame - loopCacheRegion.startFrame) * loopCacheRegion.timeRatio;
+    const double position = std::fmod((sourceFrame - loopCacheRegion.startFrame) * static_cast<double>(loopCacheRegion.timeRatio) - loopCacheLag, length);
+
+    return position < 0.0 ? position + length : position;
+}
+
+int RubberBandNode::playLoopCache(int numFrames, bool& sourceRanDry)
+{
+    // After a wrap the source reports the loop end rather than the start
+    const auto wrapped = [this](int64_t frame) { return frame == loopCacheRegion.endFrame ? loopCacheRegion.startFrame : frame; };
+
+    // The source moved without us (a seek within the loop): jump with it
+    const int64_t sourceFrame = wrapped(pullSource->getNextPullFrame());
+    if (sourceFrame != wrapped(loopCacheSourceFrame))
+        loopCachePosition = getLoopCachePositionFor(sourceFrame);
+
+    // Pull the source along at the stretched rate, so its playhead and loop
+    // carry on as if stretching live, and keep what it gives for priming
+    loopCachePullRemainder += numFrames / static_cast<double>(loopCacheRegion.timeRatio);
+    int framesToPull = static_cast<int>(loopCachePullRemainder);
+    loopCachePullRemainder -= framesToPull;
+
+    int framesArrived = 0;
+
+    while (framesToPull > 0)
+    {
+        const int chunk = juce::jmin(framesToPull, pullBuffer.getNumSamples());
+        const int framesPulled = pullSource->pullAudio(pullBuffer, chunk);
+
+        if (framesPulled > 0)
+            writeHistory(pullBuffer.getArrayOfReadPointers(), framesPulled);
+
+        framesArrived += framesPulled;
+        framesToPull -= chunk;
+
+        if (framesPulled < chunk)
+        {
+            sourceRanDry = true;
+            break;
+        }
+    }
+
+    loopCacheSourceFrame = pullSource->getNextPullFrame();
+
+    if (!readLoopCache(outputPointers.data(), numFrames))
+    {
+        // Lost the region between checks: live again from the next block,
+        // so the stretcher has to catch up at once
+        if (priming == Priming::None)
+            beginPriming(Priming::LeavingLoopCache, juce::roundToInt(loopCacheLag / loopCacheRegion.timeRatio));
+
+        continuePriming(primingBacklog);
+        loopCacheState = LoopCacheState::Off;
+        playingLoopCache.store(false);
+        return 0;
+    }
+
+    // On the way out, the stretcher gets what arrived plus a chunk of what it
+    // missed; the crossfade starts once it has caught up
+    if (priming == Priming::LeavingLoopCache && continuePriming(framesArrived + processSize))
+    {
+        loopCacheState = LoopCacheState::FadingOut;
+        loopCacheFadePosition = 0;
+    }
+
+    return numFrames;
+}
+
+bool RubberBandNode::readLoopCache(float* const* destination, int numFrames)
+{
+    const double length = static_cast<double>(loopCacheRegion.endFrame - loopCacheRegion.startFrame) * loopCacheRegion.timeRatio;
+    std::array<float*, 2> outputs {};
+    int framesRead = 0;
+
+    while (framesRead < numFrames)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            outputs[static_cast<size_t>(channel)] = destination[channel] + framesRead;
+
+        // Up to the loop end, which falls between frames unless the ratio is whole
+        const auto frame = static_cast<int64_t>(loopCachePosition);
+        const int framesToLoopEnd = juce::jmax(1, static_cast<int>(std::ceil(length - loopCachePosition)));
+        int framesCopied = loopCache.read(loopCacheRegion.generation, frame, outputs.data(), numChannels,
+                                          juce::jmin(numFrames - framesRead, framesToLoopEnd));
+
+        // Rounding can leave the region a frame short of the exact length: hold its last frame
+        if (framesCopied == 0 && frame >= loopCacheRegion.numFrames)
+            framesCopied = loopCache.read(loopCacheRegion.generation, loopCacheRegion.numFrames - 1, outputs.data(), numChannels, 1);
+
+        if (framesCopied == 0)
+            return false;
+
+        framesRead += framesCopied;
+        loopCachePosition += framesCopied;
+
+        if (loopCachePosition >= length)
+            loopCachePosition -= length;
+    }
+
+    // Cached without the source's normalisation gain, which may change (ramped) in the meantime
+    const float gain = pullSource->getPullGain();
+    for (int channel = 0; channel < numChannels; ++channel)
     {
-        inputPointers[channel] = buffer.getReadPointer(channel);
+        for (int i = 0; i < numFrames; ++i)
+            destination[channel][i] *= loopCacheGain + (gain - loopCacheGain) * static_cast<float>(i) / static_cast<float>(numFrames);
     }
 
-    // Process audio through Rubber Band
-    stretcher->process(inputPointers.data(), 
-                      static_cast<size_t>(numSamples), 
-                      false); // false = more input expected
+    loopCacheGain = gain;
+    return true;
+}
+
+void RubberBandNode::requestLoopCache(const juce::File& file, double startSeconds, double endSeconds, float ratio, float scale)
+{
+    // Clamped as the live settings are, so they compare alike
+    loopCache.request(file, startSeconds, endSeconds, juce::jlimit(0.25f, 4.0f, ratio), juce::jlimit(0.25f, 4.0f, scale));
+}
+
+int RubberBandNode::renderFrames(const float* const* pushedInput, int numFrames, bool& sourceRanDry)
+{
+    sourceRanDry = false;
+    updateIdentityState();
+    bypassingStretcher.store(identityState == IdentityState::Identity);
 
-    // Retrieve processed samples
-    int available = static_cast<int>(stretcher->available());
-    if (available > 0)
+    if (identityState == IdentityState::Stretching)
     {
-        // Limit to buffer size
-        int samplesToRetrieve = juce::jmin(available, numSamples);
-        
-        // Prepare output pointers
-        for (int channel = 0; channel < juce::jmin(numInputChannels, numChannels); ++channel)
+        if (pushedInput == nullptr)
         {
-            outputPointers[channel] = buffer.getWritePointer(channel);
+            sourceRanDry = !pullIntoStretcher(numFrames);
+        }
+        else
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                inputPointers[channel] = pushedInput[channel];
+
+            // Both engines copy the input before anything is written back
+            writeHistory(pushedInput, numFrames);
+            processStretcher(numFrames);
         }
 
-        // Retrieve samples from stretcher
-        size_t retrieved = stretcher->retrieve(outputPointers.data(), 
-                                              static_cast<size_t>(samplesToRetrieve));
+        return retrieveFromStretcher(outputPointers.data(), numFrames);
+    }
 
-        // Clear any remaining samples in the buffer if we retrieved fewer
-        if (static_cast<int>(retrieved) < numSamples)
+    // Bypassed or crossfading, the stretcher runs at a ratio of one, so a
+    // frame in for every frame out
+    const float* const* input = pushedInput;
+    if (input == nullptr)
+    {
+        const int framesPulled = pullSource->pullAudio(pullBuffer, numFrames);
+        if (framesPulled < numFrames)
         {
-            for (int channel = 0; channel < numInputChannels; ++channel)
+            sourceRanDry = true;
+            for (int channel = 0; channel < numChannels; ++channel)
+                pullBuffer.clear(channel, framesPulled, numFrames - framesPulled);
+        }
+
+        input = pullBuffer.getArrayOfReadPointers();
+    }
+
+    writeHistory(input, numFrames);
+
+    if (identityState == IdentityState::Identity)
+    {
+        readHistory(outputPointers.data(), numFrames + identityDelay, numFrames);
+
+        // On the way out, the stretcher gets this block plus a chunk of what
+        // it missed; the crossfade starts once it has caught up
+        if (priming == Priming::LeavingIdentity && continuePriming(numFrames + processSize))
+        {
+            identityState = IdentityState::FadingToStretch;
+            identityFadePosition = 0;
+        }
+
+        return numFrames;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        inputPointers[channel] = input[channel];
+
+    processStretcher(numFrames);
+
+    // Line the bypass up with the stretched audio it is about to replace
+    const bool measuring = identityState == IdentityState::FadingToIdentity && measureIdentityDelay;
+    if (measuring)
+    {
+        identityDelay = juce::jlimit(0, maxIdentityDelay, juce::roundToInt(getInstanceHold(activeInstance)) - numFrames);
+        measureIdentityDelay = false;
+    }
+
+    // A stretcher short of a block would slip behind the bypass. Pulled, it
+    // is given more instead, and the bypass reads that much further back.
+    if (pushedInput == nullptr)
+    {
+        for (int pull = 0; pull < MAX_PULLS_PER_BLOCK && stretcherAvailable() < numFrames && identityDelay < maxIdentityDelay; ++pull)
+        {
+            const int framesToPull = juce::jmin(juce::jmax(MIN_PULL_FRAMES, stretcherSamplesRequired()),
+                                                maxIdentityDelay - identityDelay, pullBuffer.getNumSamples());
+            const int framesPulled = pullSource->pullAudio(pullBuffer, framesToPull);
+            if (framesPulled <= 0)
+                break;
+
+            writeHistory(pullBuffer.getArrayOfReadPointers(), framesPulled);
+            processStretcher(framesPulled);
+            identityDelay += framesPulled;
+        }
+    }
+
+    std::array<float*, 2> stretched {};
+    for (int channel = 0; channel < numChannels; ++channel)
+        stretched[static_cast<size_t>(channel)] = stretchedBuffer.getWritePointer(channel);
+
+    const int framesStretched = retrieveFromStretcher(stretched.data(), numFrames);
+
+    // Having run at another ratio, the stretcher can be a search range off
+    // the frame it nominally took this from; match what actually came out
+    if (measuring && framesStretched == numFrames)
+        identityDelay = findIdentityDelay(stretched.data(), numFrames);
+
+    readHistory(outputPointers.data(), numFrames + identityDelay, numFrames);
+    const bool towardsStretcher = identityState == IdentityState::FadingToStretch;
+
+    // Linear, since both paths carry the same audio in step. Any frames the
+    // stretcher is short of are left dry.
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* output = outputPointers[channel];
+        const float* stretchedSamples = stretched[static_cast<size_t>(channel)];
+
+        for (int i = 0; i < framesStretched; ++i)
+        {
+            const float position = juce::jmin(1.0f, static_cast<float>(identityFadePosition + i) / static_cast<float>(identityFadeFrames));
+            const float gain = towardsStretcher ? position : 1.0f - position;
+            output[i] += gain * (stretchedSamples[i] - output[i]);
+        }
+    }
+
+    identityFadePosition += numFrames;
+    if (identityFadePosition >= identityFadeFrames)
+        identityState = towardsStretcher ? IdentityState::Stretching : IdentityState::Identity;
+
+    return numFrames;
+}
+
+bool RubberBandNode::isNeutral() const
+{
+    return settingsMatch(timeRatioSmoother.getCurrentValue(), 1.0f) && settingsMatch(timeRatioSmoother.getTargetValue(), 1.0f)
+        && settingsMatch(pitchScaleSmoother.getCurrentValue(), 1.0f) && settingsMatch(pitchScaleSmoother.getTargetValue(), 1.0f);
+}
+
+void RubberBandNode::updateIdentityState()
+{
+    const bool neutral = isNeutral();
+
+    // Close enough to bypass: finish the last hair of smoothing now, so the
+    // stretcher takes its final settings from the next block on
+    if (neutral)
+    {
+        timeRatioSmoother.skipToTargetValue();
+        pitchScaleSmoother.skipToTargetValue();
+    }
+
+    switch (identityState)
+    {
+        case IdentityState::Stretching:
+            if (neutral)
+            {
+                identityState = IdentityState::FadingToIdentity;
+                identityFadePosition = 0;
+                measureIdentityDelay = true;
+            }
+            break;
+
+        case IdentityState::Identity:
+            if (!neutral && priming == Priming::None)
+            {
+                lengthenIdentityDelay();
+                beginPriming(Priming::LeavingIdentity, identityDelay);
+            }
+            else if (neutral && priming == Priming::LeavingIdentity)
+                priming = Priming::None;
+            break;
+
+        // Turning back mid-fade: the stretcher is still running, so just reverse
+        case IdentityState::FadingToIdentity:
+            if (!neutral)
             {
-                buffer.clear(channel, static_cast<int>(retrieved), 
-                           numSamples - static_cast<int>(retrieved));
+                identityState = IdentityState::FadingToStretch;
+                identityFadePosition = juce::jmax(0, identityFadeFrames - identityFadePosition);
+            }
+            break;
+
+        case IdentityState::FadingToStretch:
+            if (neutral)
+            {
+                identityState = IdentityState::FadingToIdentity;
+                identityFadePosition = juce::jmax(0, identityFadeFrames - identityFadePosition);
+            }
+            break;
+    }
+}
+
+int RubberBandNode::findIdentityDelay(const float* const* stretched, int numFrames)
+{
+    const int range = juce::roundToInt(sampleRate * WsolaStretcher::SEARCH_SECONDS);
+    const int lowest = juce::jmax(0, identityDelay - range);
+    const int highest = juce::jmin(maxIdentityDelay, identityDelay + range);
+
+    double stretchedEnergy = 0.0;
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numFrames; ++i)
+            stretchedEnergy += stretched[channel][i] * stretched[channel][i];
+
+    if (stretchedEnergy <= 1.0e-9)
+        return identityDelay;
+
+    // Normalised correlation against the history at each candidate delay,
+    // read into the output as scratch
+    int bestDelay = identityDelay;
+    double bestScore = -2.0;
+    for (int delay = lowest; delay <= highest; ++delay)
+    {
+        readHistory(outputPointers.data(), numFrames + delay, numFrames);
+
+        double product = 0.0, energy = 0.0;
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const float* candidate = outputPointers[channel];
+            for (int i = 0; i < numFrames; ++i)
+            {
+                product += candidate[i] * stretched[channel][i];
+                energy += candidate[i] * candidate[i];
             }
         }
+
+        const double score = product / std::sqrt(juce::jmax(energy, 1.0e-9) * stretchedEnergy);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestDelay = delay;
+        }
     }
-    else
+
+    return bestDelay;
+}
+
+void RubberBandNode::lengthenIdentityDelay()
+{
+    // Frame in, frame out through the crossfade, the stretcher only fills
+    // every block at its longest lag. A pulled source can be read that far
+    // ahead; the bypass plays on from the same frame, further back in the history.
+    if (pullSource == nullptr)
+        return;
+
+    for (int framesLeft = maxIdentityDelay - identityDelay; framesLeft > 0;)
     {
-        // No samples available, clear the buffer
-        buffer.clear();
+        const int framesPulled = pullSource->pullAudio(pullBuffer, juce::jmin(framesLeft, pullBuffer.getNumSamples()));
+        if (framesPulled <= 0)
+            break;
+
+        writeHistory(pullBuffer.getArrayOfReadPointers(), framesPulled);
+        identityDelay += framesPulled;
+        framesLeft -= framesPulled;
+    }
+}
+
+void RubberBandNode::beginPriming(Priming reason, int lag)
+{
+    // Restart the stretcher on the audio it would have been given while
+    // bypassed (or playing the loop cache), up to the newest frame in the
+    // history. What the new input adds to that is fed along with it.
+    resetStretcher();
+    priming = reason;
+    primingLag = juce::jlimit(0, maxIdentityDelay, lag);
+    primingBacklog = primingLag + processSize;
+}
+
+bool RubberBandNode::continuePriming(int maxFrames)
+{
+    const double ratio = instanceTimeRatios[static_cast<size_t>(activeInstance)];
+
+    std::array<float*, 2> discard {};
+    for (int channel = 0; channel < numChannels; ++channel)
+        discard[static_cast<size_t>(channel)] = stretchedBuffer.getWritePointer(channel);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        inputPointers[channel] = pullBuffer.getReadPointer(channel);
+
+    for (int framesLeft = juce::jmin(maxFrames, primingBacklog); framesLeft > 0;)
+    {
+        const int chunk = juce::jmin(processSize, framesLeft);
+        readHistory(pullBuffer.getArrayOfWritePointers(), primingBacklog, chunk);
+        processStretcher(chunk);
+        primingBacklog -= chunk;
+        framesLeft -= chunk;
+
+        // Whatever comes out from nearer the newest frame than primingLag is
+        // dropped, so the stretcher lines up with the old path
+        const int available = stretcherAvailable();
+        const int framesToDrop = juce::jlimit(0, available, static_cast<int>((getInstanceHold(activeInstance) - (primingLag - primingBacklog)) * ratio));
+
+        for (int dropped = 0; dropped < framesToDrop;)
+            dropped += juce::jmax(1, retrieveFromStretcher(discard.data(), juce::jmin(processSize, framesToDrop - dropped)));
+    }
+
+    if (primingBacklog > 0)
+        return false;
+
+    priming = Priming::None;
+    return true;
+}
+
+void RubberBandNode::writeHistory(const float* const* input, int numFrames)
+{
+    const int capacity = history.getNumSamples();
+    const int firstRun = juce::jmin(numFrames, capacity - historyWritePosition);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        history.copyFrom(channel, historyWritePosition, input[channel], firstRun);
+        history.copyFrom(channel, 0, input[channel] + firstRun, numFrames - firstRun);
+    }
+
+    historyWritePosition = (historyWritePosition + numFrames) % capacity;
+
+    // Still to reach the stretcher, if it is catching up
+    if (priming != Priming::None)
+        primingBacklog += numFrames;
+}
+
+void RubberBandNode::readHistory(float* const* destination, int framesBack, int numFrames)
+{
+    const int capacity = history.getNumSamples();
+    const int start = (historyWritePosition - framesBack + capacity) % capacity;
+    const int firstRun = juce::jmin(numFrames, capacity - start);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* samples = history.getReadPointer(channel);
+        juce::FloatVectorOperations::copy(destination[channel], samples + start, firstRun);
+        juce::FloatVectorOperations::copy(destination[channel] + firstRun, samples, numFrames - firstRun);
+    }
+}
+
+void RubberBandNode::startLookaheadThread()
+{
+    workerState.store(WorkerState::Idle);
+    shouldStopLookahead.store(false);
+
+    lookaheadThread = std::jthread([this]() { runLookahead(); });
+    raiseThreadPriority(lookaheadThread);
+}
+
+void RubberBandNode::stopLookaheadThread()
+{
+    shouldStopLookahead.store(true);
+
+    if (lookaheadThread.joinable())
+    {
+        lookaheadThread.join();
+    }
+
+    // Whatever state the worker was left in, the audio thread owns the stretcher again
+    hasPendingChange = false;
+    parameterQueue.discard();
+    workerState.store(WorkerState::Idle);
+    needsReset = true;
+}
+
+void RubberBandNode::runLookahead()
+{
+    while (!shouldStopLookahead.load())
+    {
+        auto state = workerState.load();
+
+        if (state == WorkerState::Stopping)
+        {
+            // The audio thread takes the settings straight from here on
+            hasPendingChange = false;
+            parameterQueue.discard();
+            workerState.compare_exchange_strong(state, WorkerState::Idle);
+            continue;
+        }
+
+        if (state == WorkerState::Running && stretchAhead())
+            continue;
+
+        // Wake a few times per lookahead window, so the rings never run low
+        const double windowSeconds = lookaheadTargetFrames.load() / sampleRate;
+        const auto pollMicroseconds = juce::jlimit(250, 2000, static_cast<int>(windowSeconds * 1.0e6 / 4.0));
+        std::this_thread::sleep_for(std::chrono::microseconds(pollMicroseconds));
+    }
+}
+
+bool RubberBandNode::stretchAhead()
+{
+    updateEngine(false);
+
+    // Never past the target, so nothing queued has been overtaken by the time it is due
+    const int space = static_cast<int>(lookaheadRings[0].space());
+    const int shortfall = juce::jmin(lookaheadTargetFrames.load() - getFramesInLookahead(), space, processSize);
+    if (shortfall <= 0)
+        return false;
+
+    // A pass ends where the next tempo or pitch change is due
+    const int framesToStretch = applyParameterChanges(shortfall);
+    updateParameters();
+
+    bool sourceRanDry = false;
+    const int retrieved = stretchIntoRings(framesToStretch, sourceRanDry);
+    lookaheadSourceDry.store(sourceRanDry);
+
+    if (retrieved <= 0)
+        return false;
+
+    stretchedFrames += retrieved;
+    return true;
+}
+
+int RubberBandNode::stretchIntoRings(int numFrames, bool& sourceRanDry)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        outputPointers[channel] = workerBuffer.getWritePointer(channel);
+
+    const int retrieved = renderOutput(nullptr, numFrames, sourceRanDry);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        lookaheadRings[static_cast<size_t>(channel)].write(workerBuffer.getReadPointer(channel), static_cast<size_t>(retrieved));
+
+    return retrieved;
+}
+
+void RubberBandNode::processFromLookahead(juce::AudioBuffer<float>& buffer, int lookahead)
+{
+    const int numSamples = buffer.getNumSamples();
+    auto state = workerState.load();
+
+    lookaheadTargetFrames.store(juce::jmin(juce::jmin(lookahead, MAX_LOOKAHEAD_BLOCKS) * numSamples,
+                                           LOOKAHEAD_CAPACITY_FRAMES - processSize));
+
+    // On the way out the rings play out while the worker lets go
+    if (state == WorkerState::Running && lookahead == 0)
+        workerState.store(state = WorkerState::Stopping);
+
+    // Handing over, this much has to be in hand for the worker to carry on
+    // without a gap; it tops the rings up to the full lookahead itself
+    const int handoverFrames = juce::jmin(lookaheadTargetFrames.load(), 2 * numSamples);
+
+    if (state == WorkerState::Idle)
+    {
+        // Stretching inline, through the rings: what is left in them plays
+        // first. On the way in, a block more is stretched each time until
+        // there is enough to hand over.
+        if (needsReset)
+        {
+            for (auto& ring : lookaheadRings)
+                ring.discard();
+        }
+
+        prepareInlineBlock();
+
+        const int framesWanted = numSamples + (lookahead > 0 ? handoverFrames : 0) - getFramesInLookahead();
+        int framesLeft = juce::jmin(juce::jmin(framesWanted, 2 * numSamples), static_cast<int>(lookaheadRings[0].space()));
+        bool sourceRanDry = false;
+
+        while (framesLeft > 0)
+        {
+            const int framesToStretch = juce::jmin(framesLeft, processSize);
+            const int retrieved = stretchIntoRings(framesToStretch, sourceRanDry);
+            framesLeft -= framesToStretch;
+
+            if (retrieved < framesToStretch)
+                break;
+        }
+
+        lookaheadSourceDry.store(sourceRanDry);
+    }
+    else if (state == WorkerState::Running)
+    {
+        queueParameterChange();
     }
+
+    const int numOutputChannels = juce::jmin(buffer.getNumChannels(), numChannels);
+    const int framesToRead = juce::jmin(numSamples, getFramesInLookahead());
+
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+        lookaheadRings[static_cast<size_t>(channel)].read(buffer.getWritePointer(channel), static_cast<size_t>(framesToRead));
+
+    playedFrames += framesToRead;
+
+    if (framesToRead < numSamples)
+    {
+        buffer.clear(framesToRead, numSamples - framesToRead);
+
+        // Only an underrun if there was audio to give but it fell behind
+        if (!lookaheadSourceDry.load())
+            starvedBlockCount.fetch_add(1);
+    }
+
+    const int buffered = getFramesInLookahead();
+    bufferedFrames.store(buffered);
+    peakBufferedFrames.store(juce::jmax(peakBufferedFrames.load(), buffered));
+
+    if (state == WorkerState::Idle && lookahead > 0 && buffered >= handoverFrames)
+    {
+        // Both clocks start from here, with the settings just stretched at
+        // as the last ones queued
+        playedFrames = 0;
+        stretchedFrames = buffered;
+        lastQueuedChange = { 0, timeRatioSmoother.getTargetValue(), pitchScaleSmoother.getTargetValue() };
+        workerState.store(WorkerState::Running);
+    }
+}
+
+void RubberBandNode::queueParameterChange()
+{
+    const ParameterChange change { playedFrames, timeRatio.load(), pitchScale.load() };
+
+    if (change.timeRatio == lastQueuedChange.timeRatio && change.pitchScale == lastQueuedChange.pitchScale)
+        return;
+
+    // A full queue is retried next block rather than losing the change
+    if (parameterQueue.write(&change, 1))
+        lastQueuedChange = change;
+}
+
+int RubberBandNode::applyParameterChanges(int maxFrames)
+{
+    for (;;)
+    {
+        if (!hasPendingChange && !parameterQueue.read(&pendingChange, 1))
+            return maxFrames;
+
+        hasPendingChange = true;
+
+        // Held until the stretcher reaches the output frame it was set at,
+        // plus the lookahead, so every change is heard the same time after
+        // being set however full the rings were
+        const int64_t dueFrame = pendingChange.frame + lookaheadTargetFrames.load();
+        if (stretchedFrames < dueFrame)
+            return static_cast<int>(juce::jmin<int64_t>(maxFrames, dueFrame - stretchedFrames));
+
+        timeRatioSmoother.setTargetValue(pendingChange.timeRatio);
+        pitchScaleSmoother.setTargetValue(pendingChange.pitchScale);
+        parameterLatencyFrames.store(static_cast<int>(stretchedFrames - pendingChange.frame));
+        hasPendingChange = false;
+    }
+}
+
+int RubberBandNode::getFramesInLookahead() const
+{
+    // The worker writes the channels one after another, so take the shortest
+    size_t frames = lookaheadRings[0].available();
+    for (int channel = 1; channel < numChannels; ++channel)
+        frames = juce::jmin(frames, lookaheadRings[static_cast<size_t>(channel)].available());
+
+    return static_cast<int>(frames);
+}
+
+void RubberBandNode::setLookaheadBlocks(int blocks)
+{
+    lookaheadBlocks.store(juce::jlimit(0, MAX_LOOKAHEAD_BLOCKS, blocks));
 }
 
 void RubberBandNode::setTimeRatio(float ratio)
 {
-    // Clamp to reasonable range: 0.25x to 4x speed
+    // Clamp to reasonable range: 0.25x to 4x speed. Whichever thread is
+    // stretching picks it up from here.
     float clampedRatio = juce::jlimit(0.25f, 4.0f, ratio);
     timeRatio.store(clampedRatio);
-    timeRatioSmoother.setTargetValue(clampedRatio);
 }
 
 void RubberBandNode::setPitchScale(float scale)
@@ -172,5 +1468,4 @@ void RubberBandNode::setPitchScale(float scale)
     // Clamp pitch scale to reasonable range (±2 octaves)
     float clampedScale = juce::jlimit(0.25f, 4.0f, scale);
     pitchScale.store(clampedScale);
-    pitchScaleSmoother.setTargetValue(clampedScale);
 }
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
 #include <memory>
 #include <atomic>
+#include <thread>
 
+#include "AudioPullSource.h"
+#include "StretchedLoopCache.h"
+#include "WsolaStretcher.h"
+#include "Utils/LockFreeRingBuffer.h"
 #include "Utils/ParameterSmoother.h"
 
 // Forward declaration for Rubber Band
@@ -12,9 +18,50 @@ namespace RubberBand
     class RubberBandStretcher;
 }
 
+// Time stretch and pitch shift stage. Rubber Band gives the best quality;
+// the built-in WSOLA engine costs a fraction of the CPU, for machines that
+// run several instances. Either can be chosen while playing.
+//
+// With a pull source the node reads its input itself, as many frames as the
+// stretcher asks for, so every block comes out full at any ratio and the
+// stretcher never buffers more than it needs. Without one it stretches
+// whatever arrives through the graph, one block in for one block out.
+//
+// At a ratio and pitch of exactly one (most of the time) the stretcher is
+// skipped: the input goes through a delay line matching its latency, with a
+// short crossfade either way. On the way out the stretcher is restarted on
+// the delayed audio, a chunk per block while the bypass carries on, so it
+// lines up with the bypass from the first frame of the crossfade.
+//
+// With lookahead (which needs a pull source) the stretching moves off the
+// audio thread: a high-priority worker runs it a few blocks ahead into
+// lock-free rings, and the callback only copies finished audio out. Tempo
+// and pitch reach the worker through a queue stamped with the output frame
+// they were set at, and each is applied once the stretcher is that frame
+// plus the lookahead along, so changes land a fixed time after being set.
+//
+// A loop drilled at a steady tempo and pitch is stretched once more in the
+// background, offline and at higher quality; once that is ready, repeat
+// passes play from memory (crossfaded in and out) while the source is still
+// pulled along at the stretched rate, so its playhead and loop stay in step.
+//
+// Each engine runs as two instances. When a pulled source reaches its loop
+// end, the spare instance starts on the loop start from silence (so nothing
+// of the loop end smears into it, and its start delay is dropped rather
+// than heard) while the other is fed silence to play out the loop end; the
+// two are crossfaded at the exact wrap sample. Switching engines while
+// stretching is the same handover, except that the spare instance starts
+// on the new engine and the old one goes on being fed the input, so the
+// crossfade (as long as the bypass one) is between the same audio.
 class RubberBandNode : public juce::AudioProcessor
 {
 public:
+    enum class StretchEngine
+    {
+        RubberBand,
+        Wsola
+    };
+
     RubberBandNode();
     ~RubberBandNode() override;
 
@@ -23,6 +70,7 @@ public:
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
     bool acceptsMidi() const override { return false; }
     bool producesMidi() const override { return false; }
@@ -41,9 +89,199 @@ public:
     void setTimeRatio(float ratio);
     void setPitchScale(float scale);
 
+    // Tempo and pitch pass through two smoothers on their way here, so they
+    // can settle a hair away from the value sent; settings this close
+    // (relative) count as the same
+    static constexpr float SETTING_TOLERANCE = 1.0e-3f;
+    static bool settingsMatch(float value, float reference) { return std::abs(value - reference) <= SETTING_TOLERANCE * std::abs(reference); }
+
+    // Takes effect at the next block, crossfaded from the old engine, or
+    // once a crossfade already under way has finished
+    void setStretchEngine(StretchEngine engine) { stretchEngine.store(engine); }
+    StretchEngine getStretchEngine() const { return stretchEngine.load(); }
+
+    // Cheaper Rubber Band settings (no transient detection, independent
+    // phase) for a machine short of CPU; takes effect at the next block
+    void setEconomyMode(bool enabled) { economyMode.store(enabled); }
+    bool getEconomyMode() const { return economyMode.load(); }
+
+    // Set before playback starts; the source must outlive the node
+    void setPullSource(AudioPullSource* source) { pullSource = source; }
+
+    // Blocks to stretch ahead on the worker thread, 0 to stretch in the
+    // callback. Takes effect over the next few blocks: the rings are filled
+    // inline before the worker takes over, and played out after it lets go.
+    void setLookaheadBlocks(int blocks);
+    int getLookaheadBlocks() const { return lookaheadBlocks.load(); }
+
+    // Offline-stretched copy of [startSeconds, endSeconds) of the file at
+    // these settings, played instead of live stretching once ready and for as
+    // long as the settings, loop and position still match
+    void requestLoopCache(const juce::File& file, double startSeconds, double endSeconds, float timeRatio, float pitchScale);
+    void clearLoopCache() { loopCache.clear(); }
+    bool isPlayingLoopCache() const { return playingLoopCache.load(); }
+
+    // True while tempo and pitch are neutral and the input goes round the stretcher
+    bool isBypassingStretcher() const { return bypassingStretcher.load(); }
+
+    // Latency of each stretcher instance (they take turns at loop wraps)
+    int getInstanceLatencyFrames(int instance) const { return instanceLatencyFrames[static_cast<size_t>(instance & 1)].load(); }
+
+    // How many frames after being set a tempo or pitch change is heard (the
+    // lookahead, when threaded)
+    int getParameterLatencyFrames() const { return parameterLatencyFrames.load(); }
+
+    // Stretched frames left over after each block (waiting in the lookahead
+    // rings, when threaded), and blocks that came out short
+    int getBufferedFrames() const { return bufferedFrames.load(); }
+    int getPeakBufferedFrames() const { return peakBufferedFrames.load(); }
+    uint64_t getStarvedBlockCount() const { return starvedBlockCount.load(); }
+
 private:
-    // Rubber Band stretcher
-    std::unique_ptr<RubberBand::RubberBandStretcher> stretcher;
+    // Rubber Band stretchers, one per instance
+    std::array<std::unique_ptr<RubberBand::RubberBandStretcher>, 2> stretchers;
+
+    // Built-in alternative
+    std::array<WsolaStretcher, 2> wsolaStretchers;
+    std::atomic<StretchEngine> stretchEngine{StretchEngine::RubberBand};
+    StretchEngine activeEngine = StretchEngine::RubberBand;   // What instances are reset to (audio thread only)
+    std::array<StretchEngine, 2> instanceEngines{};           // What each instance is running
+    std::atomic<bool> economyMode{false};
+    bool economyApplied = false;                              // What the stretchers are set to
+    bool needsReset = false;                                  // Set while bypassed
+
+    // Pull model
+    static constexpr int MIN_PULL_FRAMES = 64;
+    static constexpr int MAX_PULLS_PER_BLOCK = 64;
+
+    AudioPullSource* pullSource = nullptr;
+    juce::AudioBuffer<float> pullBuffer;
+
+    // Identity path (owned by whichever thread is stretching)
+    enum class IdentityState
+    {
+        Stretching,
+        FadingToIdentity,
+        Identity,
+        FadingToStretch
+    };
+
+    static constexpr double IDENTITY_FADE_SECONDS = 0.02;
+
+    IdentityState identityState = IdentityState::Stretching;
+    std::atomic<bool> bypassingStretcher{false};
+    juce::AudioBuffer<float> history;   // Recent input, circular
+    int historyWritePosition = 0;
+    int identityDelay = 0;              // Frames the bypass lags the input by
+    int maxIdentityDelay = 0;
+    int identityFadeFrames = 1;
+    int identityFadePosition = 0;
+    bool measureIdentityDelay = false;
+    juce::AudioBuffer<float> stretchedBuffer;
+
+    // Restarting the stretcher to leave the bypass or the loop cache. It is
+    // fed the history it missed a chunk per block, while the old path keeps
+    // playing, and the tempo and pitch are held until it has caught up.
+    enum class Priming
+    {
+        None,
+        LeavingIdentity,
+        LeavingLoopCache
+    };
+
+    Priming priming = Priming::None;
+    int primingLag = 0;        // Input frames its output should trail the newest by
+    int primingBacklog = 0;    // History frames, up to the newest, still to feed it
+
+    // Loop wraps (owned by whichever thread is stretching). From the wrap the
+    // active instance takes the loop start, and the other one, fed silence,
+    // plays out what it owes of the loop end before fading under it. An
+    // engine switch does the same, with the outgoing instance fed the input.
+    static constexpr double WRAP_FADE_SECONDS = 0.003;
+
+    int activeInstance = 0;
+    bool wrapping = false;
+    bool switchingEngine = false;   // The wrap is an engine switch
+    int wrapTailFrames = 0;         // Output the outgoing instance owes up to the wrap sample
+    int wrapDiscardFrames = 0;      // Start delay still to drop from the active instance
+    int wrapFadeFrames = 1;
+    int wrapFadeLength = 1;         // wrapFadeFrames, or identityFadeFrames for an engine switch
+    int wrapFadePosition = 0;
+    juce::AudioBuffer<float> silenceBuffer;
+    juce::AudioBuffer<float> wrapBuffer;
+    std::array<std::atomic<int>, 2> instanceLatencyFrames{};
+
+    // Where each instance's output comes from: input fed since its reset
+    // (start pad included), and the fed frame its next frame out was taken
+    // from. Output frame k of a reset stretcher is taken from fed frame
+    // (k - start delay) / ratio + start pad.
+    std::array<int64_t, 2> instanceFedFrames{};
+    std::array<double, 2> instanceOutputSources{};
+    std::array<double, 2> instanceTimeRatios{ 1.0, 1.0 };
+
+    // Offline loop cache (state owned by whichever thread is stretching)
+    enum class LoopCacheState
+    {
+        Off,
+        FadingIn,
+        Playing,
+        FadingOut
+    };
+
+    StretchedLoopCache loopCache;
+    LoopCacheState loopCacheState = LoopCacheState::Off;
+    StretchedLoopCache::Region loopCacheRegion;
+    double loopCachePosition = 0.0;     // Read position in the stretched region
+    double loopCacheLag = 0.0;          // Output frames the cache lags the source by
+    double loopCachePullRemainder = 0.0;
+    int64_t loopCacheSourceFrame = -1;  // Where the source should be next
+    float loopCacheGain = 1.0f;
+    int loopCacheFadePosition = 0;
+    juce::AudioBuffer<float> loopCacheBuffer;
+    std::atomic<bool> playingLoopCache{false};
+
+    // Threaded lookahead. The worker only touches the stretchers while
+    // Running; the audio thread moves Idle -> Running -> Stopping and the
+    // worker hands back with Stopping -> Idle, so one thread owns them at a time.
+    enum class WorkerState
+    {
+        Idle,
+        Running,
+        Stopping
+    };
+
+    struct ParameterChange
+    {
+        int64_t frame = 0;   // Output frame (audio thread clock) it was set at
+        float timeRatio = 1.0f;
+        float pitchScale = 1.0f;
+    };
+
+    static constexpr int MAX_LOOKAHEAD_BLOCKS = 32;
+    static constexpr int WORKER_BLOCK_FRAMES = 512;           // Stretched per pass, whatever the device block
+    static constexpr int LOOKAHEAD_CAPACITY_FRAMES = 16384;   // ~340ms at 48kHz
+    static constexpr int PARAMETER_QUEUE_CAPACITY = 64;
+
+    std::atomic<int> lookaheadBlocks{0};
+    std::jthread lookaheadThread;
+    std::atomic<bool> shouldStopLookahead{false};
+    std::atomic<WorkerState> workerState{WorkerState::Idle};
+    std::atomic<int> lookaheadTargetFrames{0};
+    std::atomic<bool> lookaheadSourceDry{false};
+    std::array<LockFreeRingBuffer<float>, 2> lookaheadRings;
+    LockFreeRingBuffer<ParameterChange> parameterQueue;
+    std::atomic<int> parameterLatencyFrames{0};
+
+    int64_t playedFrames = 0;             // Audio thread only
+    ParameterChange lastQueuedChange;     // Audio thread only
+    int64_t stretchedFrames = 0;          // Worker only (set by the audio thread at handover)
+    ParameterChange pendingChange;        // Worker only: read from the queue, not yet due
+    bool hasPendingChange = false;        // Worker only
+
+    // Occupancy metrics (written by the audio thread)
+    std::atomic<int> bufferedFrames{0};
+    std::atomic<int> peakBufferedFrames{0};
+    std::atomic<uint64_t> starvedBlockCount{0};
     
     // Parameter smoothing
     ParameterSmoother<float> timeRatioSmoother;
@@ -56,15 +294,71 @@ private:
     // Audio processing state
     double sampleRate = 44100.0;
     int blockSize = 512;
+    int processSize = 512;   // Largest stretcher call: the block, or a worker pass if larger
     int numChannels = 2;
     
     // Processing buffers
-    std::vector<float> tempBuffer;
+    juce::AudioBuffer<float> workerBuffer;
     std::vector<const float*> inputPointers;
     std::vector<float*> outputPointers;
     
     void initializeStretcher();
+    void updateEngine(bool forceReset);
+    void applyEconomyMode();
+    void resetStretcher();                    // Both instances, abandoning any wrap
+    int getStretcherLatency() const;          // Of the active instance
     void updateParameters();
+    void prepareInlineBlock();   // Audio thread: engine and settings, before stretching a block itself
+    void setInstanceParameters(int instance, float ratio, float scale);
+    bool pullIntoStretcher(int numSamples);   // False if the source ran dry
+    int stretcherSamplesRequired() const;
+    int stretcherAvailable() const;           // What can be retrieved in order, across a wrap
+    void processStretcher(int numFrames);
+    int retrieveFromStretcher(float* const* destination, int numFrames);
+
+    // One instance, on whichever engine it is running (reset puts it on the active one)
+    void resetInstance(int instance);
+    int getInstanceLatency(int instance) const;
+    double getInstanceHold(int instance) const;   // Input frames fed that have yet to come out
+    int getInstanceStartPad(int instance) const;
+    int getInstanceStartDelay(int instance) const;
+    int instanceAvailable(int instance) const;
+    void processInstance(int instance, const float* const* input, int numFrames);
+    int retrieveFromInstance(int instance, float* const* destination, int numFrames);
+
+    void beginWrap();
+    void beginEngineSwitch();
+    void dropWrapStartDelay();
+
+    // Writes numFrames to outputPointers from the loop cache or renderFrames
+    int renderOutput(const float* const* pushedInput, int numFrames, bool& sourceRanDry);
+    void updateLoopCacheState();
+    bool loopCacheMatches(const StretchedLoopCache::Region& region, int64_t sourceFrame) const;
+    double getLoopCachePositionFor(int64_t sourceFrame) const;
+    int playLoopCache(int numFrames, bool& sourceRanDry);
+    bool readLoopCache(float* const* destination, int numFrames);
+
+    // Writes numFrames to outputPointers, stretched or through the identity
+    // path; input is pulled unless pushedInput is given
+    int renderFrames(const float* const* pushedInput, int numFrames, bool& sourceRanDry);
+    bool isNeutral() const;
+    void updateIdentityState();
+    void lengthenIdentityDelay();
+    int findIdentityDelay(const float* const* stretched, int numFrames);   // Bypass delay that best matches a stretched block
+    void beginPriming(Priming reason, int lag);
+    bool continuePriming(int maxFrames);   // True once the stretcher has caught up
+    void writeHistory(const float* const* input, int numFrames);
+    void readHistory(float* const* destination, int framesBack, int numFrames);
+
+    void startLookaheadThread();
+    void stopLookaheadThread();
+    void runLookahead();
+    bool stretchAhead();                  // Worker: false when there was nothing to do
+    int stretchIntoRings(int numFrames, bool& sourceRanDry);   // By whichever thread owns the stretchers
+    void processFromLookahead(juce::AudioBuffer<float>& buffer, int lookahead);
+    void queueParameterChange();
+    int applyParameterChanges(int maxFrames);   // Worker: frames to stretch before the next change is due
+    int getFramesInLookahead() const;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RubberBandNode)
 };
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "SetlistPlayer.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+SetlistPlayer::SetlistPlayer()
+{
+    for (auto& deck : decks)
+        deck = std::make_unique<AudioFileSource>();
+
+    prefetchThread = std::jthread([this]() { runPrefetch(); });
+}
+
+SetlistPlayer::~SetlistPlayer()
+{
+    shouldStopPrefetching.store(true);
+
+    if (prefetchThread.joinable())
+    {
+        prefetchThread.join();
+    }
+
+    for (auto& deck : decks)
+        deck->closeFile();
+}
+
+bool SetlistPlayer::loadFile(const juce::File& file)
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    setlistIndex.store(-1);
+    return replaceCurrentSong(file);
+}
+
+void SetlistPlayer::closeFile()
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    cancelNextSong();
+    setlistIndex.store(-1);
+
+    for (auto& deck : decks)
+        deck->closeFile();
+}
+
+void SetlistPlayer::setSetlist(const juce::Array<juce::File>& files)
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    // The current song keeps playing, but is no longer part of a setlist
+    cancelNextSong();
+    setlist = files;
+    setlistIndex.store(-1);
+}
+
+juce::Array<juce::File> SetlistPlayer::getSetlist() const
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+    return setlist;
+}
+
+bool SetlistPlayer::playSetlistItem(int index)
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    if (!juce::isPositiveAndBelow(index, setlist.size()))
+        return false;
+
+    if (!replaceCurrentSong(setlist[index]))
+    {
+        setlistIndex.store(-1);
+        return false;
+    }
+
+    setlistIndex.store(index);
+    prefetchRequest.store(index + 1);
+    return true;
+}
+
+AudioFileSource* SetlistPlayer::getCurrentSource() const
+{
+    return decks[static_cast<size_t>(deckState.load() & ACTIVE_DECK)].get();
+}
+
+void SetlistPlayer::setDiskCacheEnabled(bool enabled)
+{
+    for (auto& deck : decks)
+        deck->setDiskCacheEnabled(enabled);
+}
+
+void SetlistPlayer::setNormalization(bool enabled, double targetLufs)
+{
+    // Each deck applies its own song's gain, so a switch changes gain on the exact sample
+    for (auto& deck : decks)
+        deck->setNormalization(enabled, targetLufs);
+}
+
+int SetlistPlayer::cancelNextSong()
+{
+    // Once the flag is cleared the audio thread can no longer switch decks,
+    // so the returned deck stays the playing one while loadMutex is held
+    const int activeDeck = deckState.fetch_and(ACTIVE_DECK) & ACTIVE_DECK;
+
+    ++prefetchGeneration;
+    prefetchRequest.store(-1);
+    nextSetlistIndex.store(-1);
+    decks[static_cast<size_t>(activeDeck ^ 1)]->closeFile();
+
+    return activeDeck;
+}
+
+bool SetlistPlayer::replaceCurrentSong(const juce::File& file)
+{
+    // The playing deck is left alone while the song loads into the idle one
+    const int activeDeck = cancelNextSong();
+    const int idleDeck = activeDeck ^ 1;
+
+    if (!loadIntoDeck(*decks[static_cast<size_t>(idleDeck)], file))
+        return false;
+
+    // With NEXT_READY clear the audio thread never switches decks itself
+    deckState.store(idleDeck);
+
+    // It may still be part way through a block from the old deck
+    while (renderingDecks.load())
+        std::this_thread::yield();
+
+    decks[static_cast<size_t>(activeDeck)]->closeFile();
+    return true;
+}
+
+bool SetlistPlayer::loadIntoDeck(AudioFileSource& deck, const juce::File& file)
+{
+    // Each song starts out playing forwards and through, like a fresh AudioEngine::loadAudioFile
+    deck.setReversePlayback(false);
+
+    if (!deck.loadFile(file))
+        return false;
+
+    deck.setLoopPoints(0.0, deck.getTotalLength());
+    deck.setLoopEnabled(false);
+    return true;
+}
+
+void SetlistPlayer::runPrefetch()
+{
+    while (!shouldStopPrefetching.load())
+    {
+        // The audio thread has moved on to the next song: line up the one after it
+        if (deckSwitched.exchange(false))
+        {
+            const int index = setlistIndex.load();
+            if (index >= 0)
+                prefetchRequest.store(index + 1);
+        }
+
+        const int index = prefetchRequest.exchange(-1);
+
+        if (index >= 0)
+            prefetch(index);
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void SetlistPlayer::prefetch(int index)
+{
+    AudioFileSource* deck = nullptr;
+    uint32_t generation = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+
+        // Nothing can switch decks while the flag is clear, so the idle deck is ours
+        deck = decks[static_cast<size_t>((deckState.load() & ACTIVE_DECK) ^ 1)].get();
+        generation = prefetchGeneration.load();
+
+        // Songs that fail to open are skipped rather than ending the set
+        while (juce::isPositiveAndBelow(index, setlist.size()) && !loadIntoDeck(*deck, setlist[index]))
+        {
+            juce::Logger::writeToLog("SetlistPlayer: Skipping " + setlist[index].getFileName());
+            ++index;
+        }
+
+        if (!juce::isPositiveAndBelow(index, setlist.size()))
+            return;
+    }
+
+    // Let its decode thread get ahead so the switch never starts on an empty
+    // FIFO. This happens outside the lock, so a load made meanwhile need not
+    // wait for it; one that does take the idle deck back bumps the generation.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+
+    while (deck->getBufferedSeconds() < PREFETCH_SECONDS && !deck->hasFinished()
+           && prefetchGeneration.load() == generation && !shouldStopPrefetching.load()
+           && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    if (prefetchGeneration.load() != generation || shouldStopPrefetching.load())
+        return;
+
+    nextSetlistIndex.store(index);
+    deckState.fetch_or(NEXT_READY);
+}
+
+// AudioProcessor implementation
+const juce::String SetlistPlayer::getName() const
+{
+    return "SetlistPlayer";
+}
+
+void SetlistPlayer::prepareToPlay(double newSampleRate, int samplesPerBlock)
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    // At top speed varispeed reads several blocks' worth from the decks at once
+    const int maxDeckFrames = static_cast<int>(std::ceil(samplesPerBlock * VarispeedResampler::MAX_SPEED))
+                            + VarispeedResampler::TAPS + 2;
+
+    maxBlockSize = samplesPerBlock;
+    varispeed.prepare(newSampleRate, samplesPerBlock);
+    varispeedInput.setSize(AudioDecoder::NUM_OUTPUT_CHANNELS, maxDeckFrames);
+    varispeedActive = false;
+
+    // The idle deck must be ready to take over mid-block at the device rate
+    for (auto& deck : decks)
+        deck->prepareToPlay(newSampleRate, maxDeckFrames);
+}
+
+void SetlistPlayer::releaseResources()
+{
+    for (auto& deck : decks)
+        deck->releaseResources();
+}
+
+void SetlistPlayer::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+
+    buffer.clear();
+
+    // Being pulled: the node downstream reads through pullAudio instead
+    if (pulled.load())
+        return;
+
+    renderingDecks.store(true);
+    render(buffer, 0, buffer.getNumSamples());
+    renderingDecks.store(false);
+}
+
+int SetlistPlayer::pullAudio(juce::AudioBuffer<float>& destination, int numFrames)
+{
+    // In pieces no larger than the block the decks and varispeed were prepared for
+    int framesWritten = 0;
+    renderingDecks.store(true);
+
+    while (framesWritten < numFrames)
+    {
+        const int framesToRender = juce::jmin(numFrames - framesWritten, maxBlockSize);
+        const int framesRendered = render(destination, framesWritten, framesToRender);
+
+        framesWritten += framesRendered;
+
+        if (framesRendered < framesToRender)
+            break;
+    }
+
+    renderingDecks.store(false);
+    return framesWritten;
+}
+
+int64_t SetlistPlayer::getNextPullFrame() const
+{
+    // Varispeed reads ahead of what it plays, so its input position is no guide
+    if (varispeedActive)
+        return -1;
+
+    const AudioFileSource& deck = *decks[static_cast<size_t>(deckState.load() & ACTIVE_DECK)];
+    if (!deck.isFileLoaded() || deck.isPlayingBackwards() || deck.isReversePlayback())
+        return -1;
+
+    return deck.getPlayheadFrame();
+}
+
+int SetlistPlayer::getFramesUntilWrap() const
+{
+    if (getNextPullFrame() < 0)
+        return -1;
+
+    const auto frames = decks[static_cast<size_t>(deckState.load() & ACTIVE_DECK)]->getFramesUntilLoopWrap();
+    return static_cast<int>(juce::jmin<int64_t>(frames, std::numeric_limits<int>::max()));
+}
+
+float SetlistPlayer::getPullGain() const
+{
+    return decks[static_cast<size_t>(deckState.load() & ACTIVE_DECK)]->getNormalizationGain();
+}
+
+int SetlistPlayer::render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const bool useVarispeed = varispeedEnabled.load();
+
+    if (useVarispeed != varispeedActive)
+    {
+        // Coming in, glide from normal speed like a tape deck would
+        varispeedActive = useVarispeed;
+        varispeed.reset();
+        varispeed.setSpeedImmediately(1.0f);
+    }
+
+    if (!varispeedActive)
+        return renderDecks(buffer, startSample, numSamples);
+
+    varispeed.setSpeed(varispeedSpeed.load());
+
+    const int framesNeeded = juce::jmin(varispeed.getInputFramesNeeded(numSamples), varispeedInput.getNumSamples());
+    const int framesRendered = renderDecks(varispeedInput, 0, framesNeeded);
+
+    const int numChannels = juce::jmin(buffer.getNumChannels(), VarispeedResampler::MAX_CHANNELS);
+    std::array<float*, VarispeedResampler::MAX_CHANNELS> outputs {};
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        outputs[static_cast<size_t>(channel)] = buffer.getWritePointer(channel, startSample);
+
+    return varispeed.process(varispeedInput.getArrayOfReadPointers(), framesRendered,
+                             outputs.data(), numSamples, numChannels);
+}
+
+int SetlistPlayer::renderDecks(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    int state = deckState.load();
+
+    AudioFileSource& deck = *decks[static_cast<size_t>(state & ACTIVE_DECK)];
+    const int framesRendered = deck.renderBlock(buffer, startSample, numSamples);
+
+    if ((state & NEXT_READY) == 0 || !deck.hasFinished())
+        return framesRendered;
+
+    // The song has ended: carry on with the next one from the very next sample
+    const int nextDeck = (state & ACTIVE_DECK) ^ 1;
+
+    if (!deckState.compare_exchange_strong(state, nextDeck))
+        return framesRendered;
+
+    setlistIndex.store(nextSetlistIndex.load());
+    deckSwitched.store(true);
+
+    if (framesRendered == numSamples)
+        return framesRendered;
+
+    return framesRendered + decks[static_cast<size_t>(nextDeck)]->renderBlock(buffer, startSample + framesRendered,
+                                                                              numSamples - framesRendered);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "AudioFileSource.h"
+#include "AudioPullSource.h"
+#include "Utils/VarispeedResampler.h"
+
+// Source node for the graph that plays a setlist without gaps. Two
+// AudioFileSource decks take turns: while one plays, the next song is opened
+// and pre-decoded into the other on a background thread. When the playing
+// deck runs out, the audio thread carries on from the other deck in the same
+// block, at the sample where the first one stopped. Switching decks is a
+// single atomic update, so nothing is allocated or freed on the audio thread.
+// In varispeed mode the decks are read faster or slower than real time
+// through a resampler, like a tape deck: pitch follows speed.
+// When a time stretcher downstream pulls from the player, processBlock
+// sends silence down the graph and all audio leaves through pullAudio.
+class SetlistPlayer : public juce::AudioProcessor,
+                      public AudioPullSource
+{
+public:
+    SetlistPlayer();
+    ~SetlistPlayer() override;
+
+    // Single file, no setlist (replaces the current song immediately: it is
+    // loaded into the idle deck, which then takes over)
+    bool loadFile(const juce::File& file);
+    void closeFile();
+
+    // Setlist
+    void setSetlist(const juce::Array<juce::File>& files);
+    juce::Array<juce::File> getSetlist() const;
+    bool playSetlistItem(int index);   // Loads immediately, then prefetches the next song
+    int getSetlistIndex() const { return setlistIndex.load(); }   // -1 without a setlist
+    bool isNextSongReady() const { return (deckState.load() & NEXT_READY) != 0; }
+
+    // The deck that is playing. Both decks live as long as the player, so the
+    // pointer stays valid; after a switch it simply refers to the idle deck.
+    AudioFileSource* getCurrentSource() const;
+
+    // Varispeed (speed 1 is normal; 0.5 is half speed, an octave down)
+    void setVarispeedEnabled(bool enabled) { varispeedEnabled.store(enabled); }
+    bool isVarispeedEnabled() const { return varispeedEnabled.load(); }
+    void setVarispeedSpeed(float speed) { varispeedSpeed.store(speed); }
+
+    // Pull model (see AudioPullSource)
+    void setPulled(bool isPulled) { pulled.store(isPulled); }
+    int pullAudio(juce::AudioBuffer<float>& destination, int numFrames) override;
+    int64_t getNextPullFrame() const override;
+    int getFramesUntilWrap() const override;
+    float getPullGain() const override;
+
+    // Applied to both decks
+    void setDiskCacheEnabled(bool enabled);
+    void setNormalization(bool enabled, double targetLufs);
+
+    // AudioProcessor overrides
+    const juce::String getName() const override;
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
+
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+    double getTailLengthSeconds() const override { return 0.0; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+
+    void getStateInformation(juce::MemoryBlock&) override {}
+    void setStateInformation(const void*, int) override {}
+
+    // How much of the next song is decoded before it counts as ready
+    static constexpr double PREFETCH_SECONDS = 0.5;
+
+private:
+    // deckState packs the playing deck (bit 0) with a flag saying the other
+    // deck holds the next song, so the audio thread can claim both at once
+    static constexpr int ACTIVE_DECK = 1;
+    static constexpr int NEXT_READY = 2;
+
+    std::array<std::unique_ptr<AudioFileSource>, 2> decks;
+    std::atomic<int> deckState{0};
+
+    // Setlist (protected by loadMutex)
+    juce::Array<juce::File> setlist;
+    std::atomic<int> setlistIndex{-1};
+    std::atomic<int> nextSetlistIndex{-1};   // Song waiting in the idle deck
+
+    // Loading happens on the caller's thread or the prefetch thread, one at a time
+    mutable std::mutex loadMutex;
+
+    // Prefetch thread
+    std::jthread prefetchThread;
+    std::atomic<bool> shouldStopPrefetching{false};
+    std::atomic<int> prefetchRequest{-1};
+    std::atomic<uint32_t> prefetchGeneration{0};   // Bumped whenever the idle deck is taken back
+    std::atomic<bool> deckSwitched{false};
+
+    // Set while the audio thread is reading the decks
+    std::atomic<bool> renderingDecks{false};
+
+    std::atomic<bool> pulled{false};
+    int maxBlockSize = 512;
+
+    // Varispeed (the resampler and its input buffer are audio thread only)
+    std::atomic<bool> varispeedEnabled{false};
+    std::atomic<float> varispeedSpeed{1.0f};
+    bool varispeedActive = false;
+    VarispeedResampler varispeed;
+    juce::AudioBuffer<float> varispeedInput;
+
+    void runPrefetch();
+    void prefetch(int index);
+    bool replaceCurrentSong(const juce::File& file);
+    bool loadIntoDeck(AudioFileSource& deck, const juce::File& file);
+    int cancelNextSong();
+    int render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    int renderDecks(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SetlistPlayer)
+};
@@ -0,0 +1,317 @@
+#include "StretchedLoopCache.h"
+
+#include <rubberband/RubberBandStretcher.h>
+#include <cmath>
+
+StretchedLoopCache::StretchedLoopCache()
+{
+    renderThread = std::jthread([this]() { runRenderer(); });
+}
+
+StretchedLoopCache::~StretchedLoopCache()
+{
+    // A render stops within one chunk of this
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        shouldStop.store(true);
+    }
+
+    requestChanged.notify_one();
+
+    if (renderThread.joinable())
+    {
+        renderThread.join();
+    }
+}
+
+void StretchedLoopCache::setOutputSampleRate(double newSampleRate)
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+
+        if (newSampleRate == requested.outputSampleRate)
+            return;
+
+        requested.outputSampleRate = newSampleRate;
+        ++requestGeneration;
+    }
+
+    // Cached frames are counted at the old rate
+    {
+        std::lock_guard<std::mutex> lock(regionMutex);
+        regionReady = false;
+        ++region.generation;
+    }
+
+    requestChanged.notify_one();
+}
+
+void StretchedLoopCache::request(const juce::File& file, double startSeconds, double endSeconds, float timeRatio, float pitchScale)
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        const Request newRequest { file, requested.outputSampleRate, startSeconds, endSeconds, timeRatio, pitchScale };
+
+        if (hasRequest && newRequest == requested)
+            return;
+
+        // Dragging the tempo or a loop marker produces a stream of requests; only
+        // the latest matters, and the render thread drops whatever it was doing
+        requested = newRequest;
+        hasRequest = true;
+        ++requestGeneration;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(regionMutex);
+        regionReady = false;
+    }
+
+    requestChanged.notify_one();
+}
+
+void StretchedLoopCache::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        hasRequest = false;
+        ++requestGeneration;
+    }
+
+    juce::AudioBuffer<float> released;
+
+    {
+        std::lock_guard<std::mutex> lock(regionMutex);
+        std::swap(stretched, released);
+        regionReady = false;
+        ++region.generation;
+    }
+
+    // The old region is freed here, outside the lock
+}
+
+bool StretchedLoopCache::isAbandoned(uint64_t generation) const
+{
+    return shouldStop.load() || requestGeneration.load() != generation;
+}
+
+void StretchedLoopCache::runRenderer()
+{
+    uint64_t renderedGeneration = 0;
+
+    for (;;)
+    {
+        Request request;
+        bool shouldRender = false;
+
+        {
+            std::unique_lock<std::mutex> lock(requestMutex);
+            requestChanged.wait(lock, [&]() { return shouldStop.load() || requestGeneration.load() != renderedGeneration; });
+
+            if (shouldStop.load())
+                return;
+
+            request = requested;
+            shouldRender = hasRequest;
+            renderedGeneration = requestGeneration.load();
+        }
+
+        if (shouldRender && request.outputSampleRate > 0.0 && request.file != juce::File()
+            && request.endSeconds > request.startSeconds)
+        {
+            renderRegion(request, renderedGeneration);
+        }
+    }
+}
+
+void StretchedLoopCache::renderRegion(const Request& request, uint64_t generation)
+{
+    // Counted exactly as AudioFileSource counts its loop points
+    const auto startFrame = static_cast<int64_t>(request.startSeconds * request.outputSampleRate);
+    const auto endFrame = static_cast<int64_t>(request.endSeconds * request.outputSampleRate);
+
+    if ((endFrame - startFrame) * juce::jmax(1.0f, request.timeRatio) > MAX_REGION_SECONDS * request.outputSampleRate)
+    {
+        juce::Logger::writeToLog("StretchedLoopCache: Loop too long to cache, stretching live instead");
+        return;
+    }
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    juce::AudioBuffer<float> input;
+    if (!decodeRegion(request, generation, startFrame, endFrame, input))
+        return;
+
+    juce::AudioBuffer<float> rendered;
+    if (!stretchRegion(request, generation, input, rendered))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(regionMutex);
+
+        // Checked under the lock, so a request made meanwhile cannot be marked ready with this audio
+        if (isAbandoned(generation))
+            return;
+
+        std::swap(stretched, rendered);
+
+        region.startFrame = startFrame;
+        region.endFrame = startFrame + input.getNumSamples();   // Short of endFrame if the file ended first
+        region.timeRatio = request.timeRatio;
+        region.pitchScale = request.pitchScale;
+        region.numFrames = stretched.getNumSamples();
+        ++region.generation;
+        regionReady = true;
+    }
+
+    // The previous region is freed here, outside the lock
+    juce::Logger::writeToLog("StretchedLoopCache: Stretched " + juce::String(input.getNumSamples()) + " frames in "
+                             + juce::String(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0, 0)
+                             + "ms");
+}
+
+bool StretchedLoopCache::decodeRegion(const Request& request, uint64_t generation, int64_t startFrame, int64_t endFrame, juce::AudioBuffer<float>& destination)
+{
+    if (decoderFile != request.file)
+    {
+        decoder.close();
+        decoderFile = juce::File();
+    }
+
+    decoder.setOutputSampleRate(request.outputSampleRate);
+    decoder.setResamplerQuality(AudioDecoder::ResamplerQuality::High);
+    decoder.setDecodeThreading(0);       // Bulk work, so use every core the codec can
+    decoder.setBuildSeekIndex(false);    // One seek per region needs no full-file scan
+
+    if (!decoder.isOpen())
+    {
+        if (!decoder.open(request.file))
+            return false;
+
+        decoderFile = request.file;
+    }
+
+    if (!decoder.seek(startFrame))
+        return false;
+
+    const auto lengthFrames = static_cast<int>(endFrame - startFrame);
+    destination.setSize(AudioDecoder::NUM_OUTPUT_CHANNELS, lengthFrames);
+    int framesDecoded = 0;
+
+    while (framesDecoded < lengthFrames && !isAbandoned(generation))
+    {
+        float* channelOutputs[AudioDecoder::NUM_OUTPUT_CHANNELS] = {
+            destination.getWritePointer(0, framesDecoded),
+            destination.getWritePointer(1, framesDecoded)
+        };
+
+        // In chunks, so a cancel does not wait on the whole region
+        const int framesRead = decoder.read(channelOutputs, juce::jmin(CHUNK_FRAMES, lengthFrames - framesDecoded));
+        if (framesRead <= 0)
+            break; // The loop end lies past the last decodable frame
+
+        framesDecoded += framesRead;
+    }
+
+    destination.setSize(AudioDecoder::NUM_OUTPUT_CHANNELS, framesDecoded, true);
+    return framesDecoded > 0 && !isAbandoned(generation);
+}
+
+bool StretchedLoopCache::stretchRegion(const Request& request, uint64_t generation, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& destination)
+{
+    using Stretcher = RubberBand::RubberBandStretcher;
+
+    // Time is no object here, so the finer engine with the channels analysed together
+    Stretcher stretcher(static_cast<size_t>(request.outputSampleRate), AudioDecoder::NUM_OUTPUT_CHANNELS,
+                        Stretcher::OptionProcessOffline | Stretcher::OptionEngineFiner
+                        | Stretcher::OptionChannelsTogether | Stretcher::OptionPitchHighQuality,
+                        request.timeRatio, request.pitchScale);
+
+    const int lengthFrames = input.getNumSamples();
+    stretcher.setExpectedInputDuration(static_cast<size_t>(lengthFrames));
+    stretcher.setMaxProcessSize(CHUNK_FRAMES);
+
+    // Offline mode reads everything once to plan the stretch, then processes it
+    for (int position = 0; position < lengthFrames && !isAbandoned(generation); position += CHUNK_FRAMES)
+    {
+        const int framesToStudy = juce::jmin(CHUNK_FRAMES, lengthFrames - position);
+        const float* channelInputs[AudioDecoder::NUM_OUTPUT_CHANNELS] = {
+            input.getReadPointer(0, position),
+            input.getReadPointer(1, position)
+        };
+
+        stretcher.study(channelInputs, static_cast<size_t>(framesToStudy), position + framesToStudy >= lengthFrames);
+    }
+
+    destination.setSize(AudioDecoder::NUM_OUTPUT_CHANNELS,
+                        static_cast<int>(std::ceil(lengthFrames * static_cast<double>(request.timeRatio))) + CHUNK_FRAMES);
+    int framesWritten = 0;
+
+    const auto retrieveAvailable = [&]()
+    {
+        for (int available = static_cast<int>(stretcher.available()); available > 0; available = static_cast<int>(stretcher.available()))
+        {
+            const int framesToRetrieve = juce::jmin(available, destination.getNumSamples() - framesWritten);
+            if (framesToRetrieve <= 0)
+                return;
+
+            float* channelOutputs[AudioDecoder::NUM_OUTPUT_CHANNELS] = {
+                destination.getWritePointer(0, framesWritten),
+                destination.getWritePointer(1, framesWritten)
+            };
+
+            framesWritten += static_cast<int>(stretcher.retrieve(channelOutputs, static_cast<size_t>(framesToRetrieve)));
+        }
+    };
+
+    for (int position = 0; position < lengthFrames && !isAbandoned(generation); position += CHUNK_FRAMES)
+    {
+        const int framesToProcess = juce::jmin(CHUNK_FRAMES, lengthFrames - position);
+        const float* channelInputs[AudioDecoder::NUM_OUTPUT_CHANNELS] = {
+            input.getReadPointer(0, position),
+            input.getReadPointer(1, position)
+        };
+
+        stretcher.process(channelInputs, static_cast<size_t>(framesToProcess), position + framesToProcess >= lengthFrames);
+        retrieveAvailable();
+    }
+
+    if (isAbandoned(generation))
+        return false;
+
+    retrieveAvailable();
+    destination.setSize(AudioDecoder::NUM_OUTPUT_CHANNELS, framesWritten, true);
+    return framesWritten > 0;
+}
+
+bool StretchedLoopCache::getReadyRegion(Region& result) const
+{
+    std::unique_lock<std::mutex> lock(regionMutex, std::try_to_lock);
+
+    if (!lock.owns_lock() || !regionReady)
+        return false;
+
+    result = region;
+    return true;
+}
+
+int StretchedLoopCache::read(uint32_t generation, int64_t frame, float* const* channelOutputs, int numChannels, int numFrames) const
+{
+    std::unique_lock<std::mutex> lock(regionMutex, std::try_to_lock);
+
+    if (!lock.owns_lock() || generation != region.generation || frame < 0)
+        return 0;
+
+    const int framesToCopy = static_cast<int>(juce::jmin<int64_t>(numFrames, stretched.getNumSamples() - frame));
+    if (framesToCopy <= 0)
+        return 0;
+
+    for (int channel = 0; channel < juce::jmin(numChannels, stretched.getNumChannels()); ++channel)
+    {
+        juce::FloatVectorOperations::copy(channelOutputs[channel],
+                                          stretched.getReadPointer(channel, static_cast<int>(frame)),
+                                          framesToCopy);
+    }
+
+    return framesToCopy;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "AudioDecoder.h"
+
+// Stretches a loop region once, in the background, with Rubber Band's
+// offline mode and finest settings, so a loop drilled at a fixed tempo and
+// pitch can be played from memory instead of being stretched again in real
+// time on every pass. Requests come from the message thread and only hand
+// the region over to the render thread, so they never wait for a render;
+// the audio thread reads without ever waiting on the lock.
+class StretchedLoopCache
+{
+public:
+    StretchedLoopCache();
+    ~StretchedLoopCache();
+
+    // A finished region. The generation changes whenever the audio behind it does.
+    struct Region
+    {
+        int64_t startFrame = -1;
+        int64_t endFrame = -1;
+        float timeRatio = 1.0f;
+        float pitchScale = 1.0f;
+        int64_t numFrames = 0;
+        uint32_t generation = 0;
+    };
+
+    // Frames are counted at this rate; changing it renders the current request again
+    void setOutputSampleRate(double newSampleRate);
+
+    // Starts rendering unless this is already cached or in progress; the
+    // previous region stays readable until the new one replaces it
+    void request(const juce::File& file, double startSeconds, double endSeconds, float timeRatio, float pitchScale);
+    void clear();
+
+    // Audio thread: false when nothing is ready (or the lock is busy)
+    bool getReadyRegion(Region& region) const;
+
+    // Audio thread: copies up to numFrames from frame onwards, or nothing
+    // if the region has changed generation (or the lock is busy)
+    int read(uint32_t generation, int64_t frame, float* const* channelOutputs, int numChannels, int numFrames) const;
+
+    static constexpr double MAX_REGION_SECONDS = 120.0;
+
+private:
+    struct Request
+    {
+        juce::File file;
+        double outputSampleRate = 0.0;
+        double startSeconds = 0.0;
+        double endSeconds = 0.0;
+        float timeRatio = 1.0f;
+        float pitchScale = 1.0f;
+
+        bool operator==(const Request& other) const
+        {
+            return file == other.file && outputSampleRate == other.outputSampleRate
+                && startSeconds == other.startSeconds && endSeconds == other.endSeconds
+                && timeRatio == other.timeRatio && pitchScale == other.pitchScale;
+        }
+    };
+
+    static constexpr int CHUNK_FRAMES = 8192;   // Frames processed between checks for a newer request
+
+    // The latest request (protected by requestMutex). Every change bumps the
+    // generation, which abandons whatever the render thread is working on.
+    std::mutex requestMutex;
+    std::condition_variable requestChanged;
+    Request requested;
+    bool hasRequest = false;
+    std::atomic<uint64_t> requestGeneration{0};
+
+    // Render thread
+    std::jthread renderThread;
+    std::atomic<bool> shouldStop{false};
+    AudioDecoder decoder;                // Only used by the render thread
+    juce::File decoderFile;              // What the decoder has open
+
+    // Published region (protected by mutex; the audio thread only tries it)
+    mutable std::mutex regionMutex;
+    juce::AudioBuffer<float> stretched;
+    Region region;
+    bool regionReady = false;
+
+    void runRenderer();
+    void renderRegion(const Request& request, uint64_t generation);
+    bool decodeRegion(const Request& request, uint64_t generation, int64_t startFrame, int64_t endFrame, juce::AudioBuffer<float>& destination);
+    bool stretchRegion(const Request& request, uint64_t generation, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& destination);
+    bool isAbandoned(uint64_t generation) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StretchedLoopCache)
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Decides how far to degrade quality to keep the audio callback on time.
+// Fed the callback's load (time spent over the buffer period) every so
+// often, it steps one level down when headroom runs short and one level
+// back up once load has stayed low for a while. Level 0 is full quality;
+// the caller decides what each further level gives up. Stepping back up
+// waits twice as long each time it has to be undone soon after, so a
+// machine sitting on the edge does not flip back and forth.
+class LoadGovernor
+{
+public:
+    static constexpr double STEP_DOWN_LOAD = 0.7;        // Average load that costs a level
+    static constexpr double STEP_UP_LOAD = 0.4;          // Average load that earns one back
+    static constexpr double STEP_DOWN_SECONDS = 0.5;     // Least time between steps down
+    static constexpr double STEP_UP_SECONDS = 5.0;       // Calm needed before a step up
+    static constexpr double MAX_STEP_UP_SECONDS = 60.0;
+
+    explicit LoadGovernor(int numLevels = 1) { setNumLevels(numLevels); }
+
+    void setNumLevels(int numLevels)
+    {
+        numLevels_ = std::max(1, numLevels);
+        reset();
+    }
+
+    void reset()
+    {
+        level_ = 0;
+        secondsAtLevel_ = 0.0;
+        calmSeconds_ = 0.0;
+        stepUpSeconds_ = STEP_UP_SECONDS;
+        steppedUp_ = false;
+    }
+
+    // Load over the last elapsedSeconds: the average, and the worst single
+    // callback (1 or more is a missed deadline). Returns +1 for a step down
+    // in quality, -1 for a step up, otherwise 0.
+    int update(double averageLoad, double peakLoad, double elapsedSeconds)
+    {
+        secondsAtLevel_ += elapsedSeconds;
+
+        const bool overloaded = averageLoad > STEP_DOWN_LOAD || peakLoad >= 1.0;
+        const bool calm = averageLoad < STEP_UP_LOAD && peakLoad < STEP_DOWN_LOAD;
+        calmSeconds_ = calm ? calmSeconds_ + elapsedSeconds : 0.0;
+
+        if (overloaded && level_ < numLevels_ - 1 && secondsAtLevel_ >= STEP_DOWN_SECONDS)
+        {
+            // Undoing a step up that came too soon: wait longer next time
+            if (steppedUp_ && secondsAtLevel_ < stepUpSeconds_)
+                stepUpSeconds_ = std::min(MAX_STEP_UP_SECONDS, stepUpSeconds_ * 2.0);
+
+            ++level_;
+            ++stepsDown_;
+            steppedUp_ = false;
+            secondsAtLevel_ = 0.0;
+            calmSeconds_ = 0.0;
+            return 1;
+        }
+
+        if (level_ > 0 && calmSeconds_ >= stepUpSeconds_)
+        {
+            --level_;
+            ++stepsUp_;
+            steppedUp_ = true;
+            secondsAtLevel_ = 0.0;
+            calmSeconds_ = 0.0;
+
+            // All the way back: the next bout of load starts from scratch
+            if (level_ == 0)
+                stepUpSeconds_ = STEP_UP_SECONDS;
+
+            return -1;
+        }
+
+        return 0;
+    }
+
+    int getLevel() const { return level_; }
+    int getNumLevels() const { return numLevels_; }
+    double getStepUpSeconds() const { return stepUpSeconds_; }
+    uint64_t getStepsDown() const { return stepsDown_; }
+    uint64_t getStepsUp() const { return stepsUp_; }
+
+private:
+    int numLevels_ = 1;
+    int level_ = 0;
+    double secondsAtLevel_ = 0.0;
+    double calmSeconds_ = 0.0;
+    double stepUpSeconds_ = STEP_UP_SECONDS;
+    bool steppedUp_ = false;
+    uint64_t stepsDown_ = 0;
+    uint64_t stepsUp_ = 0;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 
@@ -34,10 +35,10 @@ public:
             return false; // Not enough space
         }
         
-        for (size_t i = 0; i < count; ++i)
-        {
-            buffer_[(currentWriteIndex + i) % capacity_] = data[i];
-        }
+        // Copy in at most two contiguous runs rather than element by element
+        const size_t firstRun = std::min(count, capacity_ - currentWriteIndex);
+        std::copy(data, data + firstRun, buffer_.get() + currentWriteIndex);
+        std::copy(data + firstRun, data + count, buffer_.get());
         
         writeIndex_.store((currentWriteIndex + count) % capacity_);
         return true;
@@ -63,15 +64,21 @@ public:
             return false; // Not enough data
         }
         
-        for (size_t i = 0; i < count; ++i)
-        {
-            data[i] = buffer_[(currentReadIndex + i) % capacity_];
-        }
+        const size_t firstRun = std::min(count, capacity_ - currentReadIndex);
+        std::copy(buffer_.get() + currentReadIndex, buffer_.get() + currentReadIndex + firstRun, data);
+        std::copy(buffer_.get(), buffer_.get() + (count - firstRun), data + firstRun);
         
         readIndex_.store((currentReadIndex + count) % capacity_);
         return true;
     }
 
+    // Drops everything currently readable. Like read(), this must only be
+    // called from the consumer thread.
+    void discard()
+    {
+        readIndex_.store(writeIndex_.load());
+    }
+
     size_t available() const
     {
         const auto currentReadIndex = readIndex_.load();
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+// Result of a whole-file loudness scan
+struct LoudnessResult
+{
+    double integratedLufs = -70.0;    // EBU R128 / ITU-R BS.1770 gated loudness
+    double truePeakDb = -100.0;       // dBTP, from 4x oversampling
+    std::vector<float> blockRms;      // Plain RMS of each block, both channels
+    double blocksPerSecond = 0.0;
+    bool isValid = false;
+};
+
+// Stereo EBU R128 integrated loudness, true peak and per-block RMS, computed
+// in one streaming pass. Blocks are fed in any size; nothing is allocated per
+// sample, only one gating entry per 100ms is kept.
+class LoudnessMeter
+{
+public:
+    static constexpr double BLOCK_SECONDS = 0.1;      // Gating step and RMS block
+    static constexpr int BLOCKS_PER_WINDOW = 4;       // 400ms gating window, 75% overlap
+    static constexpr double ABSOLUTE_GATE_LUFS = -70.0;
+    static constexpr double RELATIVE_GATE_LU = -10.0;
+
+    LoudnessMeter() { reset(48000.0); }
+
+    void reset(double sampleRate)
+    {
+        sampleRate_ = sampleRate;
+        framesPerBlock_ = std::max(1, static_cast<int>(std::lround(sampleRate * BLOCK_SECONDS)));
+
+        setKWeighting(sampleRate);
+        buildTruePeakFilter();
+
+        for (auto& channel : channels_)
+            channel = ChannelState{};
+
+        blockEnergies_.clear();
+        blockRms_.clear();
+        recentBlocks_.fill(0.0);
+        recentBlockCount_ = 0;
+        framesInBlock_ = 0;
+        weightedSum_ = 0.0;
+        plainSum_ = 0.0;
+        truePeak_ = 0.0f;
+    }
+
+    void process(const float* left, const float* right, int numFrames)
+    {
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const float input[NUM_CHANNELS] = { left[i], right[i] };
+
+            for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+            {
+                auto& state = channels_[static_cast<size_t>(channel)];
+                const double x = input[channel];
+
+                weightedSum_ += square(kWeight(state, x));
+                plainSum_ += x * x;
+                updateTruePeak(state, input[channel]);
+            }
+
+            if (++framesInBlock_ == framesPerBlock_)
+                finishBlock();
+        }
+    }
+
+    // Gated over everything processed so far
+    double getIntegratedLufs() const
+    {
+        const double absoluteGate = lufsToEnergy(ABSOLUTE_GATE_LUFS);
+        const double ungatedMean = meanEnergyAbove(absoluteGate);
+
+        if (ungatedMean <= 0.0)
+            return ABSOLUTE_GATE_LUFS;
+
+        const double relativeGate = ungatedMean * std::pow(10.0, RELATIVE_GATE_LU / 10.0);
+        const double gatedMean = meanEnergyAbove(std::max(absoluteGate, relativeGate));
+
+        return gatedMean > 0.0 ? energyToLufs(gatedMean) : ABSOLUTE_GATE_LUFS;
+    }
+
+    double getTruePeakDb() const
+    {
+        return truePeak_ > 0.0f ? 20.0 * std::log10(static_cast<double>(truePeak_)) : -100.0;
+    }
+
+    const std::vector<float>& getBlockRms() const { return blockRms_; }
+
+    LoudnessResult getResult() const
+    {
+        LoudnessResult result;
+        result.integratedLufs = getIntegratedLufs();
+        result.truePeakDb = getTruePeakDb();
+        result.blockRms = blockRms_;
+        result.blocksPerSecond = sampleRate_ / framesPerBlock_;
+        result.isValid = !blockRms_.empty();
+        return result;
+    }
+
+private:
+    static constexpr int NUM_CHANNELS = 2;
+
+    // 4x polyphase interpolator for true peak: 12 taps per phase
+    static constexpr int OVERSAMPLING = 4;
+    static constexpr int TAPS_PER_PHASE = 12;
+
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    struct ChannelState
+    {
+        // Direct form I history: input, shelf output, high-pass output
+        double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0, z1 = 0.0, z2 = 0.0;
+
+        // Recent input, stored twice so a window of TAPS_PER_PHASE is always contiguous
+        std::array<float, TAPS_PER_PHASE * 2> history{};
+        int historyPosition = 0;
+    };
+
+    static double square(double x) { return x * x; }
+
+    static double lufsToEnergy(double lufs) { return std::pow(10.0, (lufs + 0.691) / 10.0); }
+    static double energyToLufs(double energy) { return -0.691 + 10.0 * std::log10(energy); }
+
+    // ITU-R BS.1770 pre-filter and RLB high-pass, derived for any sample rate
+    void setKWeighting(double sampleRate)
+    {
+        const double pi = 3.14159265358979323846;
+
+        {
+            const double f0 = 1681.974450955533;
+            const double gainDb = 3.999843853973347;
+            const double q = 0.7071752369554196;
+
+            const double k = std::tan(pi * f0 / sampleRate);
+            const double vh = std::pow(10.0, gainDb / 20.0);
+            const double vb = std::pow(vh, 0.4996667741545416);
+            const double a0 = 1.0 + k / q + k * k;
+
+            shelf_.b0 = (vh + vb * k / q + k * k) / a0;
+            shelf_.b1 = 2.0 * (k * k - vh) / a0;
+            shelf_.b2 = (vh - vb * k / q + k * k) / a0;
+            shelf_.a1 = 2.0 * (k * k - 1.0) / a0;
+            shelf_.a2 = (1.0 - k / q + k * k) / a0;
+        }
+
+        {
+            const double f0 = 38.13547087602444;
+            const double q = 0.5003270373238773;
+
+            const double k = std::tan(pi * f0 / sampleRate);
+            const double a0 = 1.0 + k / q + k * k;
+
+            highPass_.b0 = 1.0;
+            highPass_.b1 = -2.0;
+            highPass_.b2 = 1.0;
+            highPass_.a1 = 2.0 * (k * k - 1.0) / a0;
+            highPass_.a2 = (1.0 - k / q + k * k) / a0;
+        }
+    }
+
+    double kWeight(ChannelState& state, double x) const
+    {
+        const double y = shelf_.b0 * x + shelf_.b1 * state.x1 + shelf_.b2 * state.x2
+                       - shelf_.a1 * state.y1 - shelf_.a2 * state.y2;
+
+        const double z = highPass_.b0 * y + highPass_.b1 * state.y1 + highPass_.b2 * state.y2
+                       - highPass_.a1 * state.z1 - highPass_.a2 * state.z2;
+
+        state.x2 = state.x1;
+        state.x1 = x;
+        state.y2 = state.y1;
+        state.y1 = y;
+        state.z2 = state.z1;
+        state.z1 = z;
+
+        return z;
+    }
+
+    // Hann-windowed sinc, one row per phase, each row normalised to unity gain
+    void buildTruePeakFilter()
+    {
+        const double pi = 3.14159265358979323846;
+        constexpr int numTaps = OVERSAMPLING * TAPS_PER_PHASE;
+        constexpr double centre = numTaps / 2;
+
+        for (int phase = 0; phase < OVERSAMPLING; ++phase)
+        {
+            double sum = 0.0;
+
+            for (int tap = 0; tap < TAPS_PER_PHASE; ++tap)
+            {
+                const int k = tap * OVERSAMPLING + phase;
+                const double t = (k - centre) / OVERSAMPLING;
+                const double sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+                const double window = 0.5 - 0.5 * std::cos(2.0 * pi * k / numTaps);
+
+                truePeakTaps_[static_cast<size_t>(phase)][static_cast<size_t>(tap)] = static_cast<float>(sinc * window);
+                sum += sinc * window;
+            }
+
+            for (auto& tap : truePeakTaps_[static_cast<size_t>(phase)])
+                tap = static_cast<float>(tap / sum);
+        }
+    }
+
+    void updateTruePeak(ChannelState& state, float x)
+    {
+        state.historyPosition = (state.historyPosition + 1) % TAPS_PER_PHASE;
+        state.history[static_cast<size_t>(state.historyPosition)] = x;
+        state.history[static_cast<size_t>(state.historyPosition + TAPS_PER_PHASE)] = x;
+
+        // Oldest sample first, newest last
+        const float* window = state.history.data() + state.historyPosition + 1;
+
+        for (const auto& taps : truePeakTaps_)
+        {
+            float y = 0.0f;
+            for (int tap = 0; tap < TAPS_PER_PHASE; ++tap)
+                y += window[tap] * taps[static_cast<size_t>(TAPS_PER_PHASE - 1 - tap)];
+
+            truePeak_ = std::max(truePeak_, std::abs(y));
+        }
+    }
+
+    void finishBlock()
+    {
+        // Channel weights are 1 for left and right, so the energies just add
+        recentBlocks_[static_cast<size_t>(recentBlockCount_ % BLOCKS_PER_WINDOW)] = weightedSum_ / framesPerBlock_;
+        ++recentBlockCount_;
+
+        if (recentBlockCount_ >= BLOCKS_PER_WINDOW)
+        {
+            double windowEnergy = 0.0;
+            for (double energy : recentBlocks_)
+                windowEnergy += energy;
+
+            blockEnergies_.push_back(windowEnergy / BLOCKS_PER_WINDOW);
+        }
+
+        blockRms_.push_back(static_cast<float>(std::sqrt(plainSum_ / (framesPerBlock_ * NUM_CHANNELS))));
+
+        weightedSum_ = 0.0;
+        plainSum_ = 0.0;
+        framesInBlock_ = 0;
+    }
+
+    double meanEnergyAbove(double gate) const
+    {
+        double sum = 0.0;
+        int count = 0;
+
+        for (double energy : blockEnergies_)
+        {
+            if (energy > gate)
+            {
+                sum += energy;
+                ++count;
+            }
+        }
+
+        return count > 0 ? sum / count : 0.0;
+    }
+
+    double sampleRate_ = 48000.0;
+    int framesPerBlock_ = 4800;
+
+    Biquad shelf_;
+    Biquad highPass_;
+    std::array<std::array<float, TAPS_PER_PHASE>, OVERSAMPLING> truePeakTaps_{};
+    std::array<ChannelState, NUM_CHANNELS> channels_{};
+
+    std::vector<double> blockEnergies_;   // Mean-square energy of each 400ms gating window
+    std::vector<float> blockRms_;
+    std::array<double, BLOCKS_PER_WINDOW> recentBlocks_{};
+    int recentBlockCount_ = 0;
+    int framesInBlock_ = 0;
+    double weightedSum_ = 0.0;
+    double plainSum_ = 0.0;
+    float truePeak_ = 0.0f;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 
 template<typename FloatType>
@@ -52,13 +53,21 @@ public:
             return currentValue_;
         }
 
-        currentValue_ += (targetValue_ - currentValue_) * coefficient_;
-        
-        // Snap to target if very close
-        if (std::abs(currentValue_ - targetValue_) < static_cast<FloatType>(1e-6))
+        const FloatType nextValue = currentValue_ + (targetValue_ - currentValue_) * coefficient_;
+
+        // Snap to target once very close (relative, so large values such as
+        // frequencies get there too), or once a step no longer moves the value:
+        // short of the target, steps fall below float resolution and would
+        // otherwise leave it smoothing forever
+        const FloatType tolerance = static_cast<FloatType>(1e-6) * std::max(static_cast<FloatType>(1), std::abs(targetValue_));
+        if (nextValue == currentValue_ || std::abs(nextValue - targetValue_) < tolerance)
         {
             currentValue_ = targetValue_;
         }
+        else
+        {
+            currentValue_ = nextValue;
+        }
         
         return currentValue_;
     }
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+#include "StereoBiquadCascade.h"
+
+enum class EQBandType
+{
+    LowShelf,
+    Peak,
+    HighShelf,
+    HighPass,
+    LowPass,
+    Notch
+};
+
+// An equaliser of NumBands biquads, each a shelf, peak, high or low pass or
+// notch, run as one StereoBiquadCascade. Band settings are held as one array
+// per parameter rather than a struct per band, and smoothed as a single bank,
+// so the per-block work is a few flat loops over the bands. Only bands whose
+// settings moved get new coefficients, computed together in one batch; bands
+// that are off, or shelves and peaks at rest at 0dB, drop out of the cascade.
+// A static EQ therefore costs its active filters and nothing more, however
+// many bands it has. The band setters may be called from any thread; the
+// rest belongs to the audio thread.
+template <int NumBands>
+class ParametricEQ
+{
+public:
+    static_assert(NumBands > 0 && NumBands <= StereoBiquadCascade::MAX_STAGES, "Too many bands for one cascade");
+
+    static constexpr float MIN_FREQUENCY = 20.0f;
+    static constexpr float MAX_FREQUENCY_RATIO = 0.4f;   // Of the sample rate
+    static constexpr float MIN_GAIN_DB = -24.0f;
+    static constexpr float MAX_GAIN_DB = 24.0f;
+    static constexpr float MIN_Q = 0.1f;
+    static constexpr float MAX_Q = 10.0f;
+    static constexpr int SMOOTHING_STEP = 64;            // Frames between coefficient updates while smoothing
+
+    ParametricEQ()
+    {
+        for (int band = 0; band < NumBands; ++band)
+        {
+            types_[index(band)].store(EQBandType::Peak);
+            appliedTypes_[index(band)] = EQBandType::Peak;
+            setBandFrequency(band, 1000.0f);
+            setBandGain(band, 0.0f);
+            setBandQ(band, 0.707f);
+            setBandEnabled(band, true);
+        }
+
+        pullTargets();
+        current_ = target_;
+        cascade_.setNumStages(NumBands);
+    }
+
+    void setBandType(int band, EQBandType type) { types_[index(band)].store(type); }
+    void setBandFrequency(int band, float frequency) { frequencies_[index(band)].store(std::max(MIN_FREQUENCY, frequency)); }
+    void setBandGain(int band, float gainDb) { gains_[index(band)].store(std::clamp(gainDb, MIN_GAIN_DB, MAX_GAIN_DB)); }
+    void setBandQ(int band, float q) { qs_[index(band)].store(std::clamp(q, MIN_Q, MAX_Q)); }
+    void setBandEnabled(int band, bool enabled) { enabled_[index(band)].store(enabled); }
+
+    EQBandType getBandType(int band) const { return types_[index(band)].load(); }
+    float getBandFrequency(int band) const { return frequencies_[index(band)].load(); }
+    float getBandGain(int band) const { return gains_[index(band)].load(); }
+    float getBandQ(int band) const { return qs_[index(band)].load(); }
+    bool isBandEnabled(int band) const { return enabled_[index(band)].load(); }
+
+    // Where the smoothed settings currently are (audio thread)
+    float getCurrentFrequency(int band) const { return current_[slot(Frequency, band)]; }
+    float getCurrentGain(int band) const { return current_[slot(Gain, band)]; }
+    float getCurrentQ(int band) const { return current_[slot(Q, band)]; }
+
+    // Starts every band at its settings rather than part way to them
+    void prepare(double sampleRate, float smoothingTimeMs)
+    {
+        sampleRate_ = sampleRate;
+        smoothingCoefficient_ = (sampleRate > 0.0 && smoothingTimeMs > 0.0f)
+            ? static_cast<float>(1.0 - std::exp(-1.0 / (smoothingTimeMs * 0.001 * sampleRate)))
+            : 1.0f;
+
+        pullTargets();
+        current_ = target_;
+
+        for (int band = 0; band < NumBands; ++band)
+            appliedTypes_[index(band)] = types_[index(band)].load();
+
+        std::array<bool, NumBands> dirty;
+        dirty.fill(true);
+        updateBands(dirty);
+        cascade_.reset();
+    }
+
+    void reset() { cascade_.reset(); }
+
+    // In place. Without a right channel only the left is filtered.
+    void process(float* left, float* right, int numFrames)
+    {
+        if (sampleRate_ <= 0.0)
+            return;
+
+        for (int start = 0; start < numFrames;)
+        {
+            const int length = advance(numFrames - start);
+            cascade_.process(left + start, right != nullptr ? right + start : nullptr, length);
+            start += length;
+        }
+    }
+
+private:
+    enum Smoothed
+    {
+        Frequency,
+        Gain,
+        Q,
+        NUM_SMOOTHED
+    };
+
+    static constexpr size_t index(int band) { return static_cast<size_t>(band); }
+    static constexpr size_t slot(Smoothed parameter, int band) { return static_cast<size_t>(parameter * NumBands + band); }
+
+    static bool isFlatAtZeroGain(EQBandType type)
+    {
+        return type == EQBandType::LowShelf || type == EQBandType::Peak || type == EQBandType::HighShelf;
+    }
+
+    void pullTargets()
+    {
+        for (int band = 0; band < NumBands; ++band)
+        {
+            target_[slot(Frequency, band)] = frequencies_[index(band)].load(std::memory_order_relaxed);
+            target_[slot(Gain, band)] = gains_[index(band)].load(std::memory_order_relaxed);
+            target_[slot(Q, band)] = qs_[index(band)].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Moves the smoother bank on by up to maxFrames and brings the cascade
+    // up to date; returns how many frames those coefficients should cover
+    int advance(int maxFrames)
+    {
+        pullTargets();
+
+        std::array<bool, NUM_SMOOTHED * NumBands> moved;
+        bool anyMoved = false;
+        for (size_t i = 0; i < moved.size(); ++i)
+        {
+            moved[i] = current_[i] != target_[i];
+            anyMoved = anyMoved || moved[i];
+        }
+
+        // While settings move, coefficients follow every SMOOTHING_STEP frames
+        const int length = anyMoved ? std::min(maxFrames, SMOOTHING_STEP) : maxFrames;
+
+        if (anyMoved)
+        {
+            // One-pole smoothing over the whole step at once
+            const float step = 1.0f - std::pow(1.0f - smoothingCoefficient_, static_cast<float>(length));
+
+            for (size_t i = 0; i < current_.size(); ++i)
+            {
+                const float distance = target_[i] - current_[i];
+                const bool settled = std::abs(distance) <= SNAP_TOLERANCE * std::max(1.0f, std::abs(target_[i]));
+                current_[i] = settled ? target_[i] : current_[i] + distance * step;
+            }
+        }
+
+        std::array<bool, NumBands> dirty;
+        for (int band = 0; band < NumBands; ++band)
+        {
+            const EQBandType type = types_[index(band)].load(std::memory_order_relaxed);
+            const bool typeChanged = type != appliedTypes_[index(band)];
+            dirty[index(band)] = moved[slot(Frequency, band)] || moved[slot(Gain, band)] || moved[slot(Q, band)] || typeChanged;
+            appliedTypes_[index(band)] = type;
+
+            // The old shape's state is meaningless to the new one (a shelf's can
+            // blow up a high-pass), so the stage restarts from silence, as on re-enabling
+            if (typeChanged)
+                cascade_.resetStage(band);
+        }
+
+        updateBands(dirty);
+        return length;
+    }
+
+    // Decides which bands are in the cascade, then recomputes the
+    // coefficients of those that need it in one batch
+    void updateBands(const std::array<bool, NumBands>& dirty)
+    {
+        std::array<int, NumBands> bands;
+        int numBands = 0;
+
+        for (int band = 0; band < NumBands; ++band)
+        {
+            const bool atRest = current_[slot(Gain, band)] == target_[slot(Gain, band)];
+            const bool flat = isFlatAtZeroGain(appliedTypes_[index(band)]) && atRest && current_[slot(Gain, band)] == 0.0f;
+            const bool active = enabled_[index(band)].load(std::memory_order_relaxed) && !flat;
+
+            // Bands out of the cascade catch up once they are back in it
+            stale_[index(band)] = stale_[index(band)] || dirty[index(band)];
+            if (active && stale_[index(band)])
+            {
+                bands[static_cast<size_t>(numBands++)] = band;
+                stale_[index(band)] = false;
+            }
+
+            if (active != cascade_.isStageEnabled(band))
+                cascade_.setStageEnabled(band, active);
+        }
+
+        if (numBands == 0)
+            return;
+
+        // The trigonometry for every changed band first, in packed arrays...
+        const float twoPiOverRate = static_cast<float>(2.0 * 3.14159265358979323846 / sampleRate_);
+        const float maxFrequency = MAX_FREQUENCY_RATIO * static_cast<float>(sampleRate_);
+        std::array<float, NumBands> cosW, alpha, amplitude;
+
+        for (size_t i = 0; i < static_cast<size_t>(numBands); ++i)
+        {
+            const int band = bands[i];
+            const float w = twoPiOverRate * std::clamp(current_[slot(Frequency, band)], MIN_FREQUENCY, maxFrequency);
+            cosW[i] = std::cos(w);
+            alpha[i] = std::sin(w) / (2.0f * current_[slot(Q, band)]);
+            amplitude[i] = std::pow(10.0f, current_[slot(Gain, band)] / 40.0f);
+        }
+
+        // ...then each band's shape from the shared terms
+        for (size_t i = 0; i < static_cast<size_t>(numBands); ++i)
+            cascade_.setCoefficients(bands[i], makeCoefficients(appliedTypes_[index(bands[i])], cosW[i], alpha[i], amplitude[i]));
+    }
+
+    // RBJ cookbook biquads in b0 b1 b2 a0 a1 a2 order
+    static std::array<float, 6> makeCoefficients(EQBandType type, float cosW, float alpha, float a)
+    {
+        switch (type)
+        {
+            case EQBandType::LowShelf:
+            case EQBandType::HighShelf:
+            {
+                const float sign = type == EQBandType::LowShelf ? 1.0f : -1.0f;
+                const float root = 2.0f * std::sqrt(a) * alpha;
+                const float aPlus = a + 1.0f, aMinus = a - 1.0f;
+
+                return { a * (aPlus - sign * aMinus * cosW + root),
+                         sign * 2.0f * a * (aMinus - sign * aPlus * cosW),
+                         a * (aPlus - sign * aMinus * cosW - root),
+                         aPlus + sign * aMinus * cosW + root,
+                         -sign * 2.0f * (aMinus + sign * aPlus * cosW),
+                         aPlus + sign * aMinus * cosW - root };
+            }
+
+            case EQBandType::Peak:
+                return { 1.0f + alpha * a, -2.0f * cosW, 1.0f - alpha * a,
+                         1.0f + alpha / a, -2.0f * cosW, 1.0f - alpha / a };
+
+            case EQBandType::HighPass:
+                return { (1.0f + cosW) * 0.5f, -(1.0f + cosW), (1.0f + cosW) * 0.5f,
+                         1.0f + alpha, -2.0f * cosW, 1.0f - alpha };
+
+            case EQBandType::LowPass:
+                return { (1.0f - cosW) * 0.5f, 1.0f - cosW, (1.0f - cosW) * 0.5f,
+                         1.0f + alpha, -2.0f * cosW, 1.0f - alpha };
+
+            case EQBandType::Notch:
+            default:
+                return { 1.0f, -2.0f * cosW, 1.0f,
+                         1.0f + alpha, -2.0f * cosW, 1.0f - alpha };
+        }
+    }
+
+    static constexpr float SNAP_TOLERANCE = 1.0e-4f;   // Relative; a smoother this close jumps to its target
+
+    // Band settings, one array per parameter
+    std::array<std::atomic<EQBandType>, NumBands> types_;
+    std::array<std::atomic<float>, NumBands> frequencies_;
+    std::array<std::atomic<float>, NumBands> gains_;
+    std::array<std::atomic<float>, NumBands> qs_;
+    std::array<std::atomic<bool>, NumBands> enabled_;
+
+    // Smoother bank: frequencies, then gains, then Qs
+    std::array<float, NUM_SMOOTHED * NumBands> current_ {};
+    std::array<float, NUM_SMOOTHED * NumBands> target_ {};
+    float smoothingCoefficient_ = 1.0f;
+
+    std::array<EQBandType, NumBands> appliedTypes_ {};
+    std::array<bool, NumBands> stale_ {};
+    double sampleRate_ = 0.0;
+
+    StereoBiquadCascade cascade_;
+};
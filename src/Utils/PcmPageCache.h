@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size LRU cache of decoded stereo PCM, split into equal pages of frames.
+// Not thread-safe apart from the hit/miss counters: lookups and stores must
+// come from one thread (the decode thread).
+class PcmPageCache
+{
+public:
+    static constexpr int NUM_CHANNELS = 2;
+
+    explicit PcmPageCache(int pageFrames = 65536, size_t memoryBudgetBytes = 64 * 1024 * 1024)
+        : pageFrames_(pageFrames),
+          maxPages_(std::max<size_t>(1, memoryBudgetBytes / (static_cast<size_t>(pageFrames) * NUM_CHANNELS * sizeof(float))))
+    {
+        // Pages are never erased, so pointers into the vector stay valid
+        pages_.reserve(maxPages_);
+    }
+
+    int getPageFrames() const { return pageFrames_; }
+    size_t getMaxPages() const { return maxPages_; }
+    size_t getNumPages() const { return pages_.size(); }
+
+    int64_t getPageIndex(int64_t frame) const { return frame / pageFrames_; }
+    int64_t getPageStart(int64_t pageIndex) const { return pageIndex * pageFrames_; }
+
+    // Copies up to numFrames starting at frame, without crossing into the next
+    // page. Returns 0 on a miss. Every call counts as one hit or one miss.
+    int read(int64_t frame, float* const* channelOutputs, int numFrames)
+    {
+        Page* page = findPage(getPageIndex(frame));
+
+        if (page == nullptr)
+        {
+            misses_.fetch_add(1);
+            return 0;
+        }
+
+        const int offset = static_cast<int>(frame - getPageStart(page->index));
+        const int framesToCopy = std::min(numFrames, page->numFrames - offset);
+
+        if (framesToCopy <= 0)
+        {
+            // Short last page of the file: the frame lies past its end
+            misses_.fetch_add(1);
+            return 0;
+        }
+
+        hits_.fetch_add(1);
+        page->lastUsed = ++useCounter_;
+
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        {
+            const float* source = page->samples[static_cast<size_t>(channel)].data() + offset;
+            std::copy(source, source + framesToCopy, channelOutputs[channel]);
+        }
+
+        return framesToCopy;
+    }
+
+    // Returns writable storage for a page, evicting the least recently used
+    // one when the budget is full. Call commitPage() once it has been filled.
+    float* const* beginPage(int64_t pageIndex)
+    {
+        Page* page = findPage(pageIndex);
+
+        // Reuse a cleared page before growing or evicting
+        if (page == nullptr)
+            page = findPage(-1);
+
+        if (page == nullptr)
+        {
+            if (pages_.size() < maxPages_)
+            {
+                pages_.emplace_back();
+                page = &pages_.back();
+
+                for (auto& channelSamples : page->samples)
+                    channelSamples.resize(static_cast<size_t>(pageFrames_));
+            }
+            else
+            {
+                page = &*std::min_element(pages_.begin(), pages_.end(),
+                                          [](const Page& a, const Page& b) { return a.lastUsed < b.lastUsed; });
+                evictions_.fetch_add(1);
+            }
+        }
+
+        // Invisible to read() until committed
+        page->index = -1;
+        page->numFrames = 0;
+        fillingPage_ = page;
+        fillingIndex_ = pageIndex;
+
+        writePointers_ = { page->samples[0].data(), page->samples[1].data() };
+        return writePointers_.data();
+    }
+
+    void commitPage(int numFrames)
+    {
+        if (fillingPage_ == nullptr)
+            return;
+
+        if (numFrames > 0)
+        {
+            fillingPage_->index = fillingIndex_;
+            fillingPage_->numFrames = std::min(numFrames, pageFrames_);
+            fillingPage_->lastUsed = ++useCounter_;
+        }
+
+        fillingPage_ = nullptr;
+    }
+
+    void clear()
+    {
+        for (auto& page : pages_)
+        {
+            page.index = -1;
+            page.numFrames = 0;
+        }
+
+        fillingPage_ = nullptr;
+    }
+
+    // Tuning counters
+    uint64_t getHits() const { return hits_.load(); }
+    uint64_t getMisses() const { return misses_.load(); }
+    uint64_t getEvictions() const { return evictions_.load(); }
+
+    void resetCounters()
+    {
+        hits_.store(0);
+        misses_.store(0);
+        evictions_.store(0);
+    }
+
+private:
+    struct Page
+    {
+        int64_t index = -1;
+        int numFrames = 0;
+        uint64_t lastUsed = 0;
+        std::array<std::vector<float>, NUM_CHANNELS> samples;
+    };
+
+    Page* findPage(int64_t pageIndex)
+    {
+        for (auto& page : pages_)
+        {
+            if (page.index == pageIndex)
+                return &page;
+        }
+
+        return nullptr;
+    }
+
+    const int pageFrames_;
+    const size_t maxPages_;
+
+    std::vector<Page> pages_;
+
+    uint64_t useCounter_ = 0;
+    Page* fillingPage_ = nullptr;
+    int64_t fillingIndex_ = -1;
+    std::array<float*, NUM_CHANNELS> writePointers_{};
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define STEREO_BIQUAD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #include <arm_neon.h>
+ #define STEREO_BIQUAD_NEON 1
+#endif
+
+// The left and right samples of one frame, side by side in a vector register
+// where the target has one (SSE2 on x86, NEON on ARM), else in two floats
+namespace StereoLanes
+{
+#if defined(STEREO_BIQUAD_SSE2)
+    using Pair = __m128;   // Lanes 0 and 1; the upper two ride along unused
+
+    inline Pair make(float left, float right) { return _mm_unpacklo_ps(_mm_set_ss(left), _mm_set_ss(right)); }
+    inline Pair broadcast(float value) { return _mm_set1_ps(value); }
+    inline Pair add(Pair a, Pair b) { return _mm_add_ps(a, b); }
+    inline Pair sub(Pair a, Pair b) { return _mm_sub_ps(a, b); }
+    inline Pair mul(Pair a, Pair b) { return _mm_mul_ps(a, b); }
+    inline float left(Pair p) { return _mm_cvtss_f32(p); }
+    inline float right(Pair p) { return _mm_cvtss_f32(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))); }
+#elif defined(STEREO_BIQUAD_NEON)
+    using Pair = float32x2_t;
+
+    inline Pair make(float left, float right) { return vset_lane_f32(right, vdup_n_f32(left), 1); }
+    inline Pair broadcast(float value) { return vdup_n_f32(value); }
+    inline Pair add(Pair a, Pair b) { return vadd_f32(a, b); }
+    inline Pair sub(Pair a, Pair b) { return vsub_f32(a, b); }
+    inline Pair mul(Pair a, Pair b) { return vmul_f32(a, b); }
+    inline float left(Pair p) { return vget_lane_f32(p, 0); }
+    inline float right(Pair p) { return vget_lane_f32(p, 1); }
+#else
+    struct Pair
+    {
+        float l, r;
+    };
+
+    inline Pair make(float left, float right) { return { left, right }; }
+    inline Pair broadcast(float value) { return { value, value }; }
+    inline Pair add(Pair a, Pair b) { return { a.l + b.l, a.r + b.r }; }
+    inline Pair sub(Pair a, Pair b) { return { a.l - b.l, a.r - b.r }; }
+    inline Pair mul(Pair a, Pair b) { return { a.l * b.l, a.r * b.r }; }
+    inline float left(Pair p) { return p.l; }
+    inline float right(Pair p) { return p.r; }
+#endif
+}
+
+// A chain of biquads in transposed direct form II, run over a stereo pair
+// with both channels in SIMD lanes, so each stage costs one set of vector
+// operations per frame rather than two scalar ones. The lane type is picked
+// from the target's instruction set at compile time (SSE2 is part of x86-64
+// and NEON of ARM64, so no runtime check is needed); every variant does the
+// same operations in the same order. Coefficients are taken in
+// juce::dsp::IIR::ArrayCoefficients order (b0 b1 b2 a0 a1 a2). Run it with
+// denormals flushed to zero (juce::ScopedNoDenormals); the state is also
+// flushed between blocks, so a decaying tail never lingers as denormals.
+class StereoBiquadCascade
+{
+public:
+    static constexpr int MAX_STAGES = 16;
+
+    StereoBiquadCascade() { reset(); }
+
+    void setNumStages(int numStages)
+    {
+        numStages_ = std::clamp(numStages, 0, MAX_STAGES);
+    }
+
+    int getNumStages() const { return numStages_; }
+
+    void setCoefficients(int stage, const std::array<float, 6>& coefficients)
+    {
+        auto& target = stages_[static_cast<size_t>(stage)];
+        const float a0Inverse = 1.0f / coefficients[3];
+
+        target.b0 = coefficients[0] * a0Inverse;
+        target.b1 = coefficients[1] * a0Inverse;
+        target.b2 = coefficients[2] * a0Inverse;
+        target.a1 = coefficients[4] * a0Inverse;
+        target.a2 = coefficients[5] * a0Inverse;
+    }
+
+    // Disabled stages are skipped; one enabled again starts from silence
+    void setStageEnabled(int stage, bool enabled)
+    {
+        auto& target = stages_[static_cast<size_t>(stage)];
+
+        if (enabled && !target.enabled)
+            target.s1 = target.s2 = { 0.0f, 0.0f };
+
+        target.enabled = enabled;
+    }
+
+    bool isStageEnabled(int stage) const { return stages_[static_cast<size_t>(stage)].enabled; }
+
+    void reset()
+    {
+        for (auto& stage : stages_)
+            stage.s1 = stage.s2 = { 0.0f, 0.0f };
+    }
+
+    void resetStage(int stage)
+    {
+        auto& target = stages_[static_cast<size_t>(stage)];
+        target.s1 = target.s2 = { 0.0f, 0.0f };
+    }
+
+    // In place. Without a right channel only the left is filtered.
+    void process(float* left, float* right, int numFrames)
+    {
+        using namespace StereoLanes;
+
+        // Registers for the stages that are on, loaded once per block
+        Pair b0[MAX_STAGES], b1[MAX_STAGES], b2[MAX_STAGES], a1[MAX_STAGES], a2[MAX_STAGES];
+        Pair s1[MAX_STAGES], s2[MAX_STAGES];
+        int active[MAX_STAGES];
+        int numActive = 0;
+
+        for (int index = 0; index < numStages_; ++index)
+        {
+            const auto& stage = stages_[static_cast<size_t>(index)];
+            if (!stage.enabled)
+                continue;
+
+            const auto slot = static_cast<size_t>(numActive);
+            b0[slot] = broadcast(stage.b0);
+            b1[slot] = broadcast(stage.b1);
+            b2[slot] = broadcast(stage.b2);
+            a1[slot] = broadcast(stage.a1);
+            a2[slot] = broadcast(stage.a2);
+            s1[slot] = make(stage.s1[0], stage.s1[1]);
+            s2[slot] = make(stage.s2[0], stage.s2[1]);
+            active[slot] = index;
+            ++numActive;
+        }
+
+        if (numActive == 0 || numFrames <= 0)
+            return;
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            Pair x = make(left[i], right != nullptr ? right[i] : 0.0f);
+
+            for (size_t slot = 0; slot < static_cast<size_t>(numActive); ++slot)
+            {
+                const Pair y = add(mul(b0[slot], x), s1[slot]);
+                s1[slot] = add(sub(mul(b1[slot], x), mul(a1[slot], y)), s2[slot]);
+                s2[slot] = sub(mul(b2[slot], x), mul(a2[slot], y));
+                x = y;
+            }
+
+            left[i] = StereoLanes::left(x);
+            if (right != nullptr)
+                right[i] = StereoLanes::right(x);
+        }
+
+        for (size_t slot = 0; slot < static_cast<size_t>(numActive); ++slot)
+        {
+            auto& stage = stages_[static_cast<size_t>(active[slot])];
+            stage.s1 = { flushDenormal(StereoLanes::left(s1[slot])), flushDenormal(StereoLanes::right(s1[slot])) };
+            stage.s2 = { flushDenormal(StereoLanes::left(s2[slot])), flushDenormal(StereoLanes::right(s2[slot])) };
+        }
+    }
+
+private:
+    struct Stage
+    {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+        std::array<float, 2> s1 {}, s2 {};
+        bool enabled = true;
+    };
+
+    static float flushDenormal(float value)
+    {
+        return std::abs(value) < 1.0e-15f ? 0.0f : value;
+    }
+
+    std::array<Stage, MAX_STAGES> stages_;
+    int numStages_ = 0;
+};
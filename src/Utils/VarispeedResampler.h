@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "ParameterSmoother.h"
+
+// Tape-style varispeed: plays its input faster or slower, pitch following
+// speed, with a continuously variable ratio. A windowed-sinc polyphase bank
+// (interpolated between neighbouring phases) does the resampling, so the
+// delay is only half the filter length. Faster speeds switch to banks with
+// a lower cutoff to keep aliasing down. The speed glides through a
+// ParameterSmoother, one step per output sample.
+class VarispeedResampler
+{
+public:
+    static constexpr int MAX_CHANNELS = 2;
+    static constexpr int TAPS = 16;
+    static constexpr int PHASES = 128;
+    static constexpr float MIN_SPEED = 0.25f;
+    static constexpr float MAX_SPEED = 4.0f;
+
+    VarispeedResampler()
+    {
+        buildFilterBanks();
+        speed_.setSmoothingTimeMs(50.0f);
+        speed_.setCurrentAndTargetValue(1.0f);
+    }
+
+    // Sizes the history for the largest block at the highest speed
+    void prepare(double sampleRate, int maxBlockSize)
+    {
+        speed_.setSampleRate(sampleRate);
+
+        const int capacity = TAPS + static_cast<int>(std::ceil(maxBlockSize * MAX_SPEED)) + 2;
+        for (auto& channel : history_)
+            channel.assign(static_cast<size_t>(capacity), 0.0f);
+
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& channel : history_)
+            std::fill(channel.begin(), channel.end(), 0.0f);
+
+        // Zeros before the first real frame, so the first output lands on it
+        historyFrames_ = TAPS / 2 - 1;
+        position_ = 0.0;
+        speed_.skipToTargetValue();
+    }
+
+    void setSpeed(float speed) { speed_.setTargetValue(std::clamp(speed, MIN_SPEED, MAX_SPEED)); }
+    void setSpeedImmediately(float speed) { speed_.setCurrentAndTargetValue(std::clamp(speed, MIN_SPEED, MAX_SPEED)); }
+    float getSpeed() const { return speed_.getCurrentValue(); }
+    bool isUnity() const { return speed_.getCurrentValue() == 1.0f && speed_.getTargetValue() == 1.0f; }
+
+    int getLatency() const { return TAPS / 2; }
+
+    // Input frames to supply for the next numOutputFrames (an upper bound,
+    // since the speed may still be gliding; any extra is kept for next time)
+    int getInputFramesNeeded(int numOutputFrames) const
+    {
+        const double fastest = std::max(speed_.getCurrentValue(), speed_.getTargetValue());
+        const int lastFrame = static_cast<int>(position_ + fastest * numOutputFrames) + TAPS;
+        return std::max(0, lastFrame - historyFrames_);
+    }
+
+    // Appends the input, then writes up to numOutputFrames, fewer if the
+    // input runs short. Returns the number of output frames written.
+    int process(const float* const* input, int numInputFrames, float* const* output, int numOutputFrames, int numChannels)
+    {
+        numChannels = std::min(numChannels, MAX_CHANNELS);
+        numInputFrames = std::min(numInputFrames, static_cast<int>(history_[0].size()) - historyFrames_);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            std::memcpy(history_[static_cast<size_t>(channel)].data() + historyFrames_, input[channel], static_cast<size_t>(numInputFrames) * sizeof(float));
+
+        historyFrames_ += numInputFrames;
+
+        const auto& bank = filterBanks_[static_cast<size_t>(bankForSpeed(std::max(speed_.getCurrentValue(), speed_.getTargetValue())))];
+        alignas(16) std::array<float, TAPS> coefficients;
+
+        int written = 0;
+        for (; written < numOutputFrames; ++written)
+        {
+            const auto index = static_cast<int>(position_);
+            if (index + TAPS > historyFrames_)
+                break;
+
+            // Blend the two nearest phases of the bank
+            const double phase = (position_ - index) * PHASES;
+            const auto phaseIndex = static_cast<int>(phase);
+            const auto blend = static_cast<float>(phase - phaseIndex);
+            const float* lower = bank.data() + phaseIndex * TAPS;
+            const float* upper = lower + TAPS;
+
+            for (int tap = 0; tap < TAPS; ++tap)
+                coefficients[static_cast<size_t>(tap)] = lower[tap] + blend * (upper[tap] - lower[tap]);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                output[channel][written] = dotProduct(coefficients.data(), history_[static_cast<size_t>(channel)].data() + index);
+
+            position_ += speed_.getNextValue();
+        }
+
+        // Drop the frames every later output has moved past
+        const int consumed = std::min(static_cast<int>(position_), historyFrames_);
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float* samples = history_[static_cast<size_t>(channel)].data();
+            std::memmove(samples, samples + consumed, static_cast<size_t>(historyFrames_ - consumed) * sizeof(float));
+        }
+
+        historyFrames_ -= consumed;
+        position_ -= consumed;
+        return written;
+    }
+
+private:
+    // Cutoffs for each bank, as a fraction of the input Nyquist frequency
+    static constexpr int NUM_BANKS = 4;
+    static constexpr std::array<float, NUM_BANKS> BANK_SPEEDS { 1.0f, 1.5f, 2.0f, 3.0f };
+
+    static int bankForSpeed(float speed)
+    {
+        int bank = 0;
+        while (bank + 1 < NUM_BANKS && speed > BANK_SPEEDS[static_cast<size_t>(bank)])
+            ++bank;
+
+        return bank;
+    }
+
+    // Fixed length, four running sums, so the compiler vectorises it fully
+    static float dotProduct(const float* a, const float* b)
+    {
+        float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+
+        for (int i = 0; i < TAPS; i += 4)
+        {
+            sum0 += a[i] * b[i];
+            sum1 += a[i + 1] * b[i + 1];
+            sum2 += a[i + 2] * b[i + 2];
+            sum3 += a[i + 3] * b[i + 3];
+        }
+
+        return (sum0 + sum1) + (sum2 + sum3);
+    }
+
+    // PHASES + 1 rows of Blackman-windowed sinc, so the last phase can blend
+    // with the next sample's first; each row is normalised to unity gain
+    void buildFilterBanks()
+    {
+        const double pi = 3.14159265358979323846;
+
+        for (int bank = 0; bank < NUM_BANKS; ++bank)
+        {
+            const double cutoff = 0.9 / BANK_SPEEDS[static_cast<size_t>(bank)];
+            auto& rows = filterBanks_[static_cast<size_t>(bank)];
+            rows.resize(static_cast<size_t>((PHASES + 1) * TAPS));
+
+            for (int phase = 0; phase <= PHASES; ++phase)
+            {
+                const double fraction = static_cast<double>(phase) / PHASES;
+                double sum = 0.0;
+
+                for (int tap = 0; tap < TAPS; ++tap)
+                {
+                    // Distance from the interpolated point, which sits between taps TAPS/2 - 1 and TAPS/2
+                    const double t = tap - (TAPS / 2 - 1) - fraction;
+                    const double x = pi * cutoff * t;
+                    const double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+                    const double w = (t + TAPS / 2.0) / TAPS;
+                    const double window = 0.42 - 0.5 * std::cos(2.0 * pi * w) + 0.08 * std::cos(4.0 * pi * w);
+
+                    rows[static_cast<size_t>(phase * TAPS + tap)] = static_cast<float>(sinc * window);
+                    sum += sinc * window;
+                }
+
+                for (int tap = 0; tap < TAPS; ++tap)
+                    rows[static_cast<size_t>(phase * TAPS + tap)] = static_cast<float>(rows[static_cast<size_t>(phase * TAPS + tap)] / sum);
+            }
+        }
+    }
+
+    std::array<std::vector<float>, NUM_BANKS> filterBanks_;
+    std::array<std::vector<float>, MAX_CHANNELS> history_;
+    int historyFrames_ = 0;
+    double position_ = 0.0;   // Read position in history_, of the first tap
+    ParameterSmoother<float> speed_;
+};
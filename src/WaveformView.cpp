@@ -18,7 +18,7 @@ void WaveformView::paint(juce::Graphics& g)
     // Background
     g.fillAll(juce::Colours::black);
     
-    if (waveformData.empty() || totalDuration <= 0.0)
+    if ((waveformData.empty() && sourcePeaks.empty()) || totalDuration <= 0.0)
     {
         // No data loaded - show placeholder
         g.setColour(juce::Colours::darkgrey);
@@ -33,6 +33,14 @@ void WaveformView::paint(juce::Graphics& g)
     
     // Draw waveform
     drawWaveform(g, area);
+
+    // Shade the part of the file that is still being loaded
+    if (!sourcePeaks.empty() && availableSeconds < totalDuration)
+    {
+        const int loadedX = juce::jmax(area.getX(), timeToPixel(availableSeconds, area));
+        g.setColour(juce::Colours::darkgrey.withAlpha(0.5f));
+        g.fillRect(area.withLeft(loadedX));
+    }
     
     // Draw beat grid overlay
     drawBeatGrid(g, area);
@@ -144,9 +152,22 @@ void WaveformView::setWaveformData(const std::vector<float>& audioData, double s
     repaint();
 }
 
+void WaveformView::setWaveformPeaks(const std::vector<float>& minMaxPeaks, double peaksPerSecond,
+                                    double loadedSeconds)
+{
+    sourcePeaks = minMaxPeaks;
+    sourcePeaksPerSecond = peaksPerSecond;
+    availableSeconds = loadedSeconds;
+
+    generateDisplayPeaks();
+    repaint();
+}
+
 void WaveformView::clearWaveformData()
 {
     waveformData.clear();
+    sourcePeaks.clear();
+    availableSeconds = 0.0;
     displayPeaks.clear();
     totalDuration = 0.0;
     playbackPosition.store(0.0);
@@ -201,6 +222,14 @@ void WaveformView::setViewStart(double startSeconds)
     repaint();
 }
 
+void WaveformView::setRefreshRate(int hz)
+{
+    // Only restart the timer on a change, so this can be called every poll
+    const int intervalMs = 1000 / juce::jlimit(1, 60, hz);
+    if (intervalMs != getTimerInterval())
+        startTimer(intervalMs);
+}
+
 void WaveformView::timerCallback()
 {
     // Regular repaint for playback position updates
@@ -210,7 +239,7 @@ void WaveformView::timerCallback()
 void WaveformView::generateDisplayPeaks()
 {
     int width = getWidth();
-    if (width <= 0 || waveformData.empty() || totalDuration <= 0.0)
+    if (width <= 0 || (waveformData.empty() && sourcePeaks.empty()) || totalDuration <= 0.0)
     {
         displayPeaks.clear();
         return;
@@ -219,6 +248,38 @@ void WaveformView::generateDisplayPeaks()
     displayPeaks.resize(width * 2); // Min and max for each pixel
     
     double viewDuration = viewEndSeconds - viewStartSeconds;
+
+    if (!sourcePeaks.empty())
+    {
+        // Merge precomputed peaks; pixels past the loaded range stay flat
+        const int numSourcePeaks = static_cast<int>(sourcePeaks.size() / 2);
+
+        for (int x = 0; x < width; ++x)
+        {
+            double timeAtPixel = viewStartSeconds + (x * viewDuration / width);
+            int startPeak = static_cast<int>(timeAtPixel * sourcePeaksPerSecond);
+            int endPeak = juce::jmax(startPeak + 1,
+                                     static_cast<int>((timeAtPixel + viewDuration / width) * sourcePeaksPerSecond));
+
+            startPeak = juce::jmax(startPeak, 0);
+            endPeak = juce::jmin(endPeak, numSourcePeaks);
+
+            float minVal = 0.0f;
+            float maxVal = 0.0f;
+
+            for (int peak = startPeak; peak < endPeak; ++peak)
+            {
+                minVal = juce::jmin(minVal, sourcePeaks[peak * 2]);
+                maxVal = juce::jmax(maxVal, sourcePeaks[peak * 2 + 1]);
+            }
+
+            displayPeaks[x * 2] = minVal;
+            displayPeaks[x * 2 + 1] = maxVal;
+        }
+
+        return;
+    }
+
     double samplesPerPixel = (waveformData.size() / numChannels) * (viewDuration / totalDuration) / width;
     
     for (int x = 0; x < width; ++x)
@@ -21,6 +21,9 @@ public:
     // Data input
     void setWaveformData(const std::vector<float>& audioData, double sampleRate, int channels);
     void clearWaveformData();
+
+    // Progressive input: mono min/max pairs that cover [0, availableSeconds)
+    void setWaveformPeaks(const std::vector<float>& minMaxPeaks, double peaksPerSecond, double availableSeconds);
     
     // Analysis display
     void setAnalysisResults(const AnalysisResult& results);
@@ -36,6 +39,9 @@ public:
     // View control
     void setZoom(double zoomFactor);
     void setViewStart(double startSeconds);
+
+    // Repaints per second while playing (AudioEngine::getUiRefreshHz() under load)
+    void setRefreshRate(int hz);
     
     // Callbacks
     std::function<void(double)> onSeekRequested;
@@ -50,6 +56,11 @@ private:
     double sampleRate = 44100.0;
     int numChannels = 2;
     double totalDuration = 0.0;
+
+    // Precomputed peaks from the progressive loader (used instead of waveformData)
+    std::vector<float> sourcePeaks;
+    double sourcePeaksPerSecond = 0.0;
+    double availableSeconds = 0.0;
     
     // Analysis data (thread-safe)
     mutable std::mutex analysisMutex;
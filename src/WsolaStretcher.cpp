@@ -0,0 +1,358 @@
+#include "WsolaStretcher.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Four independent sums, so the loop vectorises without -ffast-math
+    float dotProduct(const float* a, const float* b, int numSamples)
+    {
+        float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            sum0 += a[i] * b[i];
+            sum1 += a[i + 1] * b[i + 1];
+            sum2 += a[i + 2] * b[i + 2];
+            sum3 += a[i + 3] * b[i + 3];
+        }
+
+        for (; i < numSamples; ++i)
+            sum0 += a[i] * b[i];
+
+        return (sum0 + sum1) + (sum2 + sum3);
+    }
+
+    float similarity(float correlation, double energy)
+    {
+        return static_cast<float>(correlation / std::sqrt(energy + 1.0e-9));
+    }
+}
+
+void WsolaStretcher::PlanarBuffer::allocate(int numChannels, int capacity)
+{
+    for (int channel = 0; channel < MAX_CHANNELS; ++channel)
+        channels[static_cast<size_t>(channel)].assign(channel < numChannels ? static_cast<size_t>(capacity) : 0, 0.0f);
+
+    frames = 0;
+}
+
+void WsolaStretcher::PlanarBuffer::drop(int numFrames)
+{
+    if (numFrames <= 0)
+        return;
+
+    for (auto& channel : channels)
+    {
+        if (!channel.empty())
+            std::memmove(channel.data(), channel.data() + numFrames, static_cast<size_t>(frames - numFrames) * sizeof(float));
+    }
+
+    frames -= numFrames;
+}
+
+void WsolaStretcher::prepare(double sampleRate, int newNumChannels, int maxBlockSize)
+{
+    numChannels = juce::jlimit(1, MAX_CHANNELS, newNumChannels);
+
+    // Even frame, whole number of decimated samples per hop
+    hopSize = juce::jmax(DECIMATION, static_cast<int>(sampleRate * FRAME_SECONDS / 2.0) / DECIMATION * DECIMATION);
+    frameSize = hopSize * 2;
+    searchFrames = static_cast<int>(sampleRate * SEARCH_SECONDS) / DECIMATION * DECIMATION;
+
+    // Periodic Hann at 50% overlap sums to exactly one
+    window.resize(static_cast<size_t>(frameSize));
+    for (int i = 0; i < frameSize; ++i)
+        window[static_cast<size_t>(i)] = static_cast<float>(0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * i / frameSize));
+
+    // Room for a frame, the search either side of it, a hop of drift and a block
+    // of new input; anything beyond that is refused until output is taken
+    const int inputCapacity = 2 * (frameSize + 2 * searchFrames + hopSize + maxBlockSize);
+
+    input.allocate(numChannels, inputCapacity);
+    mono.assign(static_cast<size_t>(inputCapacity), 0.0f);
+    decimated.assign(static_cast<size_t>(inputCapacity / DECIMATION + 1), 0.0f);
+    overlap.allocate(numChannels, frameSize);
+    stretched.allocate(numChannels, 2 * hopSize + 2);
+    output.allocate(numChannels, 8 * maxBlockSize + 2 * hopSize);
+
+    reset();
+}
+
+void WsolaStretcher::reset()
+{
+    input.frames = 0;
+    decimatedFrames = 0;
+    stretched.frames = 0;
+    output.frames = 0;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        std::fill(overlap.channels[static_cast<size_t>(channel)].begin(), overlap.channels[static_cast<size_t>(channel)].end(), 0.0f);
+
+    analysisPosition = 0.0;
+    previousPosition = 0;
+    hasPreviousFrame = false;
+    resamplePosition = 0.0;
+}
+
+int WsolaStretcher::process(const float* const* source, int numFrames)
+{
+    if (frameSize == 0)
+        return 0;
+
+    discardConsumedInput();
+
+    const int framesToTake = juce::jmin(numFrames, input.space());
+    const int start = input.frames;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        std::memcpy(input.channels[static_cast<size_t>(channel)].data() + start, source[channel], static_cast<size_t>(framesToTake) * sizeof(float));
+
+    // Similarity is judged on the mono mix, so stereo costs no more to search
+    const float channelGain = 1.0f / static_cast<float>(numChannels);
+    for (int i = start; i < start + framesToTake; ++i)
+    {
+        float sum = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+            sum += input.channels[static_cast<size_t>(channel)][static_cast<size_t>(i)];
+
+        mono[static_cast<size_t>(i)] = sum * channelGain;
+    }
+
+    input.frames += framesToTake;
+
+    for (; (decimatedFrames + 1) * DECIMATION <= input.frames; ++decimatedFrames)
+    {
+        const float* group = mono.data() + decimatedFrames * DECIMATION;
+        float sum = 0.0f;
+        for (int i = 0; i < DECIMATION; ++i)
+            sum += group[i];
+
+        decimated[static_cast<size_t>(decimatedFrames)] = sum / DECIMATION;
+    }
+
+    // Keep going until input runs short or the output side is full
+    do
+    {
+        resample();
+    }
+    while (synthesiseFrame());
+
+    return framesToTake;
+}
+
+int WsolaStretcher::getSamplesRequired() const
+{
+    // Mirrors the checks in synthesiseFrame()
+    const int nominal = static_cast<int>(analysisPosition);
+    int lastNeeded = nominal + frameSize;
+
+    if (hasPreviousFrame)
+        lastNeeded = juce::jmax(nominal + searchFrames + frameSize, previousPosition + hopSize + frameSize);
+
+    return juce::jmax(0, lastNeeded - input.frames);
+}
+
+int WsolaStretcher::getPreferredStartPad() const
+{
+    // Enough that the stretched pad covers the first window's rising half
+    return static_cast<int>(std::ceil(hopSize / (timeRatio * pitchScale)));
+}
+
+int WsolaStretcher::getStartDelay() const
+{
+    // Stretching out, the padded frame lands a hop in. Squeezing, the first
+    // frame is copied through one to one and the pad ends where it does in
+    // the input; either way the resampler then scales it by the pitch.
+    const int pad = getPreferredStartPad();
+    return static_cast<int>(std::lround(juce::jmax(pad * timeRatio * pitchScale, static_cast<double>(pad)) / pitchScale));
+}
+
+int WsolaStretcher::retrieve(float* const* destination, int numFrames)
+{
+    const int framesToCopy = juce::jmin(numFrames, output.frames);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        std::memcpy(destination[channel], output.channels[static_cast<size_t>(channel)].data(), static_cast<size_t>(framesToCopy) * sizeof(float));
+
+    output.drop(framesToCopy);
+    return framesToCopy;
+}
+
+void WsolaStretcher::discardConsumedInput()
+{
+    // The next frame can start no earlier than its search range, nor than
+    // where the last frame would naturally carry on
+    int firstNeeded = static_cast<int>(analysisPosition) - searchFrames;
+    if (hasPreviousFrame)
+        firstNeeded = juce::jmin(firstNeeded, previousPosition + hopSize);
+
+    // Whole decimated groups only, so the decimated mix stays aligned
+    const int framesToDrop = juce::jlimit(0, input.frames, firstNeeded) / DECIMATION * DECIMATION;
+    if (framesToDrop == 0)
+        return;
+
+    std::memmove(mono.data(), mono.data() + framesToDrop, static_cast<size_t>(input.frames - framesToDrop) * sizeof(float));
+    input.drop(framesToDrop);
+
+    const int groupsToDrop = framesToDrop / DECIMATION;
+    std::memmove(decimated.data(), decimated.data() + groupsToDrop, static_cast<size_t>(decimatedFrames - groupsToDrop) * sizeof(float));
+    decimatedFrames -= groupsToDrop;
+
+    analysisPosition -= framesToDrop;
+    previousPosition -= framesToDrop;
+}
+
+bool WsolaStretcher::synthesiseFrame()
+{
+    if (stretched.space() < hopSize)
+        return false;
+
+    const int nominal = static_cast<int>(analysisPosition);
+    int position = nominal;
+
+    if (hasPreviousFrame)
+    {
+        // Search around the nominal position for the frame that best continues
+        // the one before it, i.e. looks most like the input that followed it
+        const int target = previousPosition + hopSize;
+        const int lowest = juce::jmax(0, nominal - searchFrames);
+        const int highest = nominal + searchFrames;
+
+        if (highest + frameSize > input.frames || target + frameSize > input.frames)
+            return false;
+
+        position = findBestPosition(target, lowest, highest);
+    }
+    else if (nominal + frameSize > input.frames)
+    {
+        return false;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* accumulator = overlap.channels[static_cast<size_t>(channel)].data();
+        const float* frame = input.channels[static_cast<size_t>(channel)].data() + position;
+        float* destination = stretched.channels[static_cast<size_t>(channel)].data() + stretched.frames;
+
+        juce::FloatVectorOperations::addWithMultiply(accumulator, frame, window.data(), frameSize);
+
+        // The first half is complete once this frame is added
+        juce::FloatVectorOperations::copy(destination, accumulator, hopSize);
+        std::memmove(accumulator, accumulator + hopSize, static_cast<size_t>(hopSize) * sizeof(float));
+        juce::FloatVectorOperations::clear(accumulator + hopSize, hopSize);
+    }
+
+    stretched.frames += hopSize;
+    previousPosition = position;
+    hasPreviousFrame = true;
+
+    // Stretching by the pitch scale too leaves room for the resampler to shift it
+    analysisPosition += hopSize / (timeRatio * pitchScale);
+    return true;
+}
+
+int WsolaStretcher::findBestPosition(int target, int lowest, int highest) const
+{
+    // Coarse pass over the decimated mix, every DECIMATION frames
+    const int length = frameSize / DECIMATION;
+    const float* reference = decimated.data() + target / DECIMATION;
+    const int firstCandidate = (lowest + DECIMATION - 1) / DECIMATION;
+    const int lastCandidate = highest / DECIMATION;
+
+    double energy = 0.0;
+    for (int i = 0; i < length; ++i)
+        energy += decimated[static_cast<size_t>(firstCandidate + i)] * decimated[static_cast<size_t>(firstCandidate + i)];
+
+    int bestCoarse = firstCandidate;
+    float bestScore = -1.0e30f;
+
+    for (int candidate = firstCandidate; candidate <= lastCandidate; ++candidate)
+    {
+        const float score = similarity(dotProduct(reference, decimated.data() + candidate, length), energy);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestCoarse = candidate;
+        }
+
+        if (candidate == lastCandidate)
+            break;
+
+        // Slide the energy window along by one
+        const float leaving = decimated[static_cast<size_t>(candidate)];
+        const float entering = decimated[static_cast<size_t>(candidate + length)];
+        energy = juce::jmax(0.0, energy + entering * entering - leaving * leaving);
+    }
+
+    // Fine pass at full rate around the coarse winner
+    const int fineLowest = juce::jmax(lowest, bestCoarse * DECIMATION - (DECIMATION - 1));
+    const int fineHighest = juce::jmin(highest, bestCoarse * DECIMATION + (DECIMATION - 1));
+    const float* fineReference = mono.data() + target;
+
+    int best = bestCoarse * DECIMATION;
+    bestScore = -1.0e30f;
+
+    for (int candidate = fineLowest; candidate <= fineHighest; ++candidate)
+    {
+        const float* frame = mono.data() + candidate;
+        const float score = similarity(dotProduct(fineReference, frame, frameSize), dotProduct(frame, frame, frameSize));
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+void WsolaStretcher::resample()
+{
+    if (pitchScale == 1.0 && resamplePosition == std::floor(resamplePosition))
+    {
+        // Unshifted: a straight copy
+        const int start = static_cast<int>(resamplePosition);
+        const int framesToCopy = juce::jlimit(0, output.space(), stretched.frames - start);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            juce::FloatVectorOperations::copy(output.channels[static_cast<size_t>(channel)].data() + output.frames,
+                                              stretched.channels[static_cast<size_t>(channel)].data() + start,
+                                              framesToCopy);
+        }
+
+        output.frames += framesToCopy;
+        resamplePosition += framesToCopy;
+    }
+    else
+    {
+        // Linear interpolation: cheap, and the WSOLA splices dominate the sound anyway
+        while (output.space() > 0)
+        {
+            const int index = static_cast<int>(resamplePosition);
+            if (index + 1 >= stretched.frames)
+                break;
+
+            const float fraction = static_cast<float>(resamplePosition - index);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                const float* samples = stretched.channels[static_cast<size_t>(channel)].data();
+                output.channels[static_cast<size_t>(channel)][static_cast<size_t>(output.frames)]
+                    = samples[index] + fraction * (samples[index + 1] - samples[index]);
+            }
+
+            ++output.frames;
+            resamplePosition += pitchScale;
+        }
+    }
+
+    const int consumed = juce::jmin(stretched.frames, static_cast<int>(resamplePosition));
+    stretched.drop(consumed);
+    resamplePosition -= consumed;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <vector>
+
+// Low-CPU time stretcher (WSOLA: waveform-similarity overlap-add). Each
+// output hop is a Hann-windowed frame of input taken from near its nominal
+// position, nudged to wherever it best lines up with the audio already
+// written, so there are no FFTs and the cost is a few dot products per hop.
+// Pitch is shifted by stretching by the pitch scale as well and resampling
+// the result. The push/pull interface mirrors RubberBandStretcher; every
+// buffer is allocated in prepare(), so the audio thread never allocates.
+class WsolaStretcher
+{
+public:
+    static constexpr int MAX_CHANNELS = 2;
+
+    static constexpr double FRAME_SECONDS = 0.02;      // Analysis frame; the hop is half of it
+    static constexpr double SEARCH_SECONDS = 0.006;    // How far a frame may move to line up
+    static constexpr int DECIMATION = 4;               // The coarse search runs at a quarter rate
+
+    WsolaStretcher() = default;
+
+    void prepare(double sampleRate, int numChannels, int maxBlockSize);
+    void reset();
+
+    // Same meanings as Rubber Band: ratio is output duration / input duration
+    void setTimeRatio(double ratio) { timeRatio = ratio; }
+    void setPitchScale(double scale) { pitchScale = scale; }
+    double getTimeRatio() const { return timeRatio; }
+    double getPitchScale() const { return pitchScale; }
+
+    // Delay from input to output in frames: a whole frame plus the search lookahead
+    int getLatency() const { return frameSize + searchFrames; }
+
+    // As Rubber Band: feed this many zeros after a reset, then drop the first
+    // getStartDelay() frames out, and the first real input frame comes out
+    // first at full level instead of fading in over a hop
+    int getPreferredStartPad() const;
+    int getStartDelay() const;
+
+    // Returns how many frames were taken (fewer once output is backing up)
+    int process(const float* const* input, int numFrames);
+
+    // Input frames still missing before the next hop can be written
+    int getSamplesRequired() const;
+
+    int available() const { return output.frames; }
+    int retrieve(float* const* destination, int numFrames);
+
+private:
+    // Planar frames at the front of fixed-size storage; consumed frames are
+    // dropped from the front so every frame is contiguous for the dot products
+    struct PlanarBuffer
+    {
+        std::array<std::vector<float>, MAX_CHANNELS> channels;
+        int frames = 0;
+
+        void allocate(int numChannels, int capacity);
+        int space() const { return static_cast<int>(channels[0].size()) - frames; }
+        void drop(int numFrames);
+    };
+
+    int numChannels = 2;
+    int frameSize = 0;
+    int hopSize = 0;
+    int searchFrames = 0;
+
+    double timeRatio = 1.0;
+    double pitchScale = 1.0;
+
+    std::vector<float> window;
+
+    // Input, plus a mono mix (fine search) and a decimated mono mix (coarse search)
+    PlanarBuffer input;
+    std::vector<float> mono;
+    std::vector<float> decimated;
+    int decimatedFrames = 0;
+
+    // Overlap-add accumulator, one frame long
+    PlanarBuffer overlap;
+
+    // Stretched audio waiting to be resampled, and finished output
+    PlanarBuffer stretched;
+    PlanarBuffer output;
+
+    double analysisPosition = 0.0;   // Nominal start of the next frame in the input
+    int previousPosition = 0;        // Where the last frame was actually taken from
+    bool hasPreviousFrame = false;
+    double resamplePosition = 0.0;   // Read position in stretched
+
+    void discardConsumedInput();
+    bool synthesiseFrame();
+    int findBestPosition(int target, int lowest, int highest) const;
+    void resample();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WsolaStretcher)
+};
@@ -0,0 +1,133 @@
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include "AudioDecoder.h"
+#include <algorithm>
+#include <vector>
+
+// Measures AudioDecoder::open() latency over a corpus of real files, comparing
+// the full stream-info probe with fast open, with and without reusing one
+// decoder (and so its codec and resampler) from file to file.
+// Point AUDIO_LOAD_BENCHMARK_CORPUS at a directory of audio files to run it.
+class AudioDecoderLoadBenchmark : public juce::UnitTest
+{
+public:
+    AudioDecoderLoadBenchmark() : juce::UnitTest("AudioDecoder Load Benchmark", "Benchmarks") {}
+
+    void runTest() override
+    {
+        const auto corpusPath = juce::SystemStats::getEnvironmentVariable("AUDIO_LOAD_BENCHMARK_CORPUS", {});
+        const juce::File corpus(corpusPath);
+
+        beginTest("Load latency across the corpus");
+
+        if (corpusPath.isEmpty() || !corpus.isDirectory())
+        {
+            logMessage("AUDIO_LOAD_BENCHMARK_CORPUS is not set, skipping");
+            return;
+        }
+
+        auto files = corpus.findChildFiles(juce::File::findFiles, true, "*.mp3;*.m4a;*.aac;*.ogg;*.opus;*.flac;*.wav;*.aif;*.aiff");
+        files.sort();
+
+        if (files.isEmpty())
+        {
+            logMessage("No audio files in " + corpus.getFullPathName());
+            return;
+        }
+
+        referenceFormats.clear();
+        const auto full = measure(files, false, false);
+        const auto fast = measure(files, true, false);
+        const auto fastReused = measure(files, true, true);
+
+        logMessage(juce::String(files.size()) + " files");
+        logMessage("Full probe:         " + describe(full));
+        logMessage("Fast open:          " + describe(fast));
+        logMessage("Fast open + reuse:  " + describe(fastReused));
+
+        beginTest("Fast open reads the same streams");
+        {
+            expectEquals(fast.opened, full.opened, "Fast open should open every file the full probe opens");
+            expectEquals(fastReused.opened, full.opened, "Reusing a decoder should not lose any files");
+            expect(fastReused.mismatchedFormats == 0, "Fast open should report the same rate and channels");
+        }
+
+        if (median(fastReused.milliseconds) > 0.0)
+        {
+            logMessage("Median speedup: " + juce::String(median(full.milliseconds) / median(fastReused.milliseconds), 2) + "x");
+        }
+    }
+
+private:
+    struct Run
+    {
+        std::vector<double> milliseconds;
+        int opened = 0;
+        int estimatedLengths = 0;
+        int reusedCodecs = 0;
+        int mismatchedFormats = 0;
+    };
+
+    // Expected rate and channel count per file, from the full probe
+    std::vector<std::pair<double, int>> referenceFormats;
+
+    Run measure(const juce::Array<juce::File>& files, bool fastOpen, bool reuseDecoder)
+    {
+        Run run;
+        AudioDecoder sharedDecoder;
+
+        for (int i = 0; i < files.size(); ++i)
+        {
+            AudioDecoder freshDecoder;
+            AudioDecoder& decoder = reuseDecoder ? sharedDecoder : freshDecoder;
+            decoder.setFastOpen(fastOpen);
+            decoder.setBuildSeekIndex(false);
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            const bool opened = decoder.open(files[i]);
+            const auto ticks = juce::Time::getHighResolutionTicks() - start;
+
+            if (!opened)
+                continue;
+
+            run.milliseconds.push_back(juce::Time::highResolutionTicksToSeconds(ticks) * 1000.0);
+            ++run.opened;
+            run.estimatedLengths += decoder.isLengthEstimated() ? 1 : 0;
+            run.reusedCodecs += decoder.didReuseCodec() ? 1 : 0;
+
+            const std::pair<double, int> format { decoder.getSourceSampleRate(), decoder.getNumChannels() };
+
+            if (!fastOpen)
+                referenceFormats.push_back(format);
+            else if (static_cast<size_t>(run.opened) <= referenceFormats.size()
+                     && referenceFormats[static_cast<size_t>(run.opened - 1)] != format)
+                ++run.mismatchedFormats;
+
+            decoder.closeInput();
+        }
+
+        return run;
+    }
+
+    static double median(std::vector<double> values)
+    {
+        if (values.empty())
+            return 0.0;
+
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    static juce::String describe(const Run& run)
+    {
+        double total = 0.0;
+        for (auto ms : run.milliseconds)
+            total += ms;
+
+        return "median " + juce::String(median(run.milliseconds), 2) + " ms, total "
+             + juce::String(total, 1) + " ms, " + juce::String(run.estimatedLengths) + " estimated lengths, "
+             + juce::String(run.reusedCodecs) + " codecs reused";
+    }
+};
+
+static AudioDecoderLoadBenchmark audioDecoderLoadBenchmark;
@@ -0,0 +1,104 @@
+#include <juce_core/juce_core.h>
+#include "LoadGovernor.h"
+
+class LoadGovernorTests : public juce::UnitTest
+{
+public:
+    LoadGovernorTests() : juce::UnitTest("LoadGovernor Tests") {}
+
+    void runTest() override
+    {
+        // The engine polls about four times a second
+        constexpr double poll = 0.25;
+
+        beginTest("Moderate Load Keeps Full Quality");
+        {
+            LoadGovernor governor(4);
+
+            for (int i = 0; i < 400; ++i)
+                governor.update(0.55, 0.65, poll);
+
+            expectEquals(governor.getLevel(), 0);
+            expectEquals(static_cast<int>(governor.getStepsDown()), 0);
+        }
+
+        beginTest("Sustained Overload Steps Down One Level At A Time");
+        {
+            LoadGovernor governor(4);
+
+            expectEquals(governor.update(0.9, 0.95, poll), 0);   // Not held long enough yet
+            expectEquals(governor.update(0.9, 0.95, poll), 1);
+            expectEquals(governor.getLevel(), 1);
+            expectEquals(governor.update(0.9, 0.95, poll), 0);
+
+            for (int i = 0; i < 100; ++i)
+                governor.update(0.9, 0.95, poll);
+
+            // Never past the last level
+            expectEquals(governor.getLevel(), 3);
+            expectEquals(static_cast<int>(governor.getStepsDown()), 3);
+        }
+
+        beginTest("A Missed Deadline Counts Even When The Average Is Low");
+        {
+            LoadGovernor governor(3);
+            governor.update(0.3, 1.2, poll);
+            governor.update(0.3, 1.2, poll);
+
+            expectEquals(governor.getLevel(), 1);
+        }
+
+        beginTest("Calm Steps Back Up After The Hold");
+        {
+            LoadGovernor governor(3);
+            overload(governor, poll, 2);
+            expectEquals(governor.getLevel(), 2);
+
+            const int pollsToStepUp = static_cast<int>(LoadGovernor::STEP_UP_SECONDS / poll);
+            int steps = 0;
+            for (int i = 0; i < pollsToStepUp - 1; ++i)
+                steps += governor.update(0.2, 0.3, poll);
+
+            expectEquals(steps, 0);
+            expectEquals(governor.update(0.2, 0.3, poll), -1);
+
+            // Loads between the thresholds neither step down nor count as calm
+            for (int i = 0; i < 1000; ++i)
+                governor.update(0.55, 0.6, poll);
+
+            expectEquals(governor.getLevel(), 1);
+            expectEquals(static_cast<int>(governor.getStepsUp()), 1);
+        }
+
+        beginTest("Stepping Up Too Soon Backs Off");
+        {
+            LoadGovernor governor(3);
+            overload(governor, poll, 2);
+
+            for (int round = 0; round < 3; ++round)
+            {
+                const double hold = governor.getStepUpSeconds();
+
+                while (governor.update(0.2, 0.3, poll) == 0) {}
+                overload(governor, poll, 1);
+
+                expectWithinAbsoluteError(governor.getStepUpSeconds(), 2.0 * hold, 1.0e-9);
+            }
+
+            // Back at full quality, the hold starts over
+            while (governor.getLevel() > 0)
+                governor.update(0.2, 0.3, poll);
+
+            expectWithinAbsoluteError(governor.getStepUpSeconds(), LoadGovernor::STEP_UP_SECONDS, 1.0e-9);
+        }
+    }
+
+private:
+    static void overload(LoadGovernor& governor, double poll, int levels)
+    {
+        for (int stepped = 0; stepped < levels;)
+            stepped += governor.update(0.9, 0.95, poll);
+    }
+};
+
+static LoadGovernorTests loadGovernorTests;
@@ -77,6 +77,27 @@ public:
             expect(buffer.getNumAvailable() == 7, "Available should match written amount");
         }
 
+        beginTest("Ring Buffer Discard");
+        {
+            LockFreeRingBuffer<float> buffer(8);
+            std::vector<float> data = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f};
+
+            buffer.write(data.data(), data.size());
+            buffer.discard();
+            expect(buffer.getNumAvailable() == 0, "Discard should drop all readable data");
+            expect(buffer.getFreeSpace() == buffer.getSize(), "Discard should free the whole buffer");
+
+            // Both indices now sit part way in, so filling the buffer has to
+            // cross the wrap point on the way in and on the way out
+            std::vector<float> full = {11.0f, 12.0f, 13.0f, 14.0f, 15.0f, 16.0f, 17.0f, 18.0f};
+            expect(buffer.write(full.data(), full.size()), "Should fill the buffer after discard");
+            expect(buffer.getFreeSpace() == 0, "Buffer should be full");
+
+            std::vector<float> readBack(full.size(), 0.0f);
+            expect(buffer.read(readBack.data(), readBack.size()), "Should read after discard");
+            expect(readBack == full, "Data written across the wrap should be intact");
+        }
+
         beginTest("Ring Buffer Thread Safety");
         {
             LockFreeRingBuffer<float> buffer(1024);
@@ -0,0 +1,101 @@
+#include <juce_core/juce_core.h>
+#include "LoudnessMeter.h"
+#include <cmath>
+#include <vector>
+
+class LoudnessMeterTests : public juce::UnitTest
+{
+public:
+    LoudnessMeterTests() : juce::UnitTest("LoudnessMeter Tests") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+
+        beginTest("Full Scale 1kHz Sine Reads 0 LUFS");
+        {
+            // BS.1770 calibration: a 0dBFS 1kHz sine in both channels is 0 LUFS
+            LoudnessMeter meter;
+            meter.reset(sampleRate);
+            feedSine(meter, sampleRate, 1000.0, 1.0f, 5.0);
+
+            expectWithinAbsoluteError(meter.getIntegratedLufs(), 0.0, 0.1);
+        }
+
+        beginTest("Level Changes Move Loudness One For One");
+        {
+            LoudnessMeter meter;
+            meter.reset(44100.0);
+            feedSine(meter, 44100.0, 1000.0, 0.1f, 5.0);
+
+            expectWithinAbsoluteError(meter.getIntegratedLufs(), -20.0, 0.1);
+        }
+
+        beginTest("Silence Is Gated Out");
+        {
+            LoudnessMeter meter;
+            meter.reset(sampleRate);
+            feedSine(meter, sampleRate, 1000.0, 0.1f, 3.0);
+            feedSine(meter, sampleRate, 1000.0, 0.0f, 10.0);
+
+            // Silent windows fall below -70 LUFS and do not drag the result down;
+            // only the few windows straddling the edge pull it slightly lower
+            expectWithinAbsoluteError(meter.getIntegratedLufs(), -20.0, 0.3);
+        }
+
+        beginTest("True Peak Catches Inter-Sample Peaks");
+        {
+            // fs/4 sine at 45 degrees: every sample is at 0.707 of the real peak
+            LoudnessMeter meter;
+            meter.reset(sampleRate);
+
+            std::vector<float> left(48000), right(48000);
+            for (size_t i = 0; i < left.size(); ++i)
+                left[i] = right[i] = static_cast<float>(0.5 * std::sin(juce::MathConstants<double>::halfPi * i + juce::MathConstants<double>::pi / 4.0));
+
+            meter.process(left.data(), right.data(), static_cast<int>(left.size()));
+
+            const double samplePeakDb = 20.0 * std::log10(0.5 * std::sqrt(0.5));
+            expect(meter.getTruePeakDb() > samplePeakDb + 2.5, "True peak should exceed the sample peak");
+            expectWithinAbsoluteError(meter.getTruePeakDb(), 20.0 * std::log10(0.5), 0.5);
+        }
+
+        beginTest("Block RMS Follows The Signal");
+        {
+            LoudnessMeter meter;
+            meter.reset(sampleRate);
+            feedSine(meter, sampleRate, 440.0, 0.5f, 1.0);
+
+            const auto result = meter.getResult();
+            expect(result.isValid, "A second of audio should give a result");
+            expectEquals(static_cast<int>(result.blockRms.size()), 10);
+            expectWithinAbsoluteError(result.blocksPerSecond, 10.0, 1.0e-9);
+            expectWithinAbsoluteError(static_cast<double>(result.blockRms.back()), 0.5 / std::sqrt(2.0), 0.01);
+        }
+    }
+
+private:
+    static void feedSine(LoudnessMeter& meter, double sampleRate, double frequency, float amplitude, double seconds)
+    {
+        // Odd-sized chunks so block boundaries fall inside them
+        constexpr int chunkFrames = 1000;
+        std::vector<float> left(chunkFrames), right(chunkFrames);
+
+        const auto totalFrames = static_cast<int>(seconds * sampleRate);
+
+        for (int start = 0; start < totalFrames; start += chunkFrames)
+        {
+            const int frames = juce::jmin(chunkFrames, totalFrames - start);
+
+            for (int i = 0; i < frames; ++i)
+            {
+                const double phase = 2.0 * juce::MathConstants<double>::pi * frequency * (start + i) / sampleRate;
+                left[static_cast<size_t>(i)] = right[static_cast<size_t>(i)] = amplitude * static_cast<float>(std::sin(phase));
+            }
+
+            meter.process(left.data(), right.data(), frames);
+        }
+    }
+};
+
+static LoudnessMeterTests loudnessMeterTests;
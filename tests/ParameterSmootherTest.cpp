@@ -1,5 +1,7 @@
 #include <juce_core/juce_core.h>
 #include "ParameterSmoother.h"
+#include "RubberBandNode.h"
+#include <cmath>
 
 class ParameterSmootherTests : public juce::UnitTest
 {
@@ -61,6 +63,45 @@ public:
                                     "Should reach target value");
         }
 
+        beginTest("Parameter Smoother Reaches Large Targets Exactly");
+        {
+            // Short of the target, steps fall below float resolution; the
+            // smoother has to notice and finish rather than creep forever
+            ParameterSmoother<float> smoother;
+            smoother.setSampleRate(48000.0);
+            smoother.setSmoothingTimeMs(20.0f);
+            smoother.setCurrentAndTargetValue(8000.0f);
+            smoother.setTargetValue(12000.0f);
+
+            int steps = 0;
+            while (smoother.isSmoothing() && steps < 1000000)
+            {
+                smoother.getNextValue();
+                ++steps;
+            }
+
+            expect(!smoother.isSmoothing(), "Should stop smoothing once steps stop moving the value");
+            expect(smoother.getCurrentValue() == 12000.0f, "Should land exactly on the target");
+            expectLessThan(steps, 100000, "Should settle within a bounded number of steps");
+        }
+
+        beginTest("Parameter Smoother Round Trip Returns Exactly");
+        {
+            ParameterSmoother<float> smoother;
+            smoother.setSampleRate(44100.0);
+            smoother.setSmoothingTimeMs(50.0f);
+            smoother.setCurrentAndTargetValue(1.0f);
+
+            for (const float target : { 0.8f, 1.0f })
+            {
+                smoother.setTargetValue(target);
+                for (int i = 0; i < 100000 && smoother.isSmoothing(); ++i)
+                    smoother.getNextValue();
+            }
+
+            expect(smoother.getCurrentValue() == 1.0f, "Should come back to exactly where it started");
+        }
+
         beginTest("Parameter Smoother Reset");
         {
             ParameterSmoother<float> smoother;
@@ -78,7 +119,80 @@ public:
             expect(smoother.getCurrentValue() == 0.5f, "Should have new current value");
             expect(smoother.getTargetValue() == 0.5f, "Should have new target value");
         }
+
+        // Tempo reaches the stretcher through two smoothers, one step per
+        // block each: the engine's, then 1 / tempo into the node's own
+        beginTest("Tempo Round Trip Comes Back To Neutral");
+        {
+            Chain chain;
+
+            for (const float tempo : { 1.25f, 1.0f })
+                chain.run(tempo);
+
+            // The stretcher can only be bypassed if this holds
+            expect(RubberBandNode::settingsMatch(chain.node.getCurrentValue(), 1.0f), "Time ratio should settle back at 1");
+            expect(RubberBandNode::settingsMatch(chain.node.getTargetValue(), 1.0f), "Time ratio target should be back at 1");
+            expect(!chain.node.isSmoothing(), "Time ratio should stop moving");
+        }
+
+        beginTest("Several Excursions Still Come Back To Neutral");
+        {
+            Chain chain;
+
+            for (const float tempo : { 0.5f, 1.37f, 0.83f, 1.0f })
+                chain.run(tempo);
+
+            expect(RubberBandNode::settingsMatch(chain.node.getCurrentValue(), 1.0f), "Time ratio should settle back at 1");
+            expect(!chain.node.isSmoothing(), "Time ratio should stop moving");
+        }
+
+        beginTest("A Settled Tempo Matches The Ratio Sent For It");
+        {
+            Chain chain;
+            chain.run(1.25f);
+
+            // What AudioEngine asks the loop cache to render at this tempo
+            const float cachedRatio = 1.0f / 1.25f;
+            expect(RubberBandNode::settingsMatch(chain.node.getCurrentValue(), cachedRatio), "Live ratio should match the cached one");
+            expect(RubberBandNode::settingsMatch(chain.node.getTargetValue(), cachedRatio), "Target ratio should match the cached one");
+        }
+
+        beginTest("Real Tempo Changes Do Not Match");
+        {
+            // One percent, the tempo slider's step, is a different setting
+            expect(!RubberBandNode::settingsMatch(1.0f / 1.01f, 1.0f), "A 1% tempo change should not count as neutral");
+            expect(!RubberBandNode::settingsMatch(std::pow(2.0f, 1.0f / 12.0f), 1.0f), "A semitone should not count as neutral");
+        }
     }
+
+private:
+    struct Chain
+    {
+        ParameterSmoother<float> engine;   // AudioEngine::tempoSmoother
+        ParameterSmoother<float> node;     // RubberBandNode::timeRatioSmoother
+
+        Chain()
+        {
+            for (auto* smoother : { &engine, &node })
+            {
+                smoother->setSampleRate(44100.0);
+                smoother->setSmoothingTimeMs(50.0f);
+                smoother->setCurrentAndTargetValue(1.0f);
+            }
+        }
+
+        // Blocks at a tempo until both smoothers stop, or a generous limit
+        void run(float tempo)
+        {
+            engine.setTargetValue(tempo);
+
+            for (int block = 0; block < 200000 && (engine.isSmoothing() || node.isSmoothing()); ++block)
+            {
+                node.setTargetValue(1.0f / engine.getNextValue());
+                node.getNextValue();
+            }
+        }
+    };
 };
 
 static ParameterSmootherTests parameterSmootherTests;
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <juce_core/juce_core.h>
+#include "ParametricEQ.h"
+#include <cmath>
+#include <vector>
+
+// Compares the CPU cost per block of a 3-band and a 10-band ParametricEQ,
+// with every band shaping the sound, with only 3 of the 10 doing so, and
+// with every band's gain being swept. Figures are for the EQ alone.
+class ParametricEQBenchmark : public juce::UnitTest
+{
+public:
+    ParametricEQBenchmark() : juce::UnitTest("Parametric EQ Benchmark", "Benchmarks") {}
+
+    void runTest() override
+    {
+        beginTest("3 bands, all active");
+        const double threeBands = measure<3>(3, false);
+        logMessage("3 bands: " + juce::String(threeBands, 3) + " us/block");
+
+        beginTest("10 bands, all active");
+        const double tenBands = measure<10>(10, false);
+        logMessage("10 bands: " + juce::String(tenBands, 3) + " us/block ("
+                   + juce::String(tenBands / threeBands, 2) + "x the 3-band cost)");
+
+        beginTest("10 bands, 3 active");
+        const double tenBandsThreeActive = measure<10>(3, false);
+        logMessage("10 bands, 3 active: " + juce::String(tenBandsThreeActive, 3) + " us/block ("
+                   + juce::String(tenBandsThreeActive / threeBands, 2) + "x the 3-band cost)");
+
+        beginTest("3 and 10 bands, gains sweeping");
+        const double threeSweeping = measure<3>(3, true);
+        const double tenSweeping = measure<10>(10, true);
+        logMessage("Sweeping: 3 bands " + juce::String(threeSweeping, 3) + " us/block, 10 bands "
+                   + juce::String(tenSweeping, 3) + " us/block (" + juce::String(tenSweeping / threeSweeping, 2) + "x)");
+    }
+
+private:
+    static constexpr double SAMPLE_RATE = 48000.0;
+    static constexpr int BLOCK_SIZE = 512;
+    static constexpr int NUM_BLOCKS = 4000;
+
+    // Microseconds per block, with the first activeBands bands boosted or cut
+    // and the rest left flat at 0dB
+    template <int NumBands>
+    double measure(int activeBands, bool sweepGains)
+    {
+        ParametricEQ<NumBands> eq;
+
+        for (int band = 0; band < NumBands; ++band)
+        {
+            eq.setBandFrequency(band, 60.0f * std::pow(2.0f, static_cast<float>(band)));
+            eq.setBandGain(band, band < activeBands ? (band % 2 == 0 ? 6.0f : -4.0f) : 0.0f);
+        }
+
+        eq.prepare(SAMPLE_RATE, 20.0f);
+
+        std::vector<float> left(BLOCK_SIZE), right(BLOCK_SIZE);
+        juce::Random random(1);
+        juce::int64 ticks = 0;
+
+        for (int block = 0; block < NUM_BLOCKS; ++block)
+        {
+            for (int i = 0; i < BLOCK_SIZE; ++i)
+            {
+                left[static_cast<size_t>(i)] = random.nextFloat() * 0.5f - 0.25f;
+                right[static_cast<size_t>(i)] = random.nextFloat() * 0.5f - 0.25f;
+            }
+
+            // A new target every few blocks keeps the smoothers moving
+            if (sweepGains && block % 8 == 0)
+            {
+                for (int band = 0; band < activeBands; ++band)
+                    eq.setBandGain(band, (block / 8 + band) % 2 == 0 ? 6.0f : -6.0f);
+            }
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            eq.process(left.data(), right.data(), BLOCK_SIZE);
+            ticks += juce::Time::getHighResolutionTicks() - start;
+        }
+
+        expect(std::isfinite(left.back()) && std::isfinite(right.back()), "The EQ should stay stable");
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6 / NUM_BLOCKS;
+    }
+};
+
+static ParametricEQBenchmark parametricEQBenchmark;
@@ -0,0 +1,157 @@
+#include <juce_core/juce_core.h>
+#include "ParametricEQ.h"
+#include <cmath>
+#include <vector>
+
+class ParametricEQTests : public juce::UnitTest
+{
+public:
+    ParametricEQTests() : juce::UnitTest("ParametricEQ Tests") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+
+        beginTest("A Flat EQ Passes The Signal Untouched");
+        {
+            ParametricEQ<10> eq;
+            for (int band = 0; band < 10; ++band)
+                eq.setBandFrequency(band, 40.0f * static_cast<float>(band + 1));
+
+            eq.prepare(sampleRate, 20.0f);
+
+            auto left = sine(sampleRate, 440.0, 4800);
+            auto right = sine(sampleRate, 3000.0, 4800);
+            const auto expectedLeft = left, expectedRight = right;
+            eq.process(left.data(), right.data(), 4800);
+
+            expect(left == expectedLeft);
+            expect(right == expectedRight);
+        }
+
+        beginTest("Band Types Shape The Response");
+        {
+            // Gain at the band's own frequency, or well inside its stop band
+            expectWithinAbsoluteError(gainDb(sampleRate, EQBandType::Peak, 1000.0f, 6.0f, 1000.0), 6.0, 0.1);
+            expectWithinAbsoluteError(gainDb(sampleRate, EQBandType::Peak, 1000.0f, -9.0f, 1000.0), -9.0, 0.1);
+            expectWithinAbsoluteError(gainDb(sampleRate, EQBandType::LowShelf, 500.0f, 6.0f, 30.0), 6.0, 0.2);
+            expectWithinAbsoluteError(gainDb(sampleRate, EQBandType::HighShelf, 2000.0f, -6.0f, 15000.0), -6.0, 0.2);
+            expectWithinAbsoluteError(gainDb(sampleRate, EQBandType::HighPass, 1000.0f, 0.0f, 1000.0), -3.0, 0.1);
+            expectLessThan(gainDb(sampleRate, EQBandType::HighPass, 1000.0f, 0.0f, 100.0), -38.0);
+            expectLessThan(gainDb(sampleRate, EQBandType::LowPass, 1000.0f, 0.0f, 10000.0), -38.0);
+            expectLessThan(gainDb(sampleRate, EQBandType::Notch, 1000.0f, 0.0f, 1000.0), -40.0);
+            expectWithinAbsoluteError(gainDb(sampleRate, EQBandType::Notch, 1000.0f, 0.0f, 10000.0), 0.0, 0.1);
+        }
+
+        beginTest("Disabled Bands Pass The Signal Untouched");
+        {
+            ParametricEQ<4> eq;
+            eq.setBandType(2, EQBandType::LowPass);
+            eq.setBandFrequency(2, 200.0f);
+            eq.setBandEnabled(2, false);
+            eq.prepare(sampleRate, 20.0f);
+
+            auto left = sine(sampleRate, 5000.0, 4800);
+            const auto expected = left;
+            eq.process(left.data(), nullptr, 4800);
+
+            expect(left == expected);
+        }
+
+        beginTest("Gain Changes Are Smoothed Over The Smoothing Time");
+        {
+            ParametricEQ<8> eq;
+            eq.prepare(sampleRate, 20.0f);
+            eq.setBandGain(5, 12.0f);
+
+            std::vector<float> left(static_cast<size_t>(ParametricEQ<8>::SMOOTHING_STEP), 0.0f);
+            eq.process(left.data(), nullptr, static_cast<int>(left.size()));
+
+            // One step in, the gain has only started to move...
+            expectGreaterThan(eq.getCurrentGain(5), 0.0f);
+            expectLessThan(eq.getCurrentGain(5), 2.0f);
+
+            // ...after one time constant it is most of the way...
+            std::vector<float> block(960 - left.size(), 0.0f);
+            eq.process(block.data(), nullptr, static_cast<int>(block.size()));
+            expectWithinAbsoluteError(eq.getCurrentGain(5), 12.0f * (1.0f - std::exp(-1.0f)), 0.1f);
+
+            // ...and it lands exactly on the target
+            std::vector<float> tail(48000, 0.0f);
+            eq.process(tail.data(), nullptr, static_cast<int>(tail.size()));
+            expectEquals(eq.getCurrentGain(5), 12.0f);
+        }
+
+        beginTest("Changing A Band's Type Restarts It From Silence");
+        {
+            const auto configure = [](ParametricEQ<2>& eq, EQBandType type)
+            {
+                eq.setBandType(0, type);
+                eq.setBandFrequency(0, 500.0f);
+                eq.setBandGain(0, 12.0f);
+            };
+
+            ParametricEQ<2> eq;
+            configure(eq, EQBandType::LowShelf);
+            eq.prepare(sampleRate, 20.0f);
+
+            auto before = sine(sampleRate, 100.0, 4800);
+            eq.process(before.data(), nullptr, 4800);
+
+            // None of the shelf's state carries over, so from here on the band
+            // sounds exactly like a high-pass that was there all along
+            ParametricEQ<2> fresh;
+            configure(fresh, EQBandType::HighPass);
+            fresh.prepare(sampleRate, 20.0f);
+
+            configure(eq, EQBandType::HighPass);
+            auto after = sine(sampleRate, 100.0, 4800);
+            auto expected = after;
+            eq.process(after.data(), nullptr, 4800);
+            fresh.process(expected.data(), nullptr, 4800);
+
+            expect(after == expected);
+        }
+    }
+
+private:
+    static std::vector<float> sine(double sampleRate, double frequency, int numFrames)
+    {
+        std::vector<float> samples(static_cast<size_t>(numFrames));
+        for (size_t i = 0; i < samples.size(); ++i)
+            samples[i] = 0.5f * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * frequency * static_cast<double>(i) / sampleRate));
+
+        return samples;
+    }
+
+    static double rms(const float* samples, int numFrames)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < numFrames; ++i)
+            sum += static_cast<double>(samples[i]) * samples[i];
+
+        return std::sqrt(sum / numFrames);
+    }
+
+    // Steady state gain of a single band EQ for a sine at the probe frequency
+    static double gainDb(double sampleRate, EQBandType type, float frequency, float gainDb, double probe)
+    {
+        ParametricEQ<3> eq;
+        eq.setBandType(1, type);
+        eq.setBandFrequency(1, frequency);
+        eq.setBandGain(1, gainDb);
+        eq.setBandQ(1, type == EQBandType::Peak ? 1.4f : 0.707f);
+        eq.prepare(sampleRate, 20.0f);
+
+        const int numFrames = static_cast<int>(sampleRate);
+        auto input = sine(sampleRate, probe, numFrames);
+        auto output = input;
+        eq.process(output.data(), nullptr, numFrames);
+
+        // Measure the second half, once the filter has settled
+        const int half = numFrames / 2;
+        return juce::Decibels::gainToDecibels(rms(output.data() + half, half) / rms(input.data() + half, half), -200.0);
+    }
+};
+
+static ParametricEQTests parametricEQTests;
@@ -0,0 +1,103 @@
+#include <juce_core/juce_core.h>
+#include "PcmPageCache.h"
+#include <vector>
+
+class PcmPageCacheTests : public juce::UnitTest
+{
+public:
+    PcmPageCacheTests() : juce::UnitTest("PcmPageCache Tests") {}
+
+    void runTest() override
+    {
+        constexpr int pageFrames = 64;
+        constexpr size_t twoPagesBytes = pageFrames * PcmPageCache::NUM_CHANNELS * sizeof(float) * 2;
+
+        std::vector<float> left(pageFrames), right(pageFrames);
+        float* outputs[PcmPageCache::NUM_CHANNELS] = { left.data(), right.data() };
+
+        beginTest("Page Cache Miss Then Hit");
+        {
+            PcmPageCache cache(pageFrames, twoPagesBytes);
+            expect(cache.getMaxPages() == 2, "Budget should allow two pages");
+
+            expect(cache.read(10, outputs, 8) == 0, "Empty cache should miss");
+            expect(cache.getMisses() == 1, "Miss should be counted");
+
+            fillPage(cache, 0, pageFrames);
+
+            expect(cache.read(10, outputs, 8) == 8, "Stored page should hit");
+            expect(cache.getHits() == 1, "Hit should be counted");
+
+            for (int i = 0; i < 8; ++i)
+            {
+                expect(left[i] == static_cast<float>(10 + i), "Left channel should match stored data");
+                expect(right[i] == -static_cast<float>(10 + i), "Right channel should match stored data");
+            }
+        }
+
+        beginTest("Page Cache Reads Stop At Page End");
+        {
+            PcmPageCache cache(pageFrames, twoPagesBytes);
+            fillPage(cache, 0, pageFrames);
+
+            expect(cache.read(pageFrames - 4, outputs, 16) == 4, "Read should not cross into the next page");
+            expect(cache.read(pageFrames, outputs, 16) == 0, "Next page has not been stored");
+        }
+
+        beginTest("Page Cache Short Last Page");
+        {
+            PcmPageCache cache(pageFrames, twoPagesBytes);
+            fillPage(cache, 1, 20);
+
+            expect(cache.read(pageFrames + 10, outputs, 16) == 10, "Read should stop at the end of a short page");
+            expect(cache.read(pageFrames + 20, outputs, 16) == 0, "Frames past a short page should miss");
+        }
+
+        beginTest("Page Cache Evicts Least Recently Used");
+        {
+            PcmPageCache cache(pageFrames, twoPagesBytes);
+            fillPage(cache, 0, pageFrames);
+            fillPage(cache, 1, pageFrames);
+
+            // Touch page 0 so page 1 becomes the oldest
+            cache.read(0, outputs, 1);
+            fillPage(cache, 2, pageFrames);
+
+            expect(cache.getNumPages() == 2, "Cache should stay within its budget");
+            expect(cache.getEvictions() == 1, "Eviction should be counted");
+            expect(cache.read(0, outputs, 1) == 1, "Recently used page should survive");
+            expect(cache.read(pageFrames, outputs, 1) == 0, "Least recently used page should be evicted");
+            expect(cache.read(pageFrames * 2, outputs, 1) == 1, "New page should be cached");
+        }
+
+        beginTest("Page Cache Clear");
+        {
+            PcmPageCache cache(pageFrames, twoPagesBytes);
+            fillPage(cache, 0, pageFrames);
+            cache.clear();
+
+            expect(cache.read(0, outputs, 1) == 0, "Cleared cache should miss");
+
+            fillPage(cache, 3, pageFrames);
+            expect(cache.getNumPages() == 1, "Cleared pages should be reused");
+            expect(cache.getEvictions() == 0, "Reusing a cleared page is not an eviction");
+        }
+    }
+
+private:
+    static void fillPage(PcmPageCache& cache, int64_t pageIndex, int numFrames)
+    {
+        float* const* page = cache.beginPage(pageIndex);
+        const int64_t pageStart = cache.getPageStart(pageIndex);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            page[0][i] = static_cast<float>(pageStart + i);
+            page[1][i] = -static_cast<float>(pageStart + i);
+        }
+
+        cache.commitPage(numFrames);
+    }
+};
+
+static PcmPageCacheTests pcmPageCacheTests;
@@ -0,0 +1,110 @@
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include "LockFreeRingBuffer.h"
+#include <vector>
+
+// Compares two ways of getting decoded audio from a FIFO into a JUCE buffer:
+// an interleaved FIFO read into a per-block allocation and deinterleaved, and
+// planar per-channel FIFOs read straight into the buffer. These are synthetic
+// loops modelled on the two copy strategies; they do not run AudioFileSource
+// itself, so the figures cover the copy alone, not the whole audio callback.
+class PlanarFifoBenchmark : public juce::UnitTest
+{
+public:
+    PlanarFifoBenchmark() : juce::UnitTest("Planar FIFO Copy Benchmark", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr int blockSize = 512;
+        constexpr int numBlocks = 4000;
+        constexpr size_t fifoFrames = 32768;
+
+        juce::AudioBuffer<float> interleavedOutput(2, blockSize);
+        juce::AudioBuffer<float> planarOutput(2, blockSize);
+
+        std::vector<float> interleavedSource(blockSize * 2);
+        std::vector<float> leftSource(blockSize);
+        std::vector<float> rightSource(blockSize);
+
+        for (int i = 0; i < blockSize; ++i)
+        {
+            leftSource[i] = interleavedSource[i * 2] = static_cast<float>(i) / blockSize;
+            rightSource[i] = interleavedSource[i * 2 + 1] = -static_cast<float>(i) / blockSize;
+        }
+
+        beginTest("Interleaved FIFO with per-block allocation");
+        double interleavedMicros = 0.0;
+        {
+            LockFreeRingBuffer<float> fifo(fifoFrames * 2);
+            juce::int64 ticks = 0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                fifo.write(interleavedSource.data(), interleavedSource.size());
+
+                const auto start = juce::Time::getHighResolutionTicks();
+
+                std::vector<float> interleavedBuffer(blockSize * 2);
+                fifo.read(interleavedBuffer.data(), interleavedBuffer.size());
+
+                for (int channel = 0; channel < 2; ++channel)
+                {
+                    float* channelData = interleavedOutput.getWritePointer(channel);
+
+                    for (int sample = 0; sample < blockSize; ++sample)
+                    {
+                        channelData[sample] = interleavedBuffer[sample * 2 + channel];
+                    }
+                }
+
+                ticks += juce::Time::getHighResolutionTicks() - start;
+            }
+
+            interleavedMicros = juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6 / numBlocks;
+            logMessage("Interleaved: " + juce::String(interleavedMicros, 3) + " us/block");
+        }
+
+        beginTest("Planar FIFO read into the output buffer");
+        double planarMicros = 0.0;
+        {
+            LockFreeRingBuffer<float> leftFifo(fifoFrames);
+            LockFreeRingBuffer<float> rightFifo(fifoFrames);
+            juce::int64 ticks = 0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                leftFifo.write(leftSource.data(), leftSource.size());
+                rightFifo.write(rightSource.data(), rightSource.size());
+
+                const auto start = juce::Time::getHighResolutionTicks();
+
+                leftFifo.read(planarOutput.getWritePointer(0), blockSize);
+                rightFifo.read(planarOutput.getWritePointer(1), blockSize);
+
+                ticks += juce::Time::getHighResolutionTicks() - start;
+            }
+
+            planarMicros = juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6 / numBlocks;
+            logMessage("Planar: " + juce::String(planarMicros, 3) + " us/block");
+        }
+
+        beginTest("Both paths produce identical audio");
+        {
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                for (int sample = 0; sample < blockSize; ++sample)
+                {
+                    expect(interleavedOutput.getSample(channel, sample) == planarOutput.getSample(channel, sample),
+                           "Planar output should match the interleaved path");
+                }
+            }
+
+            if (planarMicros > 0.0)
+            {
+                logMessage("Speedup: " + juce::String(interleavedMicros / planarMicros, 2) + "x");
+            }
+        }
+    }
+};
+
+static PlanarFifoBenchmark planarFifoBenchmark;
@@ -0,0 +1,146 @@
+#include <juce_core/juce_core.h>
+#include "RubberBandNode.h"
+#include <cmath>
+
+class RubberBandNodeTests : public juce::UnitTest
+{
+public:
+    RubberBandNodeTests() : juce::UnitTest("RubberBandNode Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Settings Within The Tolerance Of 1 Bypass The Stretcher");
+        {
+            SineSource source;
+            RubberBandNode node;
+            prepare(node, source, 1.0f + 0.5f * RubberBandNode::SETTING_TOLERANCE);
+
+            Meter meter;
+            for (int block = 0; block < 400; ++block)
+                meter.measure(process(node), block >= 100);
+
+            expect(node.isBypassingStretcher(), "Near-neutral settings should go round the stretcher");
+            expectLessOrEqual(meter.largestStep, 2.0 * naturalStep, "Output should stay continuous");
+            expectGreaterThan(meter.quietestBlock, 0.9 * sineRms, "Output should keep its level");
+            expectEquals(node.getStarvedBlockCount(), (uint64_t) 0, "No block should come up short");
+        }
+
+        beginTest("A Tempo Change Leaves The Bypass Without A Gap");
+        {
+            SineSource source;
+            RubberBandNode node;
+            prepare(node, source, 1.0f);
+
+            Meter meter;
+            for (int block = 0; block < 200; ++block)
+                meter.measure(process(node), block >= 100);
+            expect(node.isBypassingStretcher(), "Neutral settings should go round the stretcher");
+
+            node.setTimeRatio(1.25f);
+            for (int block = 0; block < 400; ++block)
+                meter.measure(process(node), true);
+
+            expect(!node.isBypassingStretcher(), "A real tempo change should go through the stretcher");
+            expectLessOrEqual(meter.largestStep, 2.0 * naturalStep, "Output should stay continuous");
+            expectGreaterThan(meter.quietestBlock, 0.8 * sineRms, "Output should not dip");
+            expectEquals(node.getStarvedBlockCount(), (uint64_t) 0, "No block should come up short");
+        }
+
+        beginTest("Returning To Neutral Takes The Bypass Without A Gap");
+        {
+            SineSource source;
+            RubberBandNode node;
+            prepare(node, source, 1.25f);
+
+            for (int block = 0; block < 200; ++block)
+                process(node);
+
+            // The node smooths the ratio back down, so give it as long as it needs
+            Meter meter;
+            node.setTimeRatio(1.0f);
+            for (int block = 0; block < 40000 && !node.isBypassingStretcher(); ++block)
+                meter.measure(process(node), true);
+            for (int block = 0; block < 200; ++block)
+                meter.measure(process(node), true);
+
+            expect(node.isBypassingStretcher(), "Settling back at 1 should go round the stretcher");
+            expectLessOrEqual(meter.largestStep, 2.0 * naturalStep, "Output should stay continuous");
+            expectGreaterThan(meter.quietestBlock, 0.8 * sineRms, "Output should not dip");
+            expectEquals(node.getStarvedBlockCount(), (uint64_t) 0, "No block should come up short");
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 256;
+    static constexpr double frequency = 440.0;
+    static constexpr double amplitude = 0.5;
+
+    // Biggest sample-to-sample step of the input, and its block level
+    static constexpr double naturalStep = amplitude * 2.0 * juce::MathConstants<double>::pi * frequency / sampleRate;
+    static inline const double sineRms = amplitude / std::sqrt(2.0);
+
+    struct SineSource : AudioPullSource
+    {
+        int64_t frame = 0;
+
+        int pullAudio(juce::AudioBuffer<float>& destination, int numFrames) override
+        {
+            for (int i = 0; i < numFrames; ++i, ++frame)
+            {
+                const auto sample = static_cast<float>(amplitude * std::sin(2.0 * juce::MathConstants<double>::pi * frequency * static_cast<double>(frame) / sampleRate));
+                for (int channel = 0; channel < destination.getNumChannels(); ++channel)
+                    destination.setSample(channel, i, sample);
+            }
+            return numFrames;
+        }
+
+        int64_t getNextPullFrame() const override { return frame; }
+    };
+
+    // Tracks the largest step between consecutive samples (across blocks too)
+    // and the quietest block
+    struct Meter
+    {
+        double largestStep = 0.0;
+        double quietestBlock = 1.0;
+        float previous = 0.0f;
+        bool started = false;
+
+        void measure(const juce::AudioBuffer<float>& block, bool counts)
+        {
+            const float* samples = block.getReadPointer(0);
+            double sum = 0.0;
+            for (int i = 0; i < block.getNumSamples(); ++i)
+            {
+                if (counts && started)
+                    largestStep = juce::jmax(largestStep, static_cast<double>(std::abs(samples[i] - previous)));
+                previous = samples[i];
+                started = true;
+                sum += samples[i] * samples[i];
+            }
+
+            if (counts)
+                quietestBlock = juce::jmin(quietestBlock, std::sqrt(sum / block.getNumSamples()));
+        }
+    };
+
+    juce::AudioBuffer<float> buffer{ 2, blockSize };
+    juce::MidiBuffer midi;
+
+    static void prepare(RubberBandNode& node, SineSource& source, float timeRatio)
+    {
+        node.setPullSource(&source);
+        node.setStretchEngine(RubberBandNode::StretchEngine::Wsola);
+        node.setTimeRatio(timeRatio);
+        node.prepareToPlay(sampleRate, blockSize);
+    }
+
+    const juce::AudioBuffer<float>& process(RubberBandNode& node)
+    {
+        node.processBlock(buffer, midi);
+        return buffer;
+    }
+};
+
+static RubberBandNodeTests rubberBandNodeTests;
@@ -0,0 +1,202 @@
+#include <juce_core/juce_core.h>
+#include "StereoBiquadCascade.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+class StereoBiquadCascadeTests : public juce::UnitTest
+{
+public:
+    StereoBiquadCascadeTests() : juce::UnitTest("StereoBiquadCascade Tests") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numFrames = 4800;
+
+        // Single precision rounding, which a 120Hz shelf's poles near the unit
+        // circle amplify, keeps the float cascade within about -86dB of the
+        // double reference; -80dB leaves margin without hiding a real bug
+        constexpr double tolerance = 1.0e-4;
+
+        // Low shelf, peak and high shelf, as EQNode uses them
+        const std::vector<std::array<float, 6>> stages = {
+            shelf(sampleRate, 120.0, 6.0, false),
+            peak(sampleRate, 1000.0, 1.4, -9.0),
+            shelf(sampleRate, 8000.0, 4.0, true)
+        };
+
+        beginTest("Matches A Scalar Double Precision Reference");
+        {
+            auto left = noise(numFrames, 1);
+            auto right = noise(numFrames, 2);
+            const auto expectedLeft = reference(stages, left);
+            const auto expectedRight = reference(stages, right);
+
+            StereoBiquadCascade cascade;
+            load(cascade, stages);
+
+            // Odd block sizes, so the state has to carry across calls
+            for (int start = 0, block = 1; start < numFrames; start += block, block = block * 3 % 509 + 1)
+            {
+                const int length = juce::jmin(block, numFrames - start);
+                cascade.process(left.data() + start, right.data() + start, length);
+            }
+
+            expectLessThan(maxDifference(left, expectedLeft), tolerance);
+            expectLessThan(maxDifference(right, expectedRight), tolerance);
+        }
+
+        beginTest("Mono Filters The Left Channel Alone");
+        {
+            auto stereoLeft = noise(numFrames, 3);
+            auto stereoRight = noise(numFrames, 4);
+            auto mono = stereoLeft;
+
+            StereoBiquadCascade stereoCascade, monoCascade;
+            load(stereoCascade, stages);
+            load(monoCascade, stages);
+
+            stereoCascade.process(stereoLeft.data(), stereoRight.data(), numFrames);
+            monoCascade.process(mono.data(), nullptr, numFrames);
+
+            expectEquals(maxDifference(mono, stereoLeft), 0.0);
+        }
+
+        beginTest("Disabled Stages Are Skipped And Restart From Silence");
+        {
+            auto left = noise(numFrames, 5);
+            auto right = left;
+            const auto expected = reference({ stages[0], stages[2] }, left);
+
+            StereoBiquadCascade cascade;
+            load(cascade, stages);
+            cascade.setStageEnabled(1, false);
+            cascade.process(left.data(), right.data(), numFrames);
+
+            expectLessThan(maxDifference(left, expected), tolerance);
+
+            // Back on, the peak picks up with no memory of the earlier audio
+            auto afterLeft = noise(numFrames, 6);
+            auto afterRight = afterLeft;
+            const auto expectedAfter = reference({ stages[1] }, afterLeft);
+
+            StereoBiquadCascade single;
+            load(single, { stages[1] });
+            single.setStageEnabled(0, false);
+            single.process(left.data(), right.data(), numFrames);
+            single.setStageEnabled(0, true);
+            single.process(afterLeft.data(), afterRight.data(), numFrames);
+
+            expectLessThan(maxDifference(afterLeft, expectedAfter), tolerance);
+        }
+
+        beginTest("A Decaying Tail Reaches True Zero");
+        {
+            std::vector<float> left(static_cast<size_t>(numFrames), 0.0f), right(static_cast<size_t>(numFrames), 0.0f);
+            left[0] = right[0] = 1.0f;
+
+            StereoBiquadCascade cascade;
+            load(cascade, stages);
+
+            for (int block = 0; block < 200; ++block)
+            {
+                cascade.process(left.data(), right.data(), numFrames);
+                std::fill(left.begin(), left.end(), 0.0f);
+                std::fill(right.begin(), right.end(), 0.0f);
+            }
+
+            cascade.process(left.data(), right.data(), numFrames);
+            expectEquals(maxDifference(left, std::vector<float>(left.size(), 0.0f)), 0.0);
+        }
+    }
+
+private:
+    static void load(StereoBiquadCascade& cascade, const std::vector<std::array<float, 6>>& stages)
+    {
+        cascade.setNumStages(static_cast<int>(stages.size()));
+        for (size_t stage = 0; stage < stages.size(); ++stage)
+            cascade.setCoefficients(static_cast<int>(stage), stages[stage]);
+    }
+
+    // The golden output: the same cascade, one channel, in doubles
+    static std::vector<float> reference(const std::vector<std::array<float, 6>>& stages, const std::vector<float>& input)
+    {
+        std::vector<float> output(input.size());
+        std::vector<std::array<double, 2>> state(stages.size(), { 0.0, 0.0 });
+
+        for (size_t i = 0; i < input.size(); ++i)
+        {
+            double x = input[i];
+
+            for (size_t stage = 0; stage < stages.size(); ++stage)
+            {
+                const auto& c = stages[stage];
+                const double b0 = c[0] / c[3], b1 = c[1] / c[3], b2 = c[2] / c[3], a1 = c[4] / c[3], a2 = c[5] / c[3];
+
+                const double y = b0 * x + state[stage][0];
+                state[stage][0] = b1 * x - a1 * y + state[stage][1];
+                state[stage][1] = b2 * x - a2 * y;
+                x = y;
+            }
+
+            output[i] = static_cast<float>(x);
+        }
+
+        return output;
+    }
+
+    static std::vector<float> noise(int numFrames, uint32_t seed)
+    {
+        std::vector<float> samples(static_cast<size_t>(numFrames));
+        uint32_t state = seed * 2654435761u + 1u;
+
+        for (auto& sample : samples)
+        {
+            state = state * 1664525u + 1013904223u;
+            sample = static_cast<float>(state >> 8) / static_cast<float>(1u << 24) - 0.5f;
+        }
+
+        return samples;
+    }
+
+    static double maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        double worst = 0.0;
+        for (size_t i = 0; i < a.size(); ++i)
+            worst = std::max(worst, static_cast<double>(std::abs(a[i] - b[i])));
+
+        return worst;
+    }
+
+    // RBJ cookbook shelf and peak, unnormalised (b0 b1 b2 a0 a1 a2)
+    static std::array<float, 6> shelf(double sampleRate, double frequency, double gainDb, bool high)
+    {
+        const double a = std::pow(10.0, gainDb / 40.0);
+        const double w = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        const double cosW = std::cos(w);
+        const double alpha = std::sin(w) / std::sqrt(2.0);
+        const double root = 2.0 * std::sqrt(a) * alpha;
+        const double sign = high ? -1.0 : 1.0;
+
+        return { static_cast<float>(a * ((a + 1) - sign * (a - 1) * cosW + root)),
+                 static_cast<float>(sign * 2 * a * ((a - 1) - sign * (a + 1) * cosW)),
+                 static_cast<float>(a * ((a + 1) - sign * (a - 1) * cosW - root)),
+                 static_cast<float>((a + 1) + sign * (a - 1) * cosW + root),
+                 static_cast<float>(-sign * 2 * ((a - 1) + sign * (a + 1) * cosW)),
+                 static_cast<float>((a + 1) + sign * (a - 1) * cosW - root) };
+    }
+
+    static std::array<float, 6> peak(double sampleRate, double frequency, double q, double gainDb)
+    {
+        const double a = std::pow(10.0, gainDb / 40.0);
+        const double w = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        const double alpha = std::sin(w) / (2.0 * q);
+
+        return { static_cast<float>(1 + alpha * a), static_cast<float>(-2 * std::cos(w)), static_cast<float>(1 - alpha * a),
+                 static_cast<float>(1 + alpha / a), static_cast<float>(-2 * std::cos(w)), static_cast<float>(1 - alpha / a) };
+    }
+};
+
+static StereoBiquadCascadeTests stereoBiquadCascadeTests;
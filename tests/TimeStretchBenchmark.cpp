@@ -0,0 +1,130 @@
+#include <juce_core/juce_core.h>
+#include "WsolaStretcher.h"
+#include <cmath>
+#include <vector>
+
+#if HAVE_RUBBERBAND
+ #include <rubberband/RubberBandStretcher.h>
+#endif
+
+// Compares the CPU cost per block and the latency of the built-in WSOLA
+// stretcher against Rubber Band, configured as RubberBandNode configures it,
+// over the tempo and pitch settings practice sessions actually use.
+class TimeStretchBenchmark : public juce::UnitTest
+{
+public:
+    TimeStretchBenchmark() : juce::UnitTest("Time Stretch Benchmark", "Benchmarks") {}
+
+    void runTest() override
+    {
+        const std::vector<std::pair<double, double>> settings {
+            { 1.0, 1.0 },                              // Unchanged
+            { 1.25, 1.0 },                             // 80% tempo
+            { 0.8, 1.0 },                              // 125% tempo
+            { 1.25, std::pow(2.0, -2.0 / 12.0) }       // 80% tempo, down a tone
+        };
+
+        for (const auto& [timeRatio, pitchScale] : settings)
+        {
+            beginTest("Ratio " + juce::String(timeRatio, 2) + ", pitch " + juce::String(pitchScale, 3));
+
+            WsolaStretcher wsola;
+            wsola.prepare(SAMPLE_RATE, 2, BLOCK_SIZE);
+            wsola.setTimeRatio(timeRatio);
+            wsola.setPitchScale(pitchScale);
+
+            const auto wsolaResult = measure([&wsola](const float* const* input, float* const* output)
+            {
+                wsola.process(input, BLOCK_SIZE);
+                return wsola.retrieve(output, BLOCK_SIZE);
+            });
+
+            logMessage("WSOLA:       " + describe(wsolaResult) + ", reported latency " + juce::String(wsola.getLatency()));
+            expect(wsolaResult.firstOutputFrame >= 0, "WSOLA should produce output");
+
+#if HAVE_RUBBERBAND
+            using Stretcher = RubberBand::RubberBandStretcher;
+            Stretcher rubberBand(static_cast<size_t>(SAMPLE_RATE), 2,
+                                 Stretcher::OptionProcessRealTime | Stretcher::OptionStretchElastic
+                                 | Stretcher::OptionTransientsCrisp | Stretcher::OptionDetectorCompound
+                                 | Stretcher::OptionPhaseLaminar | Stretcher::OptionThreadingNever
+                                 | Stretcher::OptionWindowShort | Stretcher::OptionSmoothingOff,
+                                 timeRatio, pitchScale);
+            rubberBand.setMaxProcessSize(BLOCK_SIZE);
+
+            const auto rubberBandResult = measure([&rubberBand](const float* const* input, float* const* output)
+            {
+                rubberBand.process(input, BLOCK_SIZE, false);
+                const auto available = juce::jmin(static_cast<int>(rubberBand.available()), BLOCK_SIZE);
+                return available > 0 ? static_cast<int>(rubberBand.retrieve(output, static_cast<size_t>(available))) : 0;
+            });
+
+            logMessage("Rubber Band: " + describe(rubberBandResult) + ", reported latency " + juce::String(static_cast<int>(rubberBand.getStartDelay())));
+
+            if (wsolaResult.microsecondsPerBlock > 0.0)
+                logMessage("WSOLA CPU saving: " + juce::String(rubberBandResult.microsecondsPerBlock / wsolaResult.microsecondsPerBlock, 1) + "x");
+#else
+            logMessage("Rubber Band is not linked, WSOLA only");
+#endif
+        }
+    }
+
+private:
+    static constexpr double SAMPLE_RATE = 48000.0;
+    static constexpr int BLOCK_SIZE = 512;
+    static constexpr int NUM_BLOCKS = 2000;   // About 21 seconds
+
+    struct Result
+    {
+        double microsecondsPerBlock = 0.0;
+        double worstMicroseconds = 0.0;
+        int firstOutputFrame = -1;   // Input frames fed before the first output
+    };
+
+    template <typename ProcessFunction>
+    static Result measure(ProcessFunction&& processBlock)
+    {
+        std::vector<float> left(BLOCK_SIZE), right(BLOCK_SIZE), outLeft(BLOCK_SIZE), outRight(BLOCK_SIZE);
+        const float* input[2] = { left.data(), right.data() };
+        float* output[2] = { outLeft.data(), outRight.data() };
+
+        Result result;
+        juce::int64 totalTicks = 0;
+        juce::Random random(42);
+
+        for (int block = 0; block < NUM_BLOCKS; ++block)
+        {
+            // A chord with a little noise, so neither engine gets an easy ride
+            for (int i = 0; i < BLOCK_SIZE; ++i)
+            {
+                const double t = (block * BLOCK_SIZE + i) / SAMPLE_RATE;
+                const double twoPiT = juce::MathConstants<double>::twoPi * t;
+                const auto sample = static_cast<float>(0.2 * std::sin(220.0 * twoPiT) + 0.15 * std::sin(277.2 * twoPiT)
+                                                       + 0.1 * std::sin(329.6 * twoPiT)) + 0.01f * (random.nextFloat() - 0.5f);
+                left[static_cast<size_t>(i)] = sample;
+                right[static_cast<size_t>(i)] = 0.9f * sample;
+            }
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            const int produced = processBlock(input, output);
+            const auto ticks = juce::Time::getHighResolutionTicks() - start;
+
+            totalTicks += ticks;
+            result.worstMicroseconds = juce::jmax(result.worstMicroseconds, juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6);
+
+            if (result.firstOutputFrame < 0 && produced > 0)
+                result.firstOutputFrame = (block + 1) * BLOCK_SIZE - produced;
+        }
+
+        result.microsecondsPerBlock = juce::Time::highResolutionTicksToSeconds(totalTicks) * 1.0e6 / NUM_BLOCKS;
+        return result;
+    }
+
+    static juce::String describe(const Result& result)
+    {
+        return juce::String(result.microsecondsPerBlock, 1) + " us/block (worst " + juce::String(result.worstMicroseconds, 1)
+             + " us), first output after " + juce::String(result.firstOutputFrame) + " frames";
+    }
+};
+
+static TimeStretchBenchmark timeStretchBenchmark;
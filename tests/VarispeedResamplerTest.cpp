@@ -0,0 +1,135 @@
+#include <juce_core/juce_core.h>
+#include "VarispeedResampler.h"
+#include <cmath>
+#include <vector>
+
+class VarispeedResamplerTests : public juce::UnitTest
+{
+public:
+    VarispeedResamplerTests() : juce::UnitTest("VarispeedResampler Tests") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+
+        beginTest("Normal Speed Passes Audio Through");
+        {
+            VarispeedResampler resampler;
+            resampler.prepare(sampleRate, blockSize);
+
+            const auto input = sine(sampleRate, 1000.0, blockSize * 21);
+            const auto result = run(resampler, input, blockSize, 20);
+
+            expectEquals(static_cast<int>(result.output.size()), blockSize * 20);
+
+            // Output lines up with the input sample for sample (the latency is lookahead only)
+            double worstError = 0.0;
+            for (size_t i = 0; i < result.output.size(); ++i)
+                worstError = juce::jmax(worstError, static_cast<double>(std::abs(result.output[i] - input[i])));
+
+            expectLessThan(worstError, 0.01);
+        }
+
+        beginTest("Half Speed Reads Half As Much And Drops An Octave");
+        {
+            VarispeedResampler resampler;
+            resampler.prepare(sampleRate, blockSize);
+            resampler.setSpeedImmediately(0.5f);
+
+            const auto input = sine(sampleRate, 1000.0, blockSize * 40);
+            const auto result = run(resampler, input, blockSize, 40);
+
+            expectWithinAbsoluteError(static_cast<double>(result.inputConsumed), blockSize * 20.0, 2.0 * VarispeedResampler::TAPS);
+            expectWithinAbsoluteError(frequency(result.output, sampleRate), 500.0, 2.0);
+        }
+
+        beginTest("Speed Changes Glide");
+        {
+            VarispeedResampler resampler;
+            resampler.prepare(sampleRate, blockSize);
+            resampler.setSpeed(2.0f);
+
+            expectEquals(resampler.getSpeed(), 1.0f);
+
+            const auto input = sine(sampleRate, 1000.0, blockSize * 80);
+            run(resampler, input, blockSize, 1);
+
+            expectGreaterThan(resampler.getSpeed(), 1.0f);
+            expectLessThan(resampler.getSpeed(), 2.0f);
+        }
+
+        beginTest("Starved Input Writes What It Can");
+        {
+            VarispeedResampler resampler;
+            resampler.prepare(sampleRate, blockSize);
+
+            const auto input = sine(sampleRate, 1000.0, 100);
+            const float* in[2] = { input.data(), input.data() };
+            std::vector<float> left(blockSize), right(blockSize);
+            float* out[2] = { left.data(), right.data() };
+
+            const int written = resampler.process(in, 100, out, blockSize, 2);
+            expectEquals(written, 100 - VarispeedResampler::TAPS / 2);
+        }
+    }
+
+private:
+    struct Result
+    {
+        std::vector<float> output;
+        int inputConsumed = 0;
+    };
+
+    static std::vector<float> sine(double sampleRate, double frequency, int numSamples)
+    {
+        std::vector<float> samples(static_cast<size_t>(numSamples));
+        for (int i = 0; i < numSamples; ++i)
+            samples[static_cast<size_t>(i)] = 0.5f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * frequency * i / sampleRate));
+
+        return samples;
+    }
+
+    // Pulls blocks through the resampler the way SetlistPlayer does
+    static Result run(VarispeedResampler& resampler, const std::vector<float>& input, int blockSize, int numBlocks)
+    {
+        Result result;
+        std::vector<float> left(static_cast<size_t>(blockSize)), right(static_cast<size_t>(blockSize));
+        float* output[2] = { left.data(), right.data() };
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const int available = static_cast<int>(input.size()) - result.inputConsumed;
+            const int framesToRead = juce::jmin(resampler.getInputFramesNeeded(blockSize), available);
+            const float* channels[2] = { input.data() + result.inputConsumed, input.data() + result.inputConsumed };
+
+            const int written = resampler.process(channels, framesToRead, output, blockSize, 2);
+            result.inputConsumed += framesToRead;
+            result.output.insert(result.output.end(), left.begin(), left.begin() + written);
+        }
+
+        return result;
+    }
+
+    static double frequency(const std::vector<float>& samples, double sampleRate)
+    {
+        int crossings = 0;
+        size_t first = 0, last = 0;
+
+        for (size_t i = 1; i < samples.size(); ++i)
+        {
+            if (samples[i - 1] < 0.0f && samples[i] >= 0.0f)
+            {
+                if (crossings == 0)
+                    first = i;
+
+                last = i;
+                ++crossings;
+            }
+        }
+
+        return crossings > 1 ? (crossings - 1) * sampleRate / static_cast<double>(last - first) : 0.0;
+    }
+};
+
+static VarispeedResamplerTests varispeedResamplerTests;
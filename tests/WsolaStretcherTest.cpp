@@ -0,0 +1,179 @@
+#include <juce_core/juce_core.h>
+#include "WsolaStretcher.h"
+#include <cmath>
+#include <vector>
+
+class WsolaStretcherTests : public juce::UnitTest
+{
+public:
+    WsolaStretcherTests() : juce::UnitTest("WsolaStretcher Tests") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+
+        beginTest("Unity Ratio Keeps Level And Length");
+        {
+            WsolaStretcher stretcher;
+            stretcher.prepare(sampleRate, 2, blockSize);
+
+            const auto output = run(stretcher, sampleRate, 440.0, 2.0, blockSize);
+
+            // Periodic Hann at 50% overlap adds back up to the original level
+            expectWithinAbsoluteError(rms(output, stretcher.getLatency()), 0.5 / std::sqrt(2.0), 0.02);
+            expectWithinAbsoluteError(static_cast<double>(output.size()), 2.0 * sampleRate, static_cast<double>(stretcher.getLatency()));
+        }
+
+        beginTest("Time Ratio Sets Output Length");
+        {
+            WsolaStretcher stretcher;
+            stretcher.prepare(sampleRate, 2, blockSize);
+            stretcher.setTimeRatio(1.5);
+
+            const auto output = run(stretcher, sampleRate, 440.0, 2.0, blockSize);
+
+            expectWithinAbsoluteError(static_cast<double>(output.size()), 3.0 * sampleRate, 2.0 * stretcher.getLatency());
+            expectWithinAbsoluteError(frequency(output, sampleRate, stretcher.getLatency()), 440.0, 5.0);
+        }
+
+        beginTest("Pitch Scale Shifts Frequency But Not Length");
+        {
+            WsolaStretcher stretcher;
+            stretcher.prepare(sampleRate, 2, blockSize);
+            stretcher.setPitchScale(std::pow(2.0, 7.0 / 12.0));
+
+            const auto output = run(stretcher, sampleRate, 440.0, 2.0, blockSize);
+
+            expectWithinAbsoluteError(static_cast<double>(output.size()), 2.0 * sampleRate, 2.0 * stretcher.getLatency());
+            expectWithinAbsoluteError(frequency(output, sampleRate, stretcher.getLatency()), 440.0 * std::pow(2.0, 7.0 / 12.0), 8.0);
+        }
+
+        beginTest("Pulling What It Asks For Fills Every Block");
+        {
+            for (const double ratio : { 0.7, 1.0, 1.6 })
+            {
+                WsolaStretcher stretcher;
+                stretcher.prepare(sampleRate, 2, blockSize);
+                stretcher.setTimeRatio(ratio);
+
+                std::vector<float> input(blockSize, 0.25f), left(blockSize), right(blockSize);
+                const float* in[2] = { input.data(), input.data() };
+                float* out[2] = { left.data(), right.data() };
+
+                int shortBlocks = 0, peakBuffered = 0;
+
+                for (int block = 0; block < 500; ++block)
+                {
+                    // The same loop RubberBandNode runs with a pull source
+                    while (stretcher.available() < blockSize)
+                        stretcher.process(in, juce::jmin(blockSize, juce::jmax(64, stretcher.getSamplesRequired())));
+
+                    shortBlocks += stretcher.retrieve(out, blockSize) < blockSize ? 1 : 0;
+                    peakBuffered = juce::jmax(peakBuffered, stretcher.available());
+                }
+
+                expectEquals(shortBlocks, 0);
+                expectLessThan(peakBuffered, blockSize + stretcher.getLatency());
+            }
+        }
+
+        beginTest("Start Pad Brings The First Frame Out At Full Level");
+        {
+            for (const double ratio : { 0.7, 1.0, 1.6 })
+            {
+                WsolaStretcher stretcher;
+                stretcher.prepare(sampleRate, 2, blockSize);
+                stretcher.setTimeRatio(ratio);
+
+                std::vector<float> silence(static_cast<size_t>(stretcher.getPreferredStartPad()), 0.0f);
+                const float* pad[2] = { silence.data(), silence.data() };
+                stretcher.process(pad, static_cast<int>(silence.size()));
+
+                const auto output = run(stretcher, sampleRate, 440.0, 0.5, blockSize);
+                const std::vector<float> start(output.begin() + stretcher.getStartDelay(),
+                                               output.begin() + stretcher.getStartDelay() + static_cast<int>(sampleRate * 0.01));
+
+                // Unpadded, the first hop fades in and comes out well under this
+                expectWithinAbsoluteError(rms(start, 0), 0.5 / std::sqrt(2.0), 0.05);
+            }
+        }
+
+        beginTest("Refuses Input Once Output Backs Up");
+        {
+            WsolaStretcher stretcher;
+            stretcher.prepare(sampleRate, 2, blockSize);
+            stretcher.setTimeRatio(4.0);
+
+            std::vector<float> silence(blockSize, 0.0f);
+            const float* input[2] = { silence.data(), silence.data() };
+
+            int taken = blockSize;
+            for (int block = 0; block < 1000 && taken == blockSize; ++block)
+                taken = stretcher.process(input, blockSize);
+
+            expect(taken < blockSize, "Input should be refused when nothing is retrieved");
+        }
+    }
+
+private:
+    // Stretches a sine, taking all output as it comes, and returns the left channel
+    static std::vector<float> run(WsolaStretcher& stretcher, double sampleRate, double sineFrequency, double seconds, int blockSize)
+    {
+        std::vector<float> left(static_cast<size_t>(blockSize)), right(static_cast<size_t>(blockSize));
+        std::vector<float> outLeft(static_cast<size_t>(blockSize * 16)), outRight(static_cast<size_t>(blockSize * 16));
+        const float* input[2] = { left.data(), right.data() };
+        float* output[2] = { outLeft.data(), outRight.data() };
+
+        std::vector<float> result;
+        const auto totalFrames = static_cast<int>(seconds * sampleRate);
+
+        for (int start = 0; start < totalFrames; start += blockSize)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const double phase = 2.0 * juce::MathConstants<double>::pi * sineFrequency * (start + i) / sampleRate;
+                left[static_cast<size_t>(i)] = right[static_cast<size_t>(i)] = 0.5f * static_cast<float>(std::sin(phase));
+            }
+
+            stretcher.process(input, blockSize);
+
+            const int retrieved = stretcher.retrieve(output, static_cast<int>(outLeft.size()));
+            result.insert(result.end(), outLeft.begin(), outLeft.begin() + retrieved);
+        }
+
+        return result;
+    }
+
+    static double rms(const std::vector<float>& samples, int skip)
+    {
+        double sum = 0.0;
+        for (size_t i = static_cast<size_t>(skip); i < samples.size(); ++i)
+            sum += samples[i] * samples[i];
+
+        return std::sqrt(sum / static_cast<double>(samples.size() - static_cast<size_t>(skip)));
+    }
+
+    // From upward zero crossings, skipping the fade-in
+    static double frequency(const std::vector<float>& samples, double sampleRate, int skip)
+    {
+        int crossings = 0;
+        size_t first = 0, last = 0;
+
+        for (size_t i = static_cast<size_t>(skip) + 1; i < samples.size(); ++i)
+        {
+            if (samples[i - 1] < 0.0f && samples[i] >= 0.0f)
+            {
+                if (crossings == 0)
+                    first = i;
+
+                last = i;
+                ++crossings;
+            }
+        }
+
+        return crossings > 1 ? (crossings - 1) * sampleRate / static_cast<double>(last - first) : 0.0;
+    }
+};
+
+static WsolaStretcherTests wsolaStretcherTests;